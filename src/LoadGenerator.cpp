@@ -0,0 +1,558 @@
+/*
+ *  Synthetic frontend load generator
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "LoadGenerator.hpp"
+
+#include <iomanip>
+
+#include <drm_fourcc.h>
+
+#include <xen/be/Exception.hpp>
+
+#include "TrackingConnector.hpp"
+
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+using std::condition_variable;
+using std::dec;
+using std::endl;
+using std::fixed;
+using std::lock_guard;
+using std::mutex;
+using std::ostream;
+using std::setprecision;
+using std::thread;
+using std::to_string;
+using std::unique_lock;
+using std::unique_ptr;
+
+using DisplayItf::ConnectorPtr;
+using DisplayItf::DisplayPtr;
+
+namespace {
+
+// grant refs and ports of the generator don't overlap ones of MockBackend
+const grant_ref_t cRefBase = 0x10000;
+const grant_ref_t cRefsPerConnector = 16;
+const evtchn_port_t cPortBase = 0x1000;
+
+const int cNumBuffers = 2;
+const uint32_t cBpp = 32;
+
+uint64_t getCpuTimeUs(const timeval& time)
+{
+	return time.tv_sec * 1000000ull + time.tv_usec;
+}
+
+}
+
+/*******************************************************************************
+ * LoadGenerator::Client
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * Simulated frontend connector.
+ ******************************************************************************/
+class LoadGenerator::Client
+{
+public:
+
+	Client(LoadGenerator& generator, BuffersStoragePtr buffersStorage,
+		   domid_t domId, int conIndex, int globalIndex);
+
+	~Client();
+
+	void start();
+	void stop();
+
+private:
+
+	LoadGenerator& mGenerator;
+	domid_t mDomId;
+	int mConIndex;
+	grant_ref_t mRefBase;
+	XenBackend::Log mLog;
+
+	unique_ptr<DisplayCommandHandler> mHandler;
+	uint16_t mReqId;
+
+	thread mThread;
+	mutex mMutex;
+	condition_variable mCondVar;
+	bool mTerminate;
+	bool mFlipPending;
+	uint64_t mFlipTime;
+
+	uint64_t getDbCookie(int buffer) const
+	{
+		return (static_cast<uint64_t>(mConIndex) << 8) | (buffer + 1);
+	}
+
+	uint64_t getFbCookie(int buffer) const
+	{
+		return (static_cast<uint64_t>(mConIndex) << 8) | (buffer + 0x80);
+	}
+
+	int sendRequest(xendispl_req& req, uint8_t operation);
+	void run();
+	void setup();
+	void teardown();
+	bool flip(int buffer);
+	void onFlipDone();
+};
+
+LoadGenerator::Client::Client(LoadGenerator& generator,
+							  BuffersStoragePtr buffersStorage,
+							  domid_t domId, int conIndex, int globalIndex) :
+	mGenerator(generator),
+	mDomId(domId),
+	mConIndex(conIndex),
+	mRefBase(cRefBase + globalIndex * cRefsPerConnector),
+	mLog("LoadClient"),
+	mReqId(0),
+	mTerminate(false),
+	mFlipPending(false),
+	mFlipTime(0)
+{
+	auto name = "load" + to_string(mDomId) + "-" + to_string(mConIndex);
+
+	ConnectorPtr connector(new TrackingConnector(
+			mGenerator.mDisplay->createConnector(mDomId, name,
+												 mGenerator.mWidth,
+												 mGenerator.mHeight),
+			[this] { onFlipDone(); }));
+
+	EventRingBufferPtr eventBuffer(new EventRingBuffer(
+			mConIndex, mDomId, cPortBase + globalIndex, mRefBase,
+			XENDISPL_IN_RING_OFFS, XENDISPL_IN_RING_SIZE,
+			mGenerator.mTimerQueue));
+
+	mHandler.reset(new DisplayCommandHandler(mGenerator.mDisplay, connector,
+											 buffersStorage, eventBuffer));
+}
+
+LoadGenerator::Client::~Client()
+{
+	stop();
+
+	// the display may still complete the pending flip
+	unique_lock<mutex> lock(mMutex);
+
+	mCondVar.wait_for(lock, std::chrono::milliseconds(100),
+					  [this] { return !mFlipPending; });
+}
+
+void LoadGenerator::Client::start()
+{
+	mTerminate = false;
+
+	mThread = thread(&Client::run, this);
+}
+
+void LoadGenerator::Client::stop()
+{
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		mTerminate = true;
+	}
+
+	mCondVar.notify_all();
+
+	if (mThread.joinable())
+	{
+		mThread.join();
+	}
+}
+
+int LoadGenerator::Client::sendRequest(xendispl_req& req, uint8_t operation)
+{
+	xendispl_resp rsp {};
+
+	req.id = mReqId++;
+	req.operation = operation;
+
+	auto status = mHandler->processCommand(req, rsp);
+
+	if (status)
+	{
+		mGenerator.mErrors.add();
+	}
+
+	return status;
+}
+
+void LoadGenerator::Client::run()
+{
+	try
+	{
+		setup();
+
+		auto fps = mGenerator.mFps;
+		auto period = microseconds(fps ? 1000000 / fps : 0);
+		auto next = steady_clock::now();
+		int buffer = 0;
+
+		unique_lock<mutex> lock(mMutex);
+
+		while(!mTerminate)
+		{
+			if (fps)
+			{
+				mCondVar.wait_until(lock, next, [this] { return mTerminate; });
+
+				if (mTerminate)
+				{
+					break;
+				}
+
+				next += period;
+
+				// a frontend skips the frame if the previous flip is not done
+				if (mFlipPending)
+				{
+					mGenerator.mMissedFrames.add();
+
+					continue;
+				}
+			}
+			else
+			{
+				mCondVar.wait(lock, [this]
+							  { return mTerminate || !mFlipPending; });
+
+				if (mTerminate)
+				{
+					break;
+				}
+			}
+
+			mFlipPending = true;
+			mFlipTime = Metrics::getTimeUs();
+
+			lock.unlock();
+
+			if (!flip(buffer))
+			{
+				lock.lock();
+
+				mFlipPending = false;
+
+				continue;
+			}
+
+			buffer = (buffer + 1) % cNumBuffers;
+
+			lock.lock();
+		}
+
+		lock.unlock();
+
+		teardown();
+	}
+	catch(const std::exception& e)
+	{
+		LOG(mLog, ERROR) << e.what();
+	}
+}
+
+void LoadGenerator::Client::setup()
+{
+	xendispl_req req {};
+
+	req.op.get_edid.buffer_sz = XENDISPL_EDID_MAX_SIZE;
+	req.op.get_edid.gref_directory = mRefBase + 1;
+
+	sendRequest(req, XENDISPL_OP_GET_EDID);
+
+	auto stride = 4 * ((mGenerator.mWidth * cBpp + 31) / 32);
+
+	for (int i = 0; i < cNumBuffers; i++)
+	{
+		req = {};
+
+		req.op.dbuf_create.dbuf_cookie = getDbCookie(i);
+		req.op.dbuf_create.width = mGenerator.mWidth;
+		req.op.dbuf_create.height = mGenerator.mHeight;
+		req.op.dbuf_create.bpp = cBpp;
+		req.op.dbuf_create.buffer_sz = stride * mGenerator.mHeight;
+		req.op.dbuf_create.gref_directory = mRefBase + 2 + i;
+
+		sendRequest(req, XENDISPL_OP_DBUF_CREATE);
+
+		req = {};
+
+		req.op.fb_attach.dbuf_cookie = getDbCookie(i);
+		req.op.fb_attach.fb_cookie = getFbCookie(i);
+		req.op.fb_attach.width = mGenerator.mWidth;
+		req.op.fb_attach.height = mGenerator.mHeight;
+		req.op.fb_attach.pixel_format = DRM_FORMAT_XRGB8888;
+
+		sendRequest(req, XENDISPL_OP_FB_ATTACH);
+	}
+
+	req = {};
+
+	req.op.set_config.fb_cookie = getFbCookie(0);
+	req.op.set_config.width = mGenerator.mWidth;
+	req.op.set_config.height = mGenerator.mHeight;
+	req.op.set_config.bpp = cBpp;
+
+	if (sendRequest(req, XENDISPL_OP_SET_CONFIG))
+	{
+		throw XenBackend::Exception("Can't set config, dom: " +
+									to_string(mDomId) + ", connector: " +
+									to_string(mConIndex), EINVAL);
+	}
+}
+
+void LoadGenerator::Client::teardown()
+{
+	{
+		unique_lock<mutex> lock(mMutex);
+
+		mCondVar.wait_for(lock, std::chrono::milliseconds(100),
+						  [this] { return !mFlipPending; });
+	}
+
+	xendispl_req req {};
+
+	sendRequest(req, XENDISPL_OP_SET_CONFIG);
+
+	for (int i = 0; i < cNumBuffers; i++)
+	{
+		req = {};
+
+		req.op.fb_detach.fb_cookie = getFbCookie(i);
+
+		sendRequest(req, XENDISPL_OP_FB_DETACH);
+
+		req = {};
+
+		req.op.dbuf_destroy.dbuf_cookie = getDbCookie(i);
+
+		sendRequest(req, XENDISPL_OP_DBUF_DESTROY);
+	}
+}
+
+bool LoadGenerator::Client::flip(int buffer)
+{
+	xendispl_req req {};
+
+	req.op.pg_flip.fb_cookie = getFbCookie(buffer);
+
+	auto start = Metrics::getTimeUs();
+
+	auto status = sendRequest(req, XENDISPL_OP_PG_FLIP);
+
+	mGenerator.mRequestLatency.add(Metrics::getTimeUs() - start);
+
+	return status == 0;
+}
+
+void LoadGenerator::Client::onFlipDone()
+{
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		if (!mFlipPending)
+		{
+			return;
+		}
+
+		mFlipPending = false;
+
+		mGenerator.mFlipLatency.add(Metrics::getTimeUs() - mFlipTime);
+		mGenerator.mFlips.add();
+	}
+
+	mCondVar.notify_all();
+}
+
+/*******************************************************************************
+ * LoadGenerator
+ ******************************************************************************/
+
+LoadGenerator::LoadGenerator(DisplayPtr display, domid_t feDomId,
+							 int numFrontends, int numConnectors,
+							 uint32_t width, uint32_t height, uint32_t fps) :
+	mDisplay(display),
+	mTimerQueue(new TimerQueue()),
+	mNumFrontends(numFrontends),
+	mNumConnectors(numConnectors),
+	mWidth(width),
+	mHeight(height),
+	mFps(fps),
+	mLog("LoadGenerator"),
+	mStartTime(0),
+	mStopTime(0),
+	mNumFlips(0),
+	mStartUsage {},
+	mStopUsage {},
+	mFlips(Metrics::Collector::getInstance().getCounter("load.flips")),
+	mMissedFrames(Metrics::Collector::getInstance().getCounter(
+			"load.missed_frames")),
+	mErrors(Metrics::Collector::getInstance().getCounter("load.errors")),
+	mFlipLatency(Metrics::Collector::getInstance().getHistogram(
+			"load.flip_latency_us")),
+	mRequestLatency(Metrics::Collector::getInstance().getHistogram(
+			"load.flip_request_us"))
+{
+	try
+	{
+		init(feDomId);
+	}
+	catch(const std::exception& e)
+	{
+		mClients.clear();
+
+		throw;
+	}
+}
+
+LoadGenerator::~LoadGenerator()
+{
+	stop();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void LoadGenerator::start()
+{
+	LOG(mLog, INFO) << "Start, frontends: " << mNumFrontends
+					<< ", connectors: " << mNumConnectors
+					<< ", fps: " << mFps;
+
+	mFlips.reset();
+	mMissedFrames.reset();
+	mErrors.reset();
+	mFlipLatency.reset();
+	mRequestLatency.reset();
+
+	mStartTime = Metrics::getTimeUs();
+	mStopTime = 0;
+
+	getrusage(RUSAGE_SELF, &mStartUsage);
+
+	for (auto& client : mClients)
+	{
+		client->start();
+	}
+}
+
+void LoadGenerator::stop()
+{
+	if (!mStartTime || mStopTime)
+	{
+		return;
+	}
+
+	// take the measurement before the teardown requests
+	mStopTime = Metrics::getTimeUs();
+
+	getrusage(RUSAGE_SELF, &mStopUsage);
+
+	mNumFlips = mFlips.get();
+
+	for (auto& client : mClients)
+	{
+		client->stop();
+	}
+
+	LOG(mLog, INFO) << "Stop";
+}
+
+void LoadGenerator::report(ostream& stream)
+{
+	auto stopTime = mStopTime ? mStopTime : Metrics::getTimeUs();
+	auto stopUsage = mStopUsage;
+
+	if (!mStopTime)
+	{
+		getrusage(RUSAGE_SELF, &stopUsage);
+	}
+
+	auto flips = mStopTime ? mNumFlips : mFlips.get();
+	double seconds = (stopTime - mStartTime) / 1000000.0;
+
+	auto userUs = getCpuTimeUs(stopUsage.ru_utime) -
+				  getCpuTimeUs(mStartUsage.ru_utime);
+	auto sysUs = getCpuTimeUs(stopUsage.ru_stime) -
+				 getCpuTimeUs(mStartUsage.ru_stime);
+
+	stream << dec << fixed << setprecision(1);
+
+	stream << "Load: " << mNumFrontends << " frontends x "
+		   << mNumConnectors << " connectors, " << mWidth << "x" << mHeight
+		   << ", target fps: " << mFps << ", time: " << seconds << " s"
+		   << endl;
+
+	stream << "Flips: " << flips << ", flips/s: "
+		   << (seconds > 0 ? flips / seconds : 0)
+		   << ", missed frames: " << mMissedFrames.get()
+		   << ", errors: " << mErrors.get() << endl;
+
+	// process CPU time: backend and display threads plus the generator
+	stream << "CPU per flip, us: "
+		   << (flips ? static_cast<double>(userUs + sysUs) / flips : 0)
+		   << " (user: " << (flips ? static_cast<double>(userUs) / flips : 0)
+		   << ", sys: " << (flips ? static_cast<double>(sysUs) / flips : 0)
+		   << ")" << endl;
+
+	// percentiles are upper bounds of power of two buckets
+	stream << "Flip latency, us: p50 <= " << mFlipLatency.getPercentile(50)
+		   << ", p90 <= " << mFlipLatency.getPercentile(90)
+		   << ", p99 <= " << mFlipLatency.getPercentile(99)
+		   << ", max: " << mFlipLatency.getMax() << endl;
+
+	stream << "Flip request, us: p50 <= " << mRequestLatency.getPercentile(50)
+		   << ", p90 <= " << mRequestLatency.getPercentile(90)
+		   << ", p99 <= " << mRequestLatency.getPercentile(99)
+		   << ", max: " << mRequestLatency.getMax() << endl;
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void LoadGenerator::init(domid_t feDomId)
+{
+	if (mNumFrontends < 1 || mNumConnectors < 1 || !mWidth || !mHeight)
+	{
+		throw XenBackend::Exception("Wrong load configuration", EINVAL);
+	}
+
+	for (int i = 0; i < mNumFrontends; i++)
+	{
+		domid_t domId = feDomId + i;
+
+		// as in the backend, buffers are shared by connectors of a frontend
+		BuffersStoragePtr buffersStorage(new BuffersStorage(domId, mDisplay));
+
+		for (int j = 0; j < mNumConnectors; j++)
+		{
+			mClients.emplace_back(new Client(*this, buffersStorage, domId, j,
+											 i * mNumConnectors + j));
+		}
+	}
+}
@@ -0,0 +1,116 @@
+/*
+ *  Synthetic frontend load generator
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_LOADGENERATOR_HPP_
+#define SRC_LOADGENERATOR_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <xen/be/Log.hpp>
+
+#include "DisplayCommandHandler.hpp"
+#include "Metrics.hpp"
+
+/***************************************************************************//**
+ * Simulates frontends which drive display connectors through the command
+ * handler: each connector creates and attaches two buffers, sets the mode and
+ * then flips the buffers at the target frame rate, waiting for the previous
+ * flip as a real frontend waits for the flip event. Event and grant table
+ * mappings are served by the mock backend library.
+ * @ingroup displ_be
+ ******************************************************************************/
+class LoadGenerator
+{
+public:
+
+	/**
+	 * @param display       display object
+	 * @param feDomId       domain id of the first frontend
+	 * @param numFrontends  number of frontends
+	 * @param numConnectors number of connectors of each frontend
+	 * @param width         connector width
+	 * @param height        connector height
+	 * @param fps           target frame rate of each connector, 0 flips as
+	 *                      soon as the previous flip is done
+	 */
+	LoadGenerator(DisplayItf::DisplayPtr display, domid_t feDomId,
+				  int numFrontends, int numConnectors,
+				  uint32_t width, uint32_t height, uint32_t fps);
+
+	~LoadGenerator();
+
+	/**
+	 * Starts issuing requests
+	 */
+	void start();
+
+	/**
+	 * Stops issuing requests and releases connectors
+	 */
+	void stop();
+
+	/**
+	 * Writes flips per second, CPU time per flip and latency percentiles
+	 * measured since start
+	 * @param stream output stream
+	 */
+	void report(std::ostream& stream);
+
+private:
+
+	class Client;
+
+	DisplayItf::DisplayPtr mDisplay;
+	// batch deadlines of the client event rings
+	TimerQueuePtr mTimerQueue;
+	int mNumFrontends;
+	int mNumConnectors;
+	uint32_t mWidth;
+	uint32_t mHeight;
+	uint32_t mFps;
+	XenBackend::Log mLog;
+
+	std::vector<std::unique_ptr<Client>> mClients;
+
+	uint64_t mStartTime;
+	uint64_t mStopTime;
+	uint64_t mNumFlips;
+	rusage mStartUsage;
+	rusage mStopUsage;
+
+	Metrics::Counter& mFlips;
+	Metrics::Counter& mMissedFrames;
+	Metrics::Counter& mErrors;
+	Metrics::Histogram& mFlipLatency;
+	Metrics::Histogram& mRequestLatency;
+
+	void init(domid_t feDomId);
+};
+
+#endif /* SRC_LOADGENERATOR_HPP_ */
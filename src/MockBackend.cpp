@@ -7,94 +7,132 @@
 
 #include "MockBackend.hpp"
 
+#include <xen/be/Exception.hpp>
+
 using std::bind;
+using std::cref;
 using std::string;
 using std::to_string;
 
 using namespace std::placeholders;
 
-MockBackend::MockBackend(domid_t beDomId, domid_t feDomId) :
+MockBackend::MockBackend(domid_t beDomId, domid_t feDomId, int numFrontends,
+						 int numConnectors, uint32_t width, uint32_t height) :
 	mBeDomId(beDomId),
-	mFeDomId(feDomId),
+	mNumConnectors(numConnectors),
+	mWidth(width),
+	mHeight(height),
 	mLog("MockBackend")
 {
+	if (numFrontends < 1 || numConnectors < 1 ||
+		numConnectors > cMaxConnectors)
+	{
+		throw XenBackend::Exception("Wrong number of mock frontends", EINVAL);
+	}
+
 	XenStoreMock::writeValue("domid", to_string(mBeDomId));
 
-	XenStoreMock::setDomainPath(mFeDomId, "/local/domain/" + to_string(mFeDomId));
 	XenStoreMock::setDomainPath(mBeDomId, "/local/domain/" + to_string(mBeDomId));
 
-	setupVdispl();
-	setupVkbd();
+	// the vector is not resized after this point, the async calls keep
+	// references to its elements
+	mFrontends.resize(numFrontends);
+
+	for (int i = 0; i < numFrontends; i++)
+	{
+		auto& frontend = mFrontends[i];
+
+		frontend.domId = feDomId + i;
+
+		XenStoreMock::setDomainPath(frontend.domId,
+									"/local/domain/" + to_string(frontend.domId));
+
+		setupVdispl(frontend);
+		setupVkbd(frontend);
+	}
 
 	XenStoreMock::setWriteValueCbk(bind(&MockBackend::onWriteXenStore, this,
 									_1, _2));
 
-	LOG(mLog, DEBUG) << "Create";
+	LOG(mLog, DEBUG) << "Create, frontends: " << numFrontends
+					 << ", connectors: " << numConnectors;
 }
 
-void MockBackend::setupVdispl()
+void MockBackend::setupVdispl(Frontend& frontend)
 {
-	mVdisplFePath = XenStoreMock::getDomainPath(mFeDomId);
-	mVdisplFePath += "/device/vdispl/0";
+	frontend.vdisplFePath = XenStoreMock::getDomainPath(frontend.domId);
+	frontend.vdisplFePath += "/device/vdispl/0";
 
-	mVdisplBePath = XenStoreMock::getDomainPath(mBeDomId);
-	mVdisplBePath += "/backend/vdispl/" + to_string(mFeDomId) + "/0";
+	frontend.vdisplBePath = XenStoreMock::getDomainPath(mBeDomId);
+	frontend.vdisplBePath += "/backend/vdispl/" + to_string(frontend.domId) +
+							 "/0";
 
-	XenStoreMock::writeValue(mVdisplBePath + "/frontend", mVdisplFePath);
+	XenStoreMock::writeValue(frontend.vdisplBePath + "/frontend",
+							 frontend.vdisplFePath);
 
-	XenStoreMock::writeValue(mVdisplFePath + "/state",
+	XenStoreMock::writeValue(frontend.vdisplFePath + "/state",
 						 to_string(XenbusStateInitialising));
-	XenStoreMock::writeValue(mVdisplBePath + "/state",
+	XenStoreMock::writeValue(frontend.vdisplBePath + "/state",
 						 to_string(XenbusStateInitialising));
 
-	XenStoreMock::writeValue(mVdisplFePath + "/0/id", "1000");
-	XenStoreMock::writeValue(mVdisplFePath + "/0/resolution", "800x600");
+	for (int i = 0; i < mNumConnectors; i++)
+	{
+		string conPath = frontend.vdisplFePath + "/" + to_string(i);
+
+		XenStoreMock::writeValue(conPath + "/id", to_string(1000 + i));
+		XenStoreMock::writeValue(conPath + "/resolution",
+								 to_string(mWidth) + "x" + to_string(mHeight));
+	}
 }
 
-void MockBackend::setupVkbd()
+void MockBackend::setupVkbd(Frontend& frontend)
 {
-	mVkbdFePath = XenStoreMock::getDomainPath(mFeDomId);
-	mVkbdFePath += "/device/vkbd/0";
+	frontend.vkbdFePath = XenStoreMock::getDomainPath(frontend.domId);
+	frontend.vkbdFePath += "/device/vkbd/0";
 
-	mVkbdBePath = XenStoreMock::getDomainPath(mBeDomId);
-	mVkbdBePath += "/backend/vkbd/" + to_string(mFeDomId) + "/0";
+	frontend.vkbdBePath = XenStoreMock::getDomainPath(mBeDomId);
+	frontend.vkbdBePath += "/backend/vkbd/" + to_string(frontend.domId) + "/0";
 
-	XenStoreMock::writeValue(mVkbdBePath + "/frontend", mVkbdFePath);
+	XenStoreMock::writeValue(frontend.vkbdBePath + "/frontend",
+							 frontend.vkbdFePath);
 
-	XenStoreMock::writeValue(mVkbdFePath + "/state",
+	XenStoreMock::writeValue(frontend.vkbdFePath + "/state",
 						 to_string(XenbusStateInitialising));
-	XenStoreMock::writeValue(mVkbdBePath + "/state",
+	XenStoreMock::writeValue(frontend.vkbdBePath + "/state",
 						 to_string(XenbusStateInitialising));
 
-	XenStoreMock::writeValue(mVkbdFePath + "/id", "k:0;p:0;t:0");
+	XenStoreMock::writeValue(frontend.vkbdFePath + "/id", "k:0;p:0;t:0");
 }
 
 void MockBackend::onWriteXenStore(const string& path, const string& value)
 {
-	string vdisplStatePath = mVdisplBePath + "/state";
-	string vkbdStatePath = mVkbdBePath + "/state";
-
-	if (path == vdisplStatePath)
+	for (const auto& frontend : mFrontends)
 	{
-		onVdisplBeStateChanged(static_cast<XenbusState>(stoi(value)));
-	}
-
-	if (path == vkbdStatePath)
-	{
-		onVkbdBeStateChanged(static_cast<XenbusState>(stoi(value)));
+		if (path == frontend.vdisplBePath + "/state")
+		{
+			onVdisplBeStateChanged(frontend,
+								   static_cast<XenbusState>(stoi(value)));
+		}
+
+		if (path == frontend.vkbdBePath + "/state")
+		{
+			onVkbdBeStateChanged(frontend,
+								 static_cast<XenbusState>(stoi(value)));
+		}
 	}
 }
 
-void MockBackend::onVdisplBeStateChanged(XenbusState state)
+void MockBackend::onVdisplBeStateChanged(const Frontend& frontend,
+										 XenbusState state)
 {
 	switch(state)
 	{
 	case XenbusStateInitialising:
-		mAsync.call(bind(&MockBackend::setVdisplFeState, this,
+		mAsync.call(bind(&MockBackend::setVdisplFeState, this, cref(frontend),
 					XenbusStateInitialising));
 		break;
 	case XenbusStateInitWait:
-		mAsync.call(bind(&MockBackend::setVdisplFeState, this,
+		mAsync.call(bind(&MockBackend::setVdisplFeState, this, cref(frontend),
 					XenbusStateInitialised));
 		break;
 	default:
@@ -102,32 +140,45 @@ void MockBackend::onVdisplBeStateChanged(XenbusState state)
 	}
 }
 
-void MockBackend::setVdisplFeState(XenbusState state)
+void MockBackend::setVdisplFeState(const Frontend& frontend, XenbusState state)
 {
-	LOG(mLog, DEBUG) << "Set vdispl FE state: " << state;
+	LOG(mLog, DEBUG) << "Set vdispl FE state, dom: " << frontend.domId
+					 << ", state: " << state;
 
 	if (state == XenbusStateInitialised)
 	{
-		XenStoreMock::writeValue(mVdisplFePath + "/0/evt-event-channel", "1");
-		XenStoreMock::writeValue(mVdisplFePath + "/0/evt-ring-ref", "100");
-
-		XenStoreMock::writeValue(mVdisplFePath + "/0/req-event-channel", "2");
-		XenStoreMock::writeValue(mVdisplFePath + "/0/req-ring-ref", "200");
+		// ports and refs are per frontend domain
+		for (int i = 0; i < mNumConnectors; i++)
+		{
+			string conPath = frontend.vdisplFePath + "/" + to_string(i);
+
+			XenStoreMock::writeValue(conPath + "/evt-event-channel",
+									 to_string(2 * i + 1));
+			XenStoreMock::writeValue(conPath + "/evt-ring-ref",
+									 to_string(100 + i));
+
+			XenStoreMock::writeValue(conPath + "/req-event-channel",
+									 to_string(2 * i + 2));
+			XenStoreMock::writeValue(conPath + "/req-ring-ref",
+									 to_string(200 + i));
+		}
 	}
 
-	XenStoreMock::writeValue(mVdisplFePath + "/state", to_string(state));
+	XenStoreMock::writeValue(frontend.vdisplFePath + "/state",
+							 to_string(state));
 }
 
-void MockBackend::onVkbdBeStateChanged(XenbusState state)
+void MockBackend::onVkbdBeStateChanged(const Frontend& frontend,
+									   XenbusState state)
 {
 	switch(state)
 	{
 	case XenbusStateInitialising:
-		mAsync.call(bind(&MockBackend::setVkbdFeState, this,
+		mAsync.call(bind(&MockBackend::setVkbdFeState, this, cref(frontend),
 					XenbusStateInitialising));
 		break;
 	case XenbusStateInitWait:
-		mAsync.call(bind(&MockBackend::setVkbdFeState, this,
+		mAsync.call(bind(&MockBackend::setVkbdFeState, this, cref(frontend),
 					XenbusStateInitialised));
 		break;
 	default:
@@ -135,16 +186,17 @@ void MockBackend::onVkbdBeStateChanged(XenbusState state)
 	}
 }
 
-void MockBackend::setVkbdFeState(XenbusState state)
+void MockBackend::setVkbdFeState(const Frontend& frontend, XenbusState state)
 {
-	LOG(mLog, DEBUG) << "Set vkbd FE state: " << state;
+	LOG(mLog, DEBUG) << "Set vkbd FE state, dom: " << frontend.domId
+					 << ", state: " << state;
 
 	if (state == XenbusStateInitialised)
 	{
-		XenStoreMock::writeValue(mVkbdFePath + "/event-channel", "5");
-		XenStoreMock::writeValue(mVkbdFePath + "/page-gref", "500");
+		XenStoreMock::writeValue(frontend.vkbdFePath + "/event-channel",
+								 to_string(2 * mNumConnectors + 3));
+		XenStoreMock::writeValue(frontend.vkbdFePath + "/page-gref", "500");
 	}
 
-	XenStoreMock::writeValue(mVkbdFePath + "/state", to_string(state));
+	XenStoreMock::writeValue(frontend.vkbdFePath + "/state", to_string(state));
 }
-
@@ -8,6 +8,8 @@
 #ifndef SRC_MOCKBACKEND_HPP_
 #define SRC_MOCKBACKEND_HPP_
 
+#include <vector>
+
 #include <XenStoreMock.hpp>
 
 #include <xen/be/Log.hpp>
@@ -21,30 +23,52 @@ extern "C" {
 class MockBackend
 {
 public:
-	MockBackend(domid_t beDomId, domid_t feDomId);
+	/**
+	 * @param beDomId       backend domain id
+	 * @param feDomId       domain id of the first frontend, other frontends
+	 *                      get following ids
+	 * @param numFrontends  number of frontend domains
+	 * @param numConnectors number of vdispl connectors of each frontend
+	 * @param width         connector width
+	 * @param height        connector height
+	 */
+	MockBackend(domid_t beDomId, domid_t feDomId, int numFrontends = 1,
+				int numConnectors = 1, uint32_t width = 800,
+				uint32_t height = 600);
 
 private:
+	static const int cMaxConnectors = 100;
+
+	struct Frontend
+	{
+		domid_t domId;
+
+		std::string vdisplFePath;
+		std::string vdisplBePath;
+
+		std::string vkbdFePath;
+		std::string vkbdBePath;
+	};
+
 	domid_t mBeDomId;
-	domid_t mFeDomId;
+	int mNumConnectors;
+	uint32_t mWidth;
+	uint32_t mHeight;
 	XenBackend::AsyncContext mAsync;
 	XenBackend::Log mLog;
 
-	std::string mVdisplFePath;
-	std::string mVdisplBePath;
-
-	std::string mVkbdFePath;
-	std::string mVkbdBePath;
+	std::vector<Frontend> mFrontends;
 
-	void setupVdispl();
-	void setupVkbd();
+	void setupVdispl(Frontend& frontend);
+	void setupVkbd(Frontend& frontend);
 
 	void onWriteXenStore(const std::string& path, const std::string& value);
 
-	void onVdisplBeStateChanged(XenbusState state);
-	void setVdisplFeState(XenbusState state);
+	void onVdisplBeStateChanged(const Frontend& frontend, XenbusState state);
+	void setVdisplFeState(const Frontend& frontend, XenbusState state);
 
-	void onVkbdBeStateChanged(XenbusState state);
-	void setVkbdFeState(XenbusState state);
+	void onVkbdBeStateChanged(const Frontend& frontend, XenbusState state);
+	void setVkbdFeState(const Frontend& frontend, XenbusState state);
 };
 
 #endif /* SRC_MOCKBACKEND_HPP_ */
@@ -0,0 +1,581 @@
+/*
+ *  Command trace replayer
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "TraceReplayer.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <sys/mman.h>
+
+#include <xen/be/Exception.hpp>
+#include <xen/be/XenGnttab.hpp>
+
+#include "PgDirSharedBuffer.hpp"
+#include "TrackingConnector.hpp"
+
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+using std::condition_variable;
+using std::dec;
+using std::endl;
+using std::fixed;
+using std::lock_guard;
+using std::make_pair;
+using std::map;
+using std::min;
+using std::move;
+using std::mutex;
+using std::ostream;
+using std::pair;
+using std::setprecision;
+using std::string;
+using std::thread;
+using std::unique_lock;
+using std::unordered_map;
+using std::vector;
+
+using XenBackend::XenGnttabBuffer;
+
+using DisplayItf::ConnectorPtr;
+using DisplayItf::DisplayPtr;
+
+namespace {
+
+// grant refs and ports of the replayer don't overlap ones of MockBackend
+// and the load generator
+const grant_ref_t cRefBase = 0x20000;
+const evtchn_port_t cPortBase = 0x2000;
+
+uint64_t getCpuTimeUs(const timeval& time)
+{
+	return time.tv_sec * 1000000ull + time.tv_usec;
+}
+
+}
+
+/*******************************************************************************
+ * TraceReplayer::Client
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * Replayed frontend connector.
+ ******************************************************************************/
+class TraceReplayer::Client
+{
+public:
+
+	Client(TraceReplayer& replayer, BuffersStoragePtr buffersStorage,
+		   const CommandTrace::Record& record, int index);
+
+	~Client();
+
+	void addRecord(CommandTrace::Record&& record)
+	{
+		mRecords.push_back(move(record));
+	}
+
+	void start();
+	void stop();
+
+private:
+
+	TraceReplayer& mReplayer;
+	domid_t mDomId;
+	int mConIndex;
+	XenBackend::Log mLog;
+
+	std::unique_ptr<DisplayCommandHandler> mHandler;
+	vector<CommandTrace::Record> mRecords;
+
+	// frontend buffers to restore sampled content to
+	unordered_map<uint64_t, xendispl_dbuf_create_req> mDisplayBuffers;
+	unordered_map<uint64_t, uint64_t> mFrameBuffers;
+
+	thread mThread;
+	mutex mMutex;
+	condition_variable mCondVar;
+	bool mTerminate;
+	bool mFlipPending;
+	uint64_t mFlipTime;
+
+	void run();
+	void replay(const CommandTrace::Record& record);
+	void trackBuffers(const xendispl_req& req);
+	void restoreSample(const CommandTrace::Record& record);
+	void onFlipDone();
+};
+
+TraceReplayer::Client::Client(TraceReplayer& replayer,
+							  BuffersStoragePtr buffersStorage,
+							  const CommandTrace::Record& record,
+							  int index) :
+	mReplayer(replayer),
+	mDomId(record.domId),
+	mConIndex(record.conIndex),
+	mLog("ReplayClient"),
+	mTerminate(false),
+	mFlipPending(false),
+	mFlipTime(0)
+{
+	ConnectorPtr connector(new TrackingConnector(
+			mReplayer.mDisplay->createConnector(mDomId, record.name,
+												record.width,
+												record.height),
+			[this] { onFlipDone(); }));
+
+	EventRingBufferPtr eventBuffer(new EventRingBuffer(
+			mConIndex, mDomId, cPortBase + index, cRefBase + index,
+			XENDISPL_IN_RING_OFFS, XENDISPL_IN_RING_SIZE,
+			mReplayer.mTimerQueue));
+
+	mHandler.reset(new DisplayCommandHandler(mReplayer.mDisplay, connector,
+											 buffersStorage, eventBuffer));
+}
+
+TraceReplayer::Client::~Client()
+{
+	stop();
+
+	// the display may still complete the pending flip
+	unique_lock<mutex> lock(mMutex);
+
+	mCondVar.wait_for(lock, std::chrono::milliseconds(100),
+					  [this] { return !mFlipPending; });
+}
+
+void TraceReplayer::Client::start()
+{
+	mTerminate = false;
+
+	mThread = thread(&Client::run, this);
+}
+
+void TraceReplayer::Client::stop()
+{
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		mTerminate = true;
+	}
+
+	mCondVar.notify_all();
+
+	if (mThread.joinable())
+	{
+		mThread.join();
+	}
+}
+
+void TraceReplayer::Client::run()
+{
+	try
+	{
+		unique_lock<mutex> lock(mMutex);
+
+		for (auto& record : mRecords)
+		{
+			mCondVar.wait_until(lock, mReplayer.mStartPoint +
+								microseconds(record.timeUs),
+								[this] { return mTerminate; });
+
+			if (mTerminate)
+			{
+				return;
+			}
+
+			lock.unlock();
+
+			replay(record);
+
+			lock.lock();
+		}
+	}
+	catch(const std::exception& e)
+	{
+		LOG(mLog, ERROR) << e.what();
+	}
+
+	mReplayer.onClientDone();
+}
+
+void TraceReplayer::Client::replay(const CommandTrace::Record& record)
+{
+	auto& req = record.req;
+
+	if (req.operation == XENDISPL_OP_PG_FLIP)
+	{
+		if (record.sample.size())
+		{
+			restoreSample(record);
+		}
+
+		lock_guard<mutex> lock(mMutex);
+
+		mFlipPending = true;
+		mFlipTime = Metrics::getTimeUs();
+	}
+
+	xendispl_resp rsp {};
+
+	auto start = Metrics::getTimeUs();
+
+	auto status = mHandler->processCommand(req, rsp);
+
+	mReplayer.mRequestLatency.add(Metrics::getTimeUs() - start);
+	mReplayer.mRecordedLatency.add(record.durationUs);
+	mReplayer.mRequests.add();
+
+	if (status != record.status)
+	{
+		LOG(mLog, WARNING) << "Status mismatch, dom: " << mDomId
+						   << ", connector: " << mConIndex
+						   << ", cmd: " << static_cast<int>(req.operation)
+						   << ", recorded: " << record.status
+						   << ", replayed: " << status;
+
+		mReplayer.mMismatches.add();
+	}
+
+	if (status)
+	{
+		if (req.operation == XENDISPL_OP_PG_FLIP)
+		{
+			lock_guard<mutex> lock(mMutex);
+
+			mFlipPending = false;
+		}
+
+		return;
+	}
+
+	trackBuffers(req);
+}
+
+void TraceReplayer::Client::trackBuffers(const xendispl_req& req)
+{
+	switch(req.operation)
+	{
+	case XENDISPL_OP_DBUF_CREATE:
+
+		mDisplayBuffers[req.op.dbuf_create.dbuf_cookie] = req.op.dbuf_create;
+
+		break;
+
+	case XENDISPL_OP_DBUF_DESTROY:
+
+		mDisplayBuffers.erase(req.op.dbuf_destroy.dbuf_cookie);
+
+		break;
+
+	case XENDISPL_OP_FB_ATTACH:
+
+		mFrameBuffers[req.op.fb_attach.fb_cookie] =
+				req.op.fb_attach.dbuf_cookie;
+
+		break;
+
+	case XENDISPL_OP_FB_DETACH:
+
+		mFrameBuffers.erase(req.op.fb_detach.fb_cookie);
+
+		break;
+
+	default:
+
+		break;
+	}
+}
+
+void TraceReplayer::Client::restoreSample(const CommandTrace::Record& record)
+{
+	auto fbIt = mFrameBuffers.find(record.req.op.pg_flip.fb_cookie);
+
+	if (fbIt == mFrameBuffers.end())
+	{
+		return;
+	}
+
+	auto dbIt = mDisplayBuffers.find(fbIt->second);
+
+	// refs of backend allocated buffers are not known to the frontend
+	if (dbIt == mDisplayBuffers.end() ||
+		dbIt->second.flags & XENDISPL_DBUF_FLG_REQ_ALLOC)
+	{
+		return;
+	}
+
+	auto& dbufReq = dbIt->second;
+
+	GrantRefs refs;
+
+	pgDirGetBufferRefs(mDomId, dbufReq.gref_directory, dbufReq.buffer_sz,
+					   refs);
+
+	XenGnttabBuffer buffer(mDomId, refs.data(), refs.size(),
+						   PROT_READ | PROT_WRITE, dbufReq.data_ofs);
+
+	// the sample has the backend stride, it matches the frontend one unless
+	// the display pads rows
+	memcpy(buffer.get(), record.sample.data(),
+		   min(buffer.size(), record.sample.size()));
+}
+
+void TraceReplayer::Client::onFlipDone()
+{
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		if (!mFlipPending)
+		{
+			return;
+		}
+
+		mFlipPending = false;
+
+		mReplayer.mFlipLatency.add(Metrics::getTimeUs() - mFlipTime);
+		mReplayer.mFlips.add();
+	}
+
+	mCondVar.notify_all();
+}
+
+/*******************************************************************************
+ * TraceReplayer
+ ******************************************************************************/
+
+TraceReplayer::TraceReplayer(DisplayPtr display, const string& path,
+							 FinishedCallback finished) :
+	mDisplay(display),
+	mTimerQueue(new TimerQueue()),
+	mPath(path),
+	mFinished(finished),
+	mLog("TraceReplayer"),
+	mNumActive(0),
+	mStartTime(0),
+	mStopTime(0),
+	mStartUsage {},
+	mStopUsage {},
+	mRequests(Metrics::Collector::getInstance().getCounter(
+			"replay.requests")),
+	mMismatches(Metrics::Collector::getInstance().getCounter(
+			"replay.status_mismatches")),
+	mFlips(Metrics::Collector::getInstance().getCounter("replay.flips")),
+	mRecordedLatency(Metrics::Collector::getInstance().getHistogram(
+			"replay.recorded_request_us")),
+	mRequestLatency(Metrics::Collector::getInstance().getHistogram(
+			"replay.request_us")),
+	mFlipLatency(Metrics::Collector::getInstance().getHistogram(
+			"replay.flip_latency_us"))
+{
+	try
+	{
+		init();
+	}
+	catch(const std::exception& e)
+	{
+		mClients.clear();
+
+		throw;
+	}
+}
+
+TraceReplayer::~TraceReplayer()
+{
+	stop();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void TraceReplayer::start()
+{
+	LOG(mLog, INFO) << "Start, trace: " << mPath
+					<< ", connectors: " << mClients.size();
+
+	mRequests.reset();
+	mMismatches.reset();
+	mFlips.reset();
+	mRecordedLatency.reset();
+	mRequestLatency.reset();
+	mFlipLatency.reset();
+
+	mNumActive = mClients.size();
+
+	mStartPoint = steady_clock::now();
+	mStartTime = Metrics::getTimeUs();
+	mStopTime = 0;
+
+	getrusage(RUSAGE_SELF, &mStartUsage);
+
+	for (auto& client : mClients)
+	{
+		client->start();
+	}
+}
+
+void TraceReplayer::stop()
+{
+	if (!mStartTime || mStopTime)
+	{
+		return;
+	}
+
+	mStopTime = Metrics::getTimeUs();
+
+	getrusage(RUSAGE_SELF, &mStopUsage);
+
+	for (auto& client : mClients)
+	{
+		client->stop();
+	}
+
+	LOG(mLog, INFO) << "Stop";
+}
+
+void TraceReplayer::report(ostream& stream)
+{
+	auto stopTime = mStopTime ? mStopTime : Metrics::getTimeUs();
+	auto stopUsage = mStopUsage;
+
+	if (!mStopTime)
+	{
+		getrusage(RUSAGE_SELF, &stopUsage);
+	}
+
+	auto requests = mRequests.get();
+	double seconds = (stopTime - mStartTime) / 1000000.0;
+
+	auto cpuUs = getCpuTimeUs(stopUsage.ru_utime) -
+				 getCpuTimeUs(mStartUsage.ru_utime) +
+				 getCpuTimeUs(stopUsage.ru_stime) -
+				 getCpuTimeUs(mStartUsage.ru_stime);
+
+	stream << dec << fixed << setprecision(1);
+
+	stream << "Replay: " << mPath << ", connectors: " << mClients.size()
+		   << ", time: " << seconds << " s" << endl;
+
+	stream << "Requests: " << requests
+		   << ", status mismatches: " << mMismatches.get()
+		   << ", flips: " << mFlips.get() << endl;
+
+	stream << "CPU per request, us: "
+		   << (requests ? static_cast<double>(cpuUs) / requests : 0) << endl;
+
+	// percentiles are upper bounds of power of two buckets
+	stream << "Recorded request, us: p50 <= "
+		   << mRecordedLatency.getPercentile(50)
+		   << ", p90 <= " << mRecordedLatency.getPercentile(90)
+		   << ", p99 <= " << mRecordedLatency.getPercentile(99)
+		   << ", max: " << mRecordedLatency.getMax() << endl;
+
+	stream << "Replayed request, us: p50 <= "
+		   << mRequestLatency.getPercentile(50)
+		   << ", p90 <= " << mRequestLatency.getPercentile(90)
+		   << ", p99 <= " << mRequestLatency.getPercentile(99)
+		   << ", max: " << mRequestLatency.getMax() << endl;
+
+	stream << "Flip latency, us: p50 <= " << mFlipLatency.getPercentile(50)
+		   << ", p90 <= " << mFlipLatency.getPercentile(90)
+		   << ", p99 <= " << mFlipLatency.getPercentile(99)
+		   << ", max: " << mFlipLatency.getMax() << endl;
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void TraceReplayer::init()
+{
+	CommandTrace::Reader reader(mPath);
+	CommandTrace::Record record;
+
+	map<pair<domid_t, uint16_t>, Client*> clients;
+	map<domid_t, BuffersStoragePtr> buffersStorages;
+
+	while(reader.read(record))
+	{
+		auto key = make_pair(record.domId, record.conIndex);
+
+		if (record.type == CommandTrace::RECORD_CONNECTOR)
+		{
+			if (clients.find(key) != clients.end())
+			{
+				throw XenBackend::Exception("Duplicated trace connector",
+											EINVAL);
+			}
+
+			// as in the backend, buffers are shared by connectors of a
+			// frontend
+			auto& buffersStorage = buffersStorages[record.domId];
+
+			if (!buffersStorage)
+			{
+				buffersStorage.reset(new BuffersStorage(record.domId,
+														mDisplay));
+			}
+
+			mClients.emplace_back(new Client(*this, buffersStorage, record,
+											 mClients.size()));
+
+			clients[key] = mClients.back().get();
+
+			continue;
+		}
+
+		auto it = clients.find(key);
+
+		if (it == clients.end())
+		{
+			throw XenBackend::Exception("Request of unknown trace connector",
+										EINVAL);
+		}
+
+		it->second->addRecord(move(record));
+	}
+
+	if (mClients.empty())
+	{
+		throw XenBackend::Exception("No connectors in trace: " + mPath,
+									EINVAL);
+	}
+}
+
+void TraceReplayer::onClientDone()
+{
+	if (--mNumActive == 0)
+	{
+		LOG(mLog, INFO) << "Trace is replayed";
+
+		if (mFinished)
+		{
+			mFinished();
+		}
+	}
+}
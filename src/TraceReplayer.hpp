@@ -0,0 +1,113 @@
+/*
+ *  Command trace replayer
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_TRACEREPLAYER_HPP_
+#define SRC_TRACEREPLAYER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <xen/be/Log.hpp>
+
+#include "CommandTrace.hpp"
+#include "DisplayCommandHandler.hpp"
+#include "Metrics.hpp"
+
+/***************************************************************************//**
+ * Replays a recorded command trace: each traced connector is recreated on
+ * the display and its requests are passed to the command handler at their
+ * recorded times. Sampled buffer content is written to the frontend buffer
+ * before the page flip. Event and grant table mappings are served by the
+ * mock backend library.
+ * @ingroup displ_be
+ ******************************************************************************/
+class TraceReplayer
+{
+public:
+
+	typedef std::function<void()> FinishedCallback;
+
+	/**
+	 * @param display  display object
+	 * @param path     trace file path
+	 * @param finished is called when all requests of the trace are replayed
+	 */
+	TraceReplayer(DisplayItf::DisplayPtr display, const std::string& path,
+				  FinishedCallback finished = nullptr);
+
+	~TraceReplayer();
+
+	/**
+	 * Starts replaying
+	 */
+	void start();
+
+	/**
+	 * Stops replaying and releases connectors
+	 */
+	void stop();
+
+	/**
+	 * Writes number of replayed requests, status mismatches and recorded
+	 * and replayed processing time percentiles
+	 * @param stream output stream
+	 */
+	void report(std::ostream& stream);
+
+private:
+
+	class Client;
+
+	DisplayItf::DisplayPtr mDisplay;
+	// batch deadlines of the client event rings
+	TimerQueuePtr mTimerQueue;
+	std::string mPath;
+	FinishedCallback mFinished;
+	XenBackend::Log mLog;
+
+	std::vector<std::unique_ptr<Client>> mClients;
+	std::atomic<size_t> mNumActive;
+
+	std::chrono::steady_clock::time_point mStartPoint;
+	uint64_t mStartTime;
+	uint64_t mStopTime;
+	rusage mStartUsage;
+	rusage mStopUsage;
+
+	Metrics::Counter& mRequests;
+	Metrics::Counter& mMismatches;
+	Metrics::Counter& mFlips;
+	Metrics::Histogram& mRecordedLatency;
+	Metrics::Histogram& mRequestLatency;
+	Metrics::Histogram& mFlipLatency;
+
+	void init();
+	void onClientDone();
+};
+
+#endif /* SRC_TRACEREPLAYER_HPP_ */
@@ -0,0 +1,84 @@
+/*
+ *  Tracking connector
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_TRACKINGCONNECTOR_HPP_
+#define SRC_TRACKINGCONNECTOR_HPP_
+
+#include "DisplayItf.hpp"
+
+/***************************************************************************//**
+ * Connector which reports flip completion to the owner instead of sending
+ * the flip event to the ring: simulated frontends don't consume events.
+ * @ingroup displ_be
+ ******************************************************************************/
+class TrackingConnector : public DisplayItf::Connector
+{
+public:
+
+	/**
+	 * @param connector connector to forward calls to
+	 * @param flipDone  is called when a flip is done
+	 */
+	TrackingConnector(DisplayItf::ConnectorPtr connector,
+					  FlipCallback flipDone) :
+		mConnector(connector),
+		mFlipDone(flipDone) {}
+
+	std::string getName() const override { return mConnector->getName(); }
+
+	bool isConnected() const override { return mConnector->isConnected(); }
+
+	bool isInitialized() const override
+	{
+		return mConnector->isInitialized();
+	}
+
+	bool isFlipPending() const override
+	{
+		return mConnector->isFlipPending();
+	}
+
+	void init(uint32_t width, uint32_t height,
+			  DisplayItf::FrameBufferPtr frameBuffer) override
+	{
+		mConnector->init(width, height, frameBuffer);
+	}
+
+	void release() override { mConnector->release(); }
+
+	void pageFlip(DisplayItf::FrameBufferPtr frameBuffer,
+				  FlipCallback cbk) override
+	{
+		mConnector->pageFlip(frameBuffer, mFlipDone);
+	}
+
+	size_t getEDID(grant_ref_t startDirectory, uint32_t size) const override
+	{
+		return mConnector->getEDID(startDirectory, size);
+	}
+
+private:
+
+	DisplayItf::ConnectorPtr mConnector;
+	FlipCallback mFlipDone;
+};
+
+#endif /* SRC_TRACKINGCONNECTOR_HPP_ */
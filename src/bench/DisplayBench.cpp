@@ -0,0 +1,468 @@
+/*
+ *  Display benchmarks
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <drm_fourcc.h>
+
+#include <benchmark/benchmark.h>
+
+#include <xen/be/Log.hpp>
+
+#include "BufferCopy.hpp"
+#include "displif.h"
+#include "Edid.hpp"
+
+#ifdef WITH_HEADLESS
+#include "BuffersStorage.hpp"
+#include "headless/Display.hpp"
+#endif
+
+#ifdef WITH_MOCKBELIB
+#include "DisplayCommandHandler.hpp"
+#include "PgDirSharedBuffer.hpp"
+#endif
+
+using std::make_shared;
+using std::mt19937;
+using std::uniform_int_distribution;
+using std::vector;
+
+namespace {
+
+const uint32_t cBpp = 32;
+const domid_t cDomId = 1;
+
+uint32_t getStride(uint32_t width)
+{
+	return 4 * ((width * cBpp + 31) / 32);
+}
+
+/*
+ * Common resolutions and padding of the backend stride in bytes, 0 means the
+ * backend stride matches the frontend one
+ */
+void copyArgs(benchmark::internal::Benchmark* bench)
+{
+	for (auto res : vector<vector<int64_t>>{{640, 480}, {1280, 720},
+											{1920, 1080}, {3840, 2160}})
+	{
+		for (int64_t padding : {0, 64})
+		{
+			bench->Args({res[0], res[1], padding});
+		}
+	}
+}
+
+void disableLog()
+{
+	XenBackend::Log::setLogMask("*:Disable");
+}
+
+}
+
+/*******************************************************************************
+ * Buffer copy
+ ******************************************************************************/
+
+/*
+ * Copy of the frontend buffer to the DRM dumb buffer: whole buffer at once
+ * when strides match, row by row otherwise.
+ */
+static void BM_DumbCopy(benchmark::State& state)
+{
+	uint32_t width = state.range(0);
+	uint32_t height = state.range(1);
+	auto srcStride = getStride(width);
+	auto dstStride = srcStride + state.range(2);
+
+	vector<uint8_t> src(srcStride * height, 0x55);
+	vector<uint8_t> dst(dstStride * height);
+
+	for (auto _ : state)
+	{
+		if (srcStride == dstStride)
+		{
+			memcpy(dst.data(), src.data(), dst.size());
+		}
+		else
+		{
+			BufferCopy::copyRows(dst.data(), dstStride, src.data(), srcStride,
+								 height);
+		}
+
+		benchmark::ClobberMemory();
+	}
+
+	state.SetBytesProcessed(state.iterations() * srcStride * height);
+}
+
+BENCHMARK(BM_DumbCopy)->Apply(copyArgs);
+
+/*
+ * Copy of the frontend buffer to the Wayland shared file: only changed spans
+ * of the rows are copied. Two source frames which differ in the given
+ * percentage of rows are copied in turn.
+ */
+static void BM_SharedFileCopy(benchmark::State& state)
+{
+	const size_t cChunkSize = 64;
+
+	uint32_t width = state.range(0);
+	uint32_t height = state.range(1);
+	uint32_t changedRows = height * state.range(2) / 100;
+	auto stride = getStride(width);
+
+	vector<uint8_t> frames[2] = {vector<uint8_t>(stride * height, 0x55),
+								 vector<uint8_t>(stride * height, 0x55)};
+	vector<uint8_t> dst(stride * height, 0x55);
+
+	// a window in the middle of the rows is changed
+	for (uint32_t row = 0; row < changedRows; row++)
+	{
+		memset(&frames[1][row * stride + stride / 4], 0xaa, stride / 2);
+	}
+
+	int frame = 0;
+
+	for (auto _ : state)
+	{
+		auto src = frames[frame].data();
+
+		for (uint32_t row = 0; row < height; row++)
+		{
+			size_t start, end;
+
+			BufferCopy::copyChangedSpan(dst.data() + row * stride,
+										src + row * stride, stride,
+										cChunkSize, start, end);
+		}
+
+		frame ^= 1;
+
+		benchmark::ClobberMemory();
+	}
+
+	state.SetBytesProcessed(state.iterations() * stride * height);
+}
+
+BENCHMARK(BM_SharedFileCopy)
+	->Args({1920, 1080, 0})
+	->Args({1920, 1080, 10})
+	->Args({1920, 1080, 100})
+	->Args({3840, 2160, 10})
+	->Args({3840, 2160, 100});
+
+/*******************************************************************************
+ * EDID
+ ******************************************************************************/
+
+/*
+ * EDID block generation as done on the first XENDISPL_OP_GET_EDID of
+ * a connector
+ */
+static void BM_EdidGenerate(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		auto data = Edid::create({Edid::getTiming(
+				1920, 1080, Edid::EDID_REFRESH_RATE_HZ * 1000, Edid::EDID_DPI)});
+
+		benchmark::DoNotOptimize(data.data());
+	}
+}
+
+BENCHMARK(BM_EdidGenerate);
+
+/*******************************************************************************
+ * BuffersStorage
+ ******************************************************************************/
+
+#ifdef WITH_HEADLESS
+/*
+ * Frame buffer lookup done for each page flip, with the given number of
+ * attached frame buffers
+ */
+static void BM_BuffersStorageLookup(benchmark::State& state)
+{
+	disableLog();
+
+	int numBuffers = state.range(0);
+
+	auto display = make_shared<Headless::Display>();
+	BuffersStorage storage(cDomId, display);
+
+	for (int i = 0; i < numBuffers; i++)
+	{
+		storage.createDisplayBuffer(i + 1, false, 0, 0, 64 * 64 * 4,
+									64, 64, cBpp);
+		storage.createFrameBuffer(i + 1, 0x10000 + i, 64, 64,
+								  DRM_FORMAT_XRGB8888);
+	}
+
+	mt19937 random;
+	uniform_int_distribution<int> distribution(0, numBuffers - 1);
+	vector<uint64_t> cookies(1024);
+
+	for (auto& cookie : cookies)
+	{
+		cookie = 0x10000 + distribution(random);
+	}
+
+	size_t index = 0;
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(storage.getFrameBufferAndCopy(
+				cookies[index++ % cookies.size()]));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_BuffersStorageLookup)->Arg(2)->Arg(64)->Arg(1024);
+#endif
+
+#ifdef WITH_MOCKBELIB
+/*******************************************************************************
+ * Page directory
+ ******************************************************************************/
+
+/*
+ * Reading buffer refs from the chain of page directories, buffer size in MiB.
+ * Directory pages are provided by the mock grant table.
+ */
+static void BM_PgDirGetBufferRefs(benchmark::State& state)
+{
+	disableLog();
+
+	const grant_ref_t cStartDirectory = 1000;
+	const size_t cRefsPerPage = (XC_PAGE_SIZE -
+		offsetof(xendispl_page_directory, gref)) / sizeof(grant_ref_t);
+
+	uint32_t size = state.range(0) * 1024 * 1024;
+	size_t numRefs = (size + XC_PAGE_SIZE - 1) / XC_PAGE_SIZE;
+	size_t numDirs = (numRefs + cRefsPerPage - 1) / cRefsPerPage;
+
+	for (size_t i = 0; i < numDirs; i++)
+	{
+		XenBackend::XenGnttabBuffer page(cDomId, cStartDirectory + i);
+
+		auto dir = static_cast<xendispl_page_directory*>(page.get());
+
+		dir->gref_dir_next_page = i + 1 < numDirs ? cStartDirectory + i + 1 : 0;
+
+		for (size_t j = 0; j < cRefsPerPage; j++)
+		{
+			dir->gref[j] = 0x10000 + i * cRefsPerPage + j;
+		}
+	}
+
+	GrantRefs refs;
+
+	for (auto _ : state)
+	{
+		pgDirGetBufferRefs(cDomId, cStartDirectory, size, refs);
+
+		benchmark::DoNotOptimize(refs.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * numRefs);
+}
+
+BENCHMARK(BM_PgDirGetBufferRefs)->Arg(1)->Arg(8)->Arg(32);
+
+#ifdef WITH_HEADLESS
+/*******************************************************************************
+ * DisplayCommandHandler
+ ******************************************************************************/
+
+namespace {
+
+struct CommandHandlerFixture
+{
+	CommandHandlerFixture() :
+		display(make_shared<Headless::Display>()),
+		storage(make_shared<BuffersStorage>(cDomId, display)),
+		handler(display,
+				display->createConnector(cDomId, "bench", 64, 64),
+				storage,
+				make_shared<EventRingBuffer>(0, cDomId, 1, 100,
+											 XENDISPL_IN_RING_OFFS,
+											 XENDISPL_IN_RING_SIZE))
+	{
+	}
+
+	int send(uint8_t operation, xendispl_req& req)
+	{
+		xendispl_resp rsp {};
+
+		req.operation = operation;
+
+		return handler.processCommand(req, rsp);
+	}
+
+	DisplayItf::DisplayPtr display;
+	BuffersStoragePtr storage;
+	DisplayCommandHandler handler;
+};
+
+}
+
+/*
+ * Dispatch of attach and detach frame buffer commands
+ */
+static void BM_CommandDispatch(benchmark::State& state)
+{
+	disableLog();
+
+	CommandHandlerFixture fixture;
+
+	xendispl_req req {};
+
+	req.op.dbuf_create.dbuf_cookie = 1;
+	req.op.dbuf_create.width = 64;
+	req.op.dbuf_create.height = 64;
+	req.op.dbuf_create.bpp = cBpp;
+	req.op.dbuf_create.buffer_sz = 64 * 64 * 4;
+
+	fixture.send(XENDISPL_OP_DBUF_CREATE, req);
+
+	xendispl_req attachReq {};
+
+	attachReq.op.fb_attach.dbuf_cookie = 1;
+	attachReq.op.fb_attach.fb_cookie = 2;
+	attachReq.op.fb_attach.width = 64;
+	attachReq.op.fb_attach.height = 64;
+	attachReq.op.fb_attach.pixel_format = DRM_FORMAT_XRGB8888;
+
+	xendispl_req detachReq {};
+
+	detachReq.op.fb_detach.fb_cookie = 2;
+
+	for (auto _ : state)
+	{
+		fixture.send(XENDISPL_OP_FB_ATTACH, attachReq);
+		fixture.send(XENDISPL_OP_FB_DETACH, detachReq);
+	}
+
+	state.SetItemsProcessed(state.iterations() * 2);
+}
+
+BENCHMARK(BM_CommandDispatch);
+
+/*
+ * Dispatch of the operation which is not supported
+ */
+static void BM_CommandDispatchUnknown(benchmark::State& state)
+{
+	disableLog();
+
+	CommandHandlerFixture fixture;
+
+	xendispl_req req {};
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(fixture.send(0xff, req));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_CommandDispatchUnknown);
+
+/*
+ * Requests rejected because of guest errors: 0 - page flip of unknown frame
+ * buffer, 1 - attach of unknown display buffer, 2 - page flip before the
+ * mode is set
+ */
+static void BM_CommandRejected(benchmark::State& state)
+{
+	disableLog();
+
+	CommandHandlerFixture fixture;
+
+	xendispl_req req {};
+
+	if (state.range(0) != 2)
+	{
+		req.op.dbuf_create.dbuf_cookie = 1;
+		req.op.dbuf_create.width = 64;
+		req.op.dbuf_create.height = 64;
+		req.op.dbuf_create.bpp = cBpp;
+		req.op.dbuf_create.buffer_sz = 64 * 64 * 4;
+
+		fixture.send(XENDISPL_OP_DBUF_CREATE, req);
+
+		req = {};
+
+		req.op.fb_attach.dbuf_cookie = 1;
+		req.op.fb_attach.fb_cookie = 2;
+		req.op.fb_attach.width = 64;
+		req.op.fb_attach.height = 64;
+		req.op.fb_attach.pixel_format = DRM_FORMAT_XRGB8888;
+
+		fixture.send(XENDISPL_OP_FB_ATTACH, req);
+
+		req = {};
+
+		req.op.set_config.fb_cookie = 2;
+		req.op.set_config.width = 64;
+		req.op.set_config.height = 64;
+		req.op.set_config.bpp = cBpp;
+
+		fixture.send(XENDISPL_OP_SET_CONFIG, req);
+	}
+
+	uint8_t operation = XENDISPL_OP_PG_FLIP;
+
+	req = {};
+
+	if (state.range(0) == 1)
+	{
+		operation = XENDISPL_OP_FB_ATTACH;
+
+		req.op.fb_attach.dbuf_cookie = 0xdead;
+		req.op.fb_attach.fb_cookie = 3;
+		req.op.fb_attach.width = 64;
+		req.op.fb_attach.height = 64;
+		req.op.fb_attach.pixel_format = DRM_FORMAT_XRGB8888;
+	}
+	else
+	{
+		req.op.pg_flip.fb_cookie = 0xdead;
+	}
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(fixture.send(operation, req));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_CommandRejected)->Arg(0)->Arg(1)->Arg(2);
+#endif
+#endif
@@ -0,0 +1,297 @@
+/*
+ *  Input benchmarks
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+
+#include <linux/uinput.h>
+
+#include <benchmark/benchmark.h>
+
+#include <xen/be/Exception.hpp>
+
+#include "Metrics.hpp"
+#include "input/DevInput.hpp"
+
+using std::atomic;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+using InputItf::PointerCallbacks;
+
+/*******************************************************************************
+ * UInputDevice
+ ******************************************************************************/
+
+/*
+ * Relative pointer created with uinput. Its /dev/input node is read by
+ * DevInput as a real device.
+ */
+class UInputDevice
+{
+public:
+
+	UInputDevice(int index) :
+		mFd(-1)
+	{
+		try
+		{
+			init(index);
+		}
+		catch(const std::exception& e)
+		{
+			release();
+
+			throw;
+		}
+	}
+
+	~UInputDevice()
+	{
+		release();
+	}
+
+	const string& getNode() const { return mNode; }
+
+	void emitFrames(int numFrames)
+	{
+		vector<input_event> events;
+
+		for (int i = 0; i < numFrames; i++)
+		{
+			events.push_back(makeEvent(EV_REL, REL_X, 1));
+			events.push_back(makeEvent(EV_REL, REL_Y, -1));
+			events.push_back(makeEvent(EV_SYN, SYN_REPORT, 0));
+		}
+
+		auto size = events.size() * sizeof(input_event);
+
+		if (write(mFd, events.data(), size) != static_cast<ssize_t>(size))
+		{
+			throw XenBackend::Exception("Can't write uinput events", errno);
+		}
+	}
+
+private:
+
+	const int cNodeTimeoutMs = 1000;
+
+	int mFd;
+	string mNode;
+
+	static input_event makeEvent(uint16_t type, uint16_t code, int32_t value)
+	{
+		input_event event {};
+
+		event.type = type;
+		event.code = code;
+		event.value = value;
+
+		return event;
+	}
+
+	void init(int index)
+	{
+		mFd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+
+		if (mFd < 0)
+		{
+			throw XenBackend::Exception("Can't open /dev/uinput", errno);
+		}
+
+		ioctl(mFd, UI_SET_EVBIT, EV_KEY);
+		ioctl(mFd, UI_SET_KEYBIT, BTN_LEFT);
+		ioctl(mFd, UI_SET_EVBIT, EV_REL);
+		ioctl(mFd, UI_SET_RELBIT, REL_X);
+		ioctl(mFd, UI_SET_RELBIT, REL_Y);
+
+		uinput_setup setup {};
+
+		setup.id.bustype = BUS_VIRTUAL;
+		setup.id.vendor = 0x1234;
+		setup.id.product = 0x5678;
+		snprintf(setup.name, UINPUT_MAX_NAME_SIZE, "displ_be bench %d",
+				 index);
+
+		if (ioctl(mFd, UI_DEV_SETUP, &setup) < 0 ||
+			ioctl(mFd, UI_DEV_CREATE) < 0)
+		{
+			throw XenBackend::Exception("Can't create uinput device", errno);
+		}
+
+		mNode = findNode();
+	}
+
+	void release()
+	{
+		if (mFd >= 0)
+		{
+			ioctl(mFd, UI_DEV_DESTROY);
+			close(mFd);
+		}
+	}
+
+	string findNode()
+	{
+		char sysName[64] = {};
+
+		if (ioctl(mFd, UI_GET_SYSNAME(sizeof(sysName)), sysName) < 0)
+		{
+			throw XenBackend::Exception("Can't get uinput sysname", errno);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		// the node is created by udev asynchronously
+		while(std::chrono::steady_clock::now() - start <
+			  std::chrono::milliseconds(cNodeTimeoutMs))
+		{
+			auto node = findEventNode(string("/sys/devices/virtual/input/") +
+									  sysName);
+
+			if (!node.empty() && access(node.c_str(), R_OK) == 0)
+			{
+				return node;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		throw XenBackend::Exception("Can't find uinput node", ENOENT);
+	}
+
+	static string findEventNode(const string& sysPath)
+	{
+		string node;
+
+		auto dir = opendir(sysPath.c_str());
+
+		if (!dir)
+		{
+			return node;
+		}
+
+		while(auto entry = readdir(dir))
+		{
+			if (strncmp(entry->d_name, "event", 5) == 0)
+			{
+				node = string("/dev/input/") + entry->d_name;
+
+				break;
+			}
+		}
+
+		closedir(dir);
+
+		return node;
+	}
+};
+
+/*******************************************************************************
+ * Benchmarks
+ ******************************************************************************/
+
+/*
+ * Event storm from several pointers at once. Measures time until all frames
+ * are delivered to the pointer callbacks and reactor wake ups per frame.
+ */
+static void BM_DevInputStorm(benchmark::State& state)
+{
+	const int cFramesPerDevice = 100;
+	const auto cDeliveryTimeout = std::chrono::seconds(1);
+
+	auto numDevices = state.range(0);
+
+	atomic<int64_t> frames(0);
+	vector<unique_ptr<UInputDevice>> devices;
+	vector<unique_ptr<DevInput<PointerCallbacks>>> inputs;
+
+	try
+	{
+		for (int i = 0; i < numDevices; i++)
+		{
+			devices.emplace_back(new UInputDevice(i));
+
+			inputs.emplace_back(
+					new DevInput<PointerCallbacks>(devices.back()->getNode()));
+
+			inputs.back()->setCallbacks({
+				[](int32_t, int32_t, int32_t) {},
+				nullptr,
+				nullptr,
+				[&frames]() { frames++; },
+			});
+		}
+	}
+	catch(const std::exception& e)
+	{
+		state.SkipWithError(e.what());
+
+		return;
+	}
+
+	auto& wakeups = Metrics::Collector::getInstance().getCounter(
+			"input.reactor_wakeups");
+	auto startWakeups = wakeups.get();
+	int64_t expected = 0;
+
+	for (auto _ : state)
+	{
+		expected += numDevices * cFramesPerDevice;
+
+		for (auto& device : devices)
+		{
+			device->emitFrames(cFramesPerDevice);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		while(frames < expected)
+		{
+			if (std::chrono::steady_clock::now() - start > cDeliveryTimeout)
+			{
+				state.SkipWithError("Frames are not delivered");
+
+				break;
+			}
+
+			std::this_thread::yield();
+		}
+	}
+
+	state.SetItemsProcessed(expected);
+	state.counters["wakeups_per_frame"] =
+			static_cast<double>(wakeups.get() - startWakeups) / expected;
+	state.counters["devices"] = numDevices;
+}
+
+BENCHMARK(BM_DevInputStorm)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
@@ -0,0 +1,105 @@
+/*
+ *  Ring writer benchmarks
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "MpscQueue.hpp"
+
+using std::lock_guard;
+using std::mutex;
+using std::vector;
+
+/*******************************************************************************
+ * Benchmarks
+ ******************************************************************************/
+
+namespace {
+
+const size_t cQueueSize = 256;
+
+struct Event
+{
+	uint8_t data[40];
+};
+
+MpscQueue<Event> gQueue(cQueueSize);
+mutex gQueueMutex;
+vector<Event> gLockedQueue;
+
+}
+
+/*
+ * Producers stage events into the lock free queue, thread 0 consumes them
+ * like the ring writer does.
+ */
+static void BM_MpscQueueStage(benchmark::State& state)
+{
+	Event event {};
+	int64_t staged = 0;
+
+	for (auto _ : state)
+	{
+		if (gQueue.push(event))
+		{
+			staged++;
+		}
+
+		if (state.thread_index() == 0)
+		{
+			while(gQueue.pop(event))
+			{
+			}
+		}
+	}
+
+	state.SetItemsProcessed(staged);
+}
+
+BENCHMARK(BM_MpscQueueStage)->ThreadRange(1, 8)->UseRealTime();
+
+/*
+ * The same load with producers serialized on a mutex, as RingBufferOutBase
+ * does.
+ */
+static void BM_LockedQueueStage(benchmark::State& state)
+{
+	Event event {};
+
+	for (auto _ : state)
+	{
+		lock_guard<mutex> lock(gQueueMutex);
+
+		gLockedQueue.push_back(event);
+
+		if (state.thread_index() == 0 || gLockedQueue.size() >= cQueueSize)
+		{
+			gLockedQueue.clear();
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_LockedQueueStage)->ThreadRange(1, 8)->UseRealTime();
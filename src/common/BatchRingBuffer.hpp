@@ -0,0 +1,521 @@
+/*
+ *  Batch ring buffer
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_COMMON_BATCHRINGBUFFER_HPP_
+#define SRC_COMMON_BATCHRINGBUFFER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <xenctrl.h>
+}
+
+#include <xen/be/Log.hpp>
+#include <xen/be/RingBufferBase.hpp>
+
+#include "Metrics.hpp"
+#include "MpscQueue.hpp"
+#include "TimerQueue.hpp"
+
+/***************************************************************************//**
+ * Out ring buffer which publishes events in batches. Events are queued and
+ * written to the ring with one producer index update and one event channel
+ * notification on flush or when the batch deadline expires. Batch deadlines
+ * of all rings are served by a shared timer queue.
+ *
+ * Producers don't serialize on a lock: events are staged in a lock free queue
+ * and the producer which gets the writer role moves the staged events of all
+ * producers to the ring. Producers which don't get the role return at once.
+ *
+ * When coalescing is enabled and the ring fill level reaches the threshold,
+ * new events are merged into the queued ones by coalesceEvent() and the queue
+ * is held until the ring drains or the latency budget expires.
+ *
+ * When the ring has no room for all queued events, the oldest events accepted
+ * by isDroppable() are dropped. Other events are kept and retried on the next
+ * batch deadline. If the frontend doesn't consume events and the queue grows
+ * above cMaxQueuedRings rings, the oldest queued events are dropped.
+ ******************************************************************************/
+template<typename Page, typename Event>
+class BatchRingBufferOut : public XenBackend::RingBufferBase
+{
+public:
+
+	/**
+	 * @param domId      frontend domain id
+	 * @param port       event channel port number
+	 * @param ref        grant table reference
+	 * @param offset     start of the ring buffer inside the page
+	 * @param size       size of the ring buffer
+	 * @param timeoutMs  max time queued events wait for flush
+	 * @param timerQueue timer queue of batch deadlines, nullptr - own queue
+	 */
+	BatchRingBufferOut(domid_t domId, evtchn_port_t port, grant_ref_t ref,
+					   size_t offset, size_t size, uint32_t timeoutMs,
+					   TimerQueuePtr timerQueue) :
+		RingBufferBase(domId, port, ref),
+		mPage(static_cast<Page*>(mBuffer.get())),
+		mEvents(reinterpret_cast<uint8_t*>(mPage) + offset),
+		mNumEvents(size / sizeof(Event)),
+		mTimeout(timeoutMs),
+		mDropped(0),
+		mOverflow(false),
+		mCoalesceThreshold(0),
+		mBudget(0),
+		mHolding(false),
+		mBatchLog("BatchRingBuffer"),
+		mNotifications(Metrics::Collector::getInstance().getCounter(
+				"ring.notifications")),
+		mBatchSize(Metrics::Collector::getInstance().getHistogram(
+				"ring.batch_events")),
+		mCoalesced(Metrics::Collector::getInstance().getCounter(
+				"ring.coalesced_events")),
+		mDroppedEvents(Metrics::Collector::getInstance().getCounter(
+				"ring.dropped_events")),
+		mStaging(cStagingSize),
+		mFlushRequest(false),
+		mTimerQueue(timerQueue ? timerQueue : std::make_shared<TimerQueue>())
+	{
+	}
+
+	~BatchRingBufferOut()
+	{
+		stopTimer();
+	}
+
+	/**
+	 * Enables events coalescing
+	 * @param threshold ring fill level in percents to start coalescing
+	 * @param budgetMs  max time coalesced events are held in the queue
+	 */
+	void setCoalescing(uint32_t threshold, uint32_t budgetMs)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		mCoalesceThreshold = std::max(mNumEvents * threshold / 100, 1u);
+		mBudget = std::chrono::milliseconds(budgetMs);
+	}
+
+	/**
+	 * Queues event. It is sent on the next flush or when the batch deadline
+	 * expires.
+	 * @param event   event
+	 * @param timeUs  event source time, 0 - unknown
+	 * @param latency histogram to collect source to publish latency
+	 */
+	void queueEvent(const Event& event, uint64_t timeUs = 0,
+					Metrics::Histogram* latency = nullptr)
+	{
+		stage({event, timeUs, latency});
+
+		process();
+	}
+
+	/**
+	 * Sends all queued events
+	 */
+	void flush()
+	{
+		mFlushRequest = true;
+
+		process();
+	}
+
+	/**
+	 * Queues event and sends all queued events
+	 * @param event   event
+	 * @param timeUs  event source time, 0 - unknown
+	 * @param latency histogram to collect source to publish latency
+	 */
+	void sendEvent(const Event& event, uint64_t timeUs = 0,
+				   Metrics::Histogram* latency = nullptr)
+	{
+		stage({event, timeUs, latency});
+
+		flush();
+	}
+
+protected:
+
+	void onReceiveIndication() override {}
+
+	/**
+	 * Cancels the batch deadline and waits for its running flush. Shall be
+	 * called by the derived class destructor as the flush calls virtual
+	 * methods.
+	 */
+	void stopTimer()
+	{
+		mTimerQueue->cancel(this);
+	}
+
+	/**
+	 * Is called when the ring is busy to merge new event into the queued
+	 * events.
+	 * @param queue queued events, not empty
+	 * @param event new event
+	 * @return <i>true</i> if the event is merged and shall not be queued
+	 */
+	virtual bool coalesceEvent(std::vector<Event>& queue, const Event& event)
+	{
+		return false;
+	}
+
+	/**
+	 * Is called when the ring has no room for the queued events.
+	 * @param event queued event
+	 * @return <i>true</i> if the event may be dropped
+	 */
+	virtual bool isDroppable(const Event& event)
+	{
+		return false;
+	}
+
+private:
+
+	static const size_t cStagingSize = 256;
+	static const size_t cMaxQueuedRings = 4;
+
+	struct Item
+	{
+		Event event;
+		uint64_t timeUs;
+		Metrics::Histogram* latency;
+	};
+
+	struct Timestamp
+	{
+		uint64_t timeUs;
+		Metrics::Histogram* latency;
+	};
+
+	Page* mPage;
+	uint8_t* mEvents;
+	uint32_t mNumEvents;
+	std::chrono::milliseconds mTimeout;
+	uint64_t mDropped;
+	bool mOverflow;
+	uint32_t mCoalesceThreshold;
+	std::chrono::milliseconds mBudget;
+	bool mHolding;
+	XenBackend::Log mBatchLog;
+
+	Metrics::Counter& mNotifications;
+	Metrics::Histogram& mBatchSize;
+	Metrics::Counter& mCoalesced;
+	Metrics::Counter& mDroppedEvents;
+
+	MpscQueue<Item> mStaging;
+	std::atomic_bool mFlushRequest;
+
+	// writer state, the writer role is taken with try_lock
+	std::mutex mMutex;
+	std::vector<Event> mQueue;
+	// source times of the queued events, merged events keep the oldest one
+	std::vector<Timestamp> mTimestamps;
+	std::chrono::steady_clock::time_point mDeadline;
+	std::chrono::steady_clock::time_point mArmedDeadline;
+	std::chrono::steady_clock::time_point mHoldEnd;
+
+	TimerQueuePtr mTimerQueue;
+
+	void stage(const Item& item)
+	{
+		while(!mStaging.push(item))
+		{
+			// the writer is behind, help it to drain the staging queue
+			process();
+
+			std::this_thread::yield();
+		}
+	}
+
+	void process()
+	{
+		// a producer which fails to take the writer role leaves its events
+		// to the current writer, which checks for them after releasing
+		while(mMutex.try_lock())
+		{
+			write();
+
+			mMutex.unlock();
+
+			if (!mFlushRequest && mStaging.empty())
+			{
+				break;
+			}
+		}
+	}
+
+	void write()
+	{
+		auto flush = mFlushRequest.exchange(false);
+
+		Item item;
+
+		while(mStaging.pop(item))
+		{
+			addEvent(item);
+
+			// the frontend can't get more events at once anyway
+			if (mQueue.size() >= mNumEvents)
+			{
+				publish();
+			}
+		}
+
+		if (flush)
+		{
+			publish();
+		}
+
+		if (!mQueue.empty() && mDeadline != mArmedDeadline)
+		{
+			mArmedDeadline = mDeadline;
+
+			armTimer(mDeadline);
+		}
+	}
+
+	bool isRingBusy()
+	{
+		return mCoalesceThreshold &&
+			   mPage->in_prod - mPage->in_cons >= mCoalesceThreshold;
+	}
+
+	void addEvent(const Item& item)
+	{
+		if (mQueue.empty())
+		{
+			mDeadline = std::chrono::steady_clock::now() + mTimeout;
+		}
+		else if (isRingBusy() && coalesceEvent(mQueue, item.event))
+		{
+			mCoalesced.add();
+
+			return;
+		}
+
+		mQueue.push_back(item.event);
+		mTimestamps.push_back({item.timeUs, item.latency});
+
+		if (mQueue.size() > cMaxQueuedRings * mNumEvents)
+		{
+			trimQueue();
+		}
+	}
+
+	void trimQueue()
+	{
+		size_t maxSize = cMaxQueuedRings * mNumEvents;
+
+		// droppable events go first, then the oldest ones: a frontend which
+		// doesn't consume events shall not grow the queue without limit
+		dropEvents(mQueue.size() - maxSize);
+
+		if (mQueue.size() <= maxSize)
+		{
+			return;
+		}
+
+		size_t count = mQueue.size() - maxSize;
+
+		if (!mOverflow)
+		{
+			LOG(mBatchLog, ERROR) << "Frontend doesn't consume events, "
+								  << "drop queued events";
+
+			mOverflow = true;
+		}
+
+		mQueue.erase(mQueue.begin(), mQueue.begin() + count);
+		mTimestamps.erase(mTimestamps.begin(), mTimestamps.begin() + count);
+
+		mDroppedEvents.add(count);
+	}
+
+	void publish()
+	{
+		if (mQueue.empty())
+		{
+			return;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+
+		if (isRingBusy())
+		{
+			if (!mHolding)
+			{
+				mHolding = true;
+				mHoldEnd = now + mBudget;
+			}
+
+			// hold the queue to coalesce more events while the frontend
+			// drains the ring, but not longer than the latency budget
+			if (now < mHoldEnd)
+			{
+				mDeadline = std::min(now + mTimeout, mHoldEnd);
+
+				return;
+			}
+		}
+
+		mHolding = false;
+
+		auto prod = mPage->in_prod;
+		auto cons = mPage->in_cons;
+
+		xen_mb();
+
+		uint32_t space = mNumEvents - (prod - cons);
+
+		if (space < mQueue.size())
+		{
+			dropEvents(mQueue.size() - space);
+		}
+		else
+		{
+			mDropped = 0;
+		}
+
+		uint32_t written = std::min<size_t>(space, mQueue.size());
+
+		for (uint32_t i = 0; i < written; i++)
+		{
+			memcpy(mEvents + (prod % mNumEvents) * sizeof(Event),
+				   &mQueue[i], sizeof(Event));
+
+			prod++;
+		}
+
+		if (written)
+		{
+			// events shall be visible before the producer index
+			xen_wmb();
+
+			mPage->in_prod = prod;
+
+			mEventChannel.notify();
+
+			mNotifications.add();
+			mBatchSize.add(written);
+
+			collectLatency(written);
+		}
+
+		mQueue.erase(mQueue.begin(), mQueue.begin() + written);
+		mTimestamps.erase(mTimestamps.begin(), mTimestamps.begin() + written);
+
+		if (!mQueue.empty())
+		{
+			// not droppable events wait until the frontend frees the ring
+			mDeadline = now + mTimeout;
+		}
+		else
+		{
+			mOverflow = false;
+		}
+	}
+
+	void dropEvents(size_t count)
+	{
+		size_t dropped = 0;
+		size_t kept = 0;
+
+		// the oldest droppable events go first, order of the rest is kept
+		for (size_t i = 0; i < mQueue.size(); i++)
+		{
+			if (dropped < count && isDroppable(mQueue[i]))
+			{
+				dropped++;
+
+				continue;
+			}
+
+			mQueue[kept] = mQueue[i];
+			mTimestamps[kept] = mTimestamps[i];
+
+			kept++;
+		}
+
+		mQueue.resize(kept);
+		mTimestamps.resize(kept);
+
+		if (dropped && !mDropped)
+		{
+			LOG(mBatchLog, WARNING) << "Ring buffer is full, drop events";
+		}
+
+		mDropped += dropped;
+		mDroppedEvents.add(dropped);
+	}
+
+	void collectLatency(uint32_t written)
+	{
+		uint64_t nowUs = 0;
+
+		for (uint32_t i = 0; i < written; i++)
+		{
+			auto& timestamp = mTimestamps[i];
+
+			if (!timestamp.latency || !timestamp.timeUs)
+			{
+				continue;
+			}
+
+			if (!nowUs)
+			{
+				nowUs = Metrics::getTimeUs();
+			}
+
+			if (nowUs > timestamp.timeUs)
+			{
+				timestamp.latency->add(nowUs - timestamp.timeUs);
+			}
+		}
+	}
+
+	void armTimer(std::chrono::steady_clock::time_point deadline)
+	{
+		auto now = std::chrono::steady_clock::now();
+		uint64_t delayUs = 0;
+
+		if (deadline > now)
+		{
+			delayUs = std::chrono::duration_cast<std::chrono::microseconds>(
+					deadline - now).count();
+		}
+
+		// rescheduling replaces the previous deadline of the ring
+		mTimerQueue->schedule(this, Metrics::getTimeUs() + delayUs,
+							  [this] { flush(); });
+	}
+};
+
+#endif /* SRC_COMMON_BATCHRINGBUFFER_HPP_ */
@@ -0,0 +1,264 @@
+/*
+ *  Metrics
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "Metrics.hpp"
+
+#include <ctime>
+
+using std::lock_guard;
+using std::memory_order_relaxed;
+using std::mutex;
+using std::string;
+
+namespace Metrics {
+
+/*******************************************************************************
+ * Histogram
+ ******************************************************************************/
+
+Histogram::Histogram()
+{
+	reset();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void Histogram::add(uint64_t value)
+{
+	int bucket = value ? 64 - __builtin_clzll(value) : 0;
+
+	if (bucket >= cNumBuckets)
+	{
+		bucket = cNumBuckets - 1;
+	}
+
+	mBuckets[bucket].fetch_add(1, memory_order_relaxed);
+	mCount.fetch_add(1, memory_order_relaxed);
+	mSum.fetch_add(value, memory_order_relaxed);
+
+	auto max = mMax.load(memory_order_relaxed);
+
+	while (value > max &&
+		   !mMax.compare_exchange_weak(max, value, memory_order_relaxed));
+}
+
+uint64_t Histogram::getCount() const
+{
+	return mCount.load(memory_order_relaxed);
+}
+
+uint64_t Histogram::getSum() const
+{
+	return mSum.load(memory_order_relaxed);
+}
+
+uint64_t Histogram::getMax() const
+{
+	return mMax.load(memory_order_relaxed);
+}
+
+uint64_t Histogram::getPercentile(double percentile) const
+{
+	uint64_t total = 0;
+
+	for (int i = 0; i < cNumBuckets; i++)
+	{
+		total += mBuckets[i].load(memory_order_relaxed);
+	}
+
+	if (total == 0)
+	{
+		return 0;
+	}
+
+	uint64_t rank = static_cast<uint64_t>(total * percentile / 100.0);
+	uint64_t accumulated = 0;
+
+	for (int i = 0; i < cNumBuckets; i++)
+	{
+		accumulated += mBuckets[i].load(memory_order_relaxed);
+
+		if (accumulated > rank || accumulated == total)
+		{
+			auto bound = i ? (1ull << i) - 1 : 0;
+
+			return bound < getMax() ? bound : getMax();
+		}
+	}
+
+	return getMax();
+}
+
+void Histogram::reset()
+{
+	for (int i = 0; i < cNumBuckets; i++)
+	{
+		mBuckets[i].store(0, memory_order_relaxed);
+	}
+
+	mCount.store(0, memory_order_relaxed);
+	mSum.store(0, memory_order_relaxed);
+	mMax.store(0, memory_order_relaxed);
+}
+
+/*******************************************************************************
+ * Collector
+ ******************************************************************************/
+
+Collector::Collector() :
+	mLog("Metrics")
+{
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+Collector& Collector::getInstance()
+{
+	static Collector sInstance;
+
+	return sInstance;
+}
+
+Counter& Collector::getCounter(const string& name)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	auto& counter = mCounters[name];
+
+	if (!counter)
+	{
+		counter.reset(new Counter());
+	}
+
+	return *counter;
+}
+
+Histogram& Collector::getHistogram(const string& name)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	auto& histogram = mHistograms[name];
+
+	if (!histogram)
+	{
+		histogram.reset(new Histogram());
+	}
+
+	return *histogram;
+}
+
+Gauge& Collector::getGauge(const string& name)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	auto& gauge = mGauges[name];
+
+	if (!gauge)
+	{
+		gauge.reset(new Gauge());
+	}
+
+	return *gauge;
+}
+
+void Collector::dump()
+{
+	lock_guard<mutex> lock(mMutex);
+
+	for (auto& counter : mCounters)
+	{
+		LOG(mLog, INFO) << counter.first << ": " << counter.second->get();
+	}
+
+	for (auto& item : mHistograms)
+	{
+		auto& histogram = *item.second;
+		auto count = histogram.getCount();
+
+		LOG(mLog, INFO) << item.first
+						<< ": count: " << count
+						<< ", avg: " << (count ? histogram.getSum() / count : 0)
+						<< ", p50: " << histogram.getPercentile(50)
+						<< ", p90: " << histogram.getPercentile(90)
+						<< ", p99: " << histogram.getPercentile(99)
+						<< ", max: " << histogram.getMax();
+	}
+
+	for (auto& gauge : mGauges)
+	{
+		LOG(mLog, INFO) << gauge.first << ": " << gauge.second->get()
+						<< ", max: " << gauge.second->getMax();
+	}
+}
+
+void Collector::reset()
+{
+	lock_guard<mutex> lock(mMutex);
+
+	for (auto& counter : mCounters)
+	{
+		counter.second->reset();
+	}
+
+	for (auto& histogram : mHistograms)
+	{
+		histogram.second->reset();
+	}
+
+	for (auto& gauge : mGauges)
+	{
+		gauge.second->reset();
+	}
+}
+
+/*******************************************************************************
+ * Functions
+ ******************************************************************************/
+
+uint64_t getTimeUs()
+{
+	return getTimeUs(CLOCK_MONOTONIC);
+}
+
+uint64_t getTimeUs(int clockId)
+{
+	timespec ts {};
+
+	clock_gettime(static_cast<clockid_t>(clockId), &ts);
+
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000ull + ts.tv_nsec / 1000;
+}
+
+uint64_t getTimeUsFromMs(uint32_t timeMs)
+{
+	auto nowUs = getTimeUs();
+
+	// the timestamp wraps around each 49 days, take the low 32 bits of now
+	uint64_t ageUs = static_cast<uint32_t>(nowUs / 1000 - timeMs) * 1000ull;
+
+	return ageUs < nowUs ? nowUs - ageUs : 0;
+}
+
+}
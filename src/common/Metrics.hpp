@@ -0,0 +1,261 @@
+/*
+ *  Metrics
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_COMMON_METRICS_HPP_
+#define SRC_COMMON_METRICS_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <xen/be/Log.hpp>
+
+/***************************************************************************//**
+ * @defgroup metrics Metrics
+ * Local counters and histograms which are dumped to the log on request.
+ ******************************************************************************/
+
+namespace Metrics {
+
+/***************************************************************************//**
+ * Monotonic event counter.
+ * @ingroup metrics
+ ******************************************************************************/
+class Counter
+{
+public:
+
+	Counter() : mValue(0) {}
+
+	/**
+	 * Increments the counter
+	 * @param value value to add
+	 */
+	void add(uint64_t value = 1)
+	{
+		mValue.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Returns current counter value
+	 */
+	uint64_t get() const { return mValue.load(std::memory_order_relaxed); }
+
+	/**
+	 * Resets the counter
+	 */
+	void reset() { mValue.store(0, std::memory_order_relaxed); }
+
+private:
+
+	std::atomic<uint64_t> mValue;
+};
+
+/***************************************************************************//**
+ * Current value of a resource usage, e.g. allocated bytes, with its peak.
+ * @ingroup metrics
+ ******************************************************************************/
+class Gauge
+{
+public:
+
+	Gauge() : mValue(0), mMax(0) {}
+
+	/**
+	 * Increases the value
+	 * @param value value to add
+	 */
+	void add(uint64_t value)
+	{
+		auto current = mValue.fetch_add(value, std::memory_order_relaxed) +
+					   value;
+		auto max = mMax.load(std::memory_order_relaxed);
+
+		while (current > max &&
+			   !mMax.compare_exchange_weak(max, current,
+										   std::memory_order_relaxed));
+	}
+
+	/**
+	 * Decreases the value
+	 * @param value value to subtract
+	 */
+	void sub(uint64_t value)
+	{
+		mValue.fetch_sub(value, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Returns current value
+	 */
+	uint64_t get() const { return mValue.load(std::memory_order_relaxed); }
+
+	/**
+	 * Returns peak value since the last reset
+	 */
+	uint64_t getMax() const { return mMax.load(std::memory_order_relaxed); }
+
+	/**
+	 * Resets the peak to the current value
+	 */
+	void reset() { mMax.store(get(), std::memory_order_relaxed); }
+
+private:
+
+	std::atomic<uint64_t> mValue;
+	std::atomic<uint64_t> mMax;
+};
+
+/***************************************************************************//**
+ * Histogram with power of two buckets. Values are unit-less, callers use
+ * the metric name to specify the unit (e.g. "_us" suffix for microseconds).
+ * Adding a value is lock-free and allocation-free.
+ * @ingroup metrics
+ ******************************************************************************/
+class Histogram
+{
+public:
+
+	static const int cNumBuckets = 48;
+
+	Histogram();
+
+	/**
+	 * Adds value to the histogram
+	 * @param value value
+	 */
+	void add(uint64_t value);
+
+	/**
+	 * Returns number of added values
+	 */
+	uint64_t getCount() const;
+
+	/**
+	 * Returns sum of added values
+	 */
+	uint64_t getSum() const;
+
+	/**
+	 * Returns max added value
+	 */
+	uint64_t getMax() const;
+
+	/**
+	 * Returns upper bound of the bucket which contains the percentile
+	 * @param percentile percentile in range 0..100
+	 */
+	uint64_t getPercentile(double percentile) const;
+
+	/**
+	 * Resets the histogram
+	 */
+	void reset();
+
+private:
+
+	std::atomic<uint64_t> mBuckets[cNumBuckets];
+	std::atomic<uint64_t> mCount;
+	std::atomic<uint64_t> mSum;
+	std::atomic<uint64_t> mMax;
+};
+
+/***************************************************************************//**
+ * Registry of named counters and histograms. References returned by the
+ * getters stay valid for the process lifetime, so the hot path should look up
+ * a metric once and keep the reference.
+ * @ingroup metrics
+ ******************************************************************************/
+class Collector
+{
+public:
+
+	/**
+	 * Returns collector instance
+	 */
+	static Collector& getInstance();
+
+	/**
+	 * Returns counter with specified name, creates it if not exist
+	 * @param name counter name
+	 */
+	Counter& getCounter(const std::string& name);
+
+	/**
+	 * Returns histogram with specified name, creates it if not exist
+	 * @param name histogram name
+	 */
+	Histogram& getHistogram(const std::string& name);
+
+	/**
+	 * Returns gauge with specified name, creates it if not exist
+	 * @param name gauge name
+	 */
+	Gauge& getGauge(const std::string& name);
+
+	/**
+	 * Writes all metrics to the log
+	 */
+	void dump();
+
+	/**
+	 * Resets all metrics
+	 */
+	void reset();
+
+private:
+
+	Collector();
+	Collector(const Collector&) = delete;
+	Collector& operator=(const Collector&) = delete;
+
+	std::mutex mMutex;
+	XenBackend::Log mLog;
+
+	std::map<std::string, std::unique_ptr<Counter>> mCounters;
+	std::map<std::string, std::unique_ptr<Histogram>> mHistograms;
+	std::map<std::string, std::unique_ptr<Gauge>> mGauges;
+};
+
+/**
+ * Returns monotonic time in microseconds
+ */
+uint64_t getTimeUs();
+
+/**
+ * Returns time of the specified clock in microseconds
+ * @param clockId clock id as accepted by clock_gettime()
+ */
+uint64_t getTimeUs(int clockId);
+
+/**
+ * Converts 32-bit monotonic timestamp in milliseconds, as used in Wayland input
+ * events, to getTimeUs() time
+ * @param timeMs timestamp in milliseconds
+ */
+uint64_t getTimeUsFromMs(uint32_t timeMs);
+
+}
+
+#endif /* SRC_COMMON_METRICS_HPP_ */
@@ -0,0 +1,159 @@
+/*
+ *  Multi producer single consumer queue
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_COMMON_MPSCQUEUE_HPP_
+#define SRC_COMMON_MPSCQUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/***************************************************************************//**
+ * Bounded lock free queue with many producers and a single consumer.
+ *
+ * Each cell carries a sequence number which tells whether the cell is free
+ * for the producer of the given position or holds a value for the consumer.
+ * Producers reserve positions with a CAS on the tail, the consumer owns the
+ * head exclusively.
+ ******************************************************************************/
+template<typename T>
+class MpscQueue
+{
+public:
+
+	/**
+	 * @param size queue size, rounded up to a power of two
+	 */
+	explicit MpscQueue(size_t size) :
+		mSize(roundUp(size)),
+		mMask(mSize - 1),
+		mCells(new Cell[mSize]),
+		mTail(0),
+		mHead(0)
+	{
+		for (size_t i = 0; i < mSize; i++)
+		{
+			mCells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * Adds value to the queue. May be called from any thread.
+	 * @param value value
+	 * @return <i>false</i> if the queue is full
+	 */
+	bool push(const T& value)
+	{
+		auto pos = mTail.load(std::memory_order_relaxed);
+
+		while(true)
+		{
+			auto& cell = mCells[pos & mMask];
+			auto sequence = cell.sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<intptr_t>(sequence) -
+						static_cast<intptr_t>(pos);
+
+			if (diff == 0)
+			{
+				if (mTail.compare_exchange_weak(pos, pos + 1,
+												std::memory_order_relaxed))
+				{
+					cell.value = value;
+					cell.sequence.store(pos + 1, std::memory_order_release);
+
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = mTail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * Takes value from the queue. Shall be called by one thread at a time.
+	 * @param value taken value
+	 * @return <i>false</i> if the queue is empty
+	 */
+	bool pop(T& value)
+	{
+		auto pos = mHead.load(std::memory_order_relaxed);
+		auto& cell = mCells[pos & mMask];
+
+		if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+		{
+			return false;
+		}
+
+		value = cell.value;
+		cell.sequence.store(pos + mSize, std::memory_order_release);
+
+		mHead.store(pos + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/**
+	 * Checks if there is a value published for the consumer. May be called
+	 * from any thread.
+	 */
+	bool empty() const
+	{
+		auto pos = mHead.load(std::memory_order_acquire);
+
+		return mCells[pos & mMask].sequence.load(
+				std::memory_order_acquire) != pos + 1;
+	}
+
+private:
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	const size_t mSize;
+	const size_t mMask;
+	std::unique_ptr<Cell[]> mCells;
+	std::atomic<size_t> mTail;
+	std::atomic<size_t> mHead;
+
+	static size_t roundUp(size_t size)
+	{
+		size_t result = 1;
+
+		while(result < size)
+		{
+			result <<= 1;
+		}
+
+		return result;
+	}
+};
+
+#endif /* SRC_COMMON_MPSCQUEUE_HPP_ */
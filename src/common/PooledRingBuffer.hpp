@@ -0,0 +1,271 @@
+/*
+ *  Pooled ring buffer
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_COMMON_POOLEDRINGBUFFER_HPP_
+#define SRC_COMMON_POOLEDRINGBUFFER_HPP_
+
+#include <atomic>
+#include <cstring>
+
+#include <poll.h>
+
+extern "C" {
+#include <xenctrl.h>
+#include <xenevtchn.h>
+}
+
+#include <xen/be/Exception.hpp>
+#include <xen/be/Log.hpp>
+#include <xen/be/RingBufferBase.hpp>
+#include <xen/be/XenGnttab.hpp>
+
+#include "RingWorkerPool.hpp"
+
+/***************************************************************************//**
+ * In ring buffer which event channel is served by a ring worker pool instead
+ * of a dedicated thread. Derived classes shall call stop() in the destructor
+ * as processRequest() may be running in a worker.
+ ******************************************************************************/
+template<typename Ring, typename SRing, typename Req, typename Rsp>
+class PooledRingBufferIn : public XenBackend::RingBufferItf
+{
+public:
+
+	/**
+	 * @param pool  ring worker pool
+	 * @param domId frontend domain id
+	 * @param port  event channel port number
+	 * @param ref   grant table reference
+	 */
+	PooledRingBufferIn(RingWorkerPoolPtr pool, domid_t domId,
+					   evtchn_port_t port, grant_ref_t ref) :
+		mPool(pool),
+		mDomId(domId),
+		mPort(port),
+		mRef(ref),
+		mHandle(nullptr),
+		mLocalPort(0),
+		mStarted(false),
+		mTerminated(false),
+		mBuffer(domId, ref),
+		mPoolLog("PooledRingBuffer")
+	{
+		try
+		{
+			init();
+		}
+		catch(const std::exception& e)
+		{
+			release();
+
+			throw;
+		}
+	}
+
+	~PooledRingBufferIn()
+	{
+		stop();
+		release();
+	}
+
+	void start() override
+	{
+		if (mStarted)
+		{
+			return;
+		}
+
+		// requests may be queued before the channel is served, ones queued
+		// later leave the event channel readable
+		processRequests();
+
+		mPool->addChannel(xenevtchn_fd(mHandle), [this] { onEvent(); });
+
+		mStarted = true;
+	}
+
+	void stop() override
+	{
+		if (!mStarted)
+		{
+			return;
+		}
+
+		mPool->removeChannel(xenevtchn_fd(mHandle));
+
+		mStarted = false;
+	}
+
+	bool isTerminated() override { return mTerminated; }
+
+	evtchn_port_t getPort() const override { return mPort; }
+
+	grant_ref_t getRef() const override { return mRef; }
+
+protected:
+
+	/**
+	 * Is called in a pool worker for each received request. Requests of the
+	 * ring are processed one at a time.
+	 * @param req request
+	 */
+	virtual void processRequest(const Req& req) = 0;
+
+	/**
+	 * Sends response to the frontend
+	 * @param rsp response
+	 */
+	void sendResponse(const Rsp& rsp)
+	{
+		memcpy(RING_GET_RESPONSE(&mRing, mRing.rsp_prod_pvt), &rsp,
+			   sizeof(rsp));
+
+		mRing.rsp_prod_pvt++;
+
+		int notify = 0;
+
+		RING_PUSH_RESPONSES_AND_CHECK_NOTIFY(&mRing, notify);
+
+		if (notify)
+		{
+			xenevtchn_notify(mHandle, mLocalPort);
+		}
+	}
+
+private:
+
+	RingWorkerPoolPtr mPool;
+	domid_t mDomId;
+	evtchn_port_t mPort;
+	grant_ref_t mRef;
+	xenevtchn_handle* mHandle;
+	evtchn_port_t mLocalPort;
+	bool mStarted;
+	std::atomic_bool mTerminated;
+	XenBackend::XenGnttabBuffer mBuffer;
+	Ring mRing;
+	XenBackend::Log mPoolLog;
+
+	void init()
+	{
+		mHandle = xenevtchn_open(nullptr, 0);
+
+		if (!mHandle)
+		{
+			throw XenBackend::Exception("Can't open event channel", errno);
+		}
+
+		auto localPort = xenevtchn_bind_interdomain(mHandle, mDomId, mPort);
+
+		if (localPort < 0)
+		{
+			throw XenBackend::Exception("Can't bind event channel", errno);
+		}
+
+		mLocalPort = localPort;
+
+		BACK_RING_INIT(&mRing, static_cast<SRing*>(mBuffer.get()),
+					   XC_PAGE_SIZE);
+
+		LOG(mPoolLog, DEBUG) << "Create, dom: " << mDomId
+							 << ", port: " << mPort << ", ref: " << mRef;
+	}
+
+	void release()
+	{
+		if (!mHandle)
+		{
+			return;
+		}
+
+		if (mLocalPort)
+		{
+			xenevtchn_unbind(mHandle, mLocalPort);
+		}
+
+		xenevtchn_close(mHandle);
+
+		mHandle = nullptr;
+	}
+
+	void onEvent()
+	{
+		// the event channel read blocks, don't let a stale wake up stall
+		// the worker
+		pollfd fd { xenevtchn_fd(mHandle), POLLIN, 0 };
+
+		if (poll(&fd, 1, 0) <= 0)
+		{
+			return;
+		}
+
+		auto port = xenevtchn_pending(mHandle);
+
+		if (port < 0)
+		{
+			LOG(mPoolLog, ERROR) << "Can't get pending port, dom: " << mDomId
+								 << ", error: " << errno;
+
+			mTerminated = true;
+
+			return;
+		}
+
+		xenevtchn_unmask(mHandle, port);
+
+		processRequests();
+	}
+
+	void processRequests()
+	{
+		int numPending = 0;
+
+		do
+		{
+			auto cons = mRing.req_cons;
+			auto prod = mRing.sring->req_prod;
+
+			// requests shall be read after the producer index
+			xen_rmb();
+
+			while(cons != prod)
+			{
+				if (RING_REQUEST_CONS_OVERFLOW(&mRing, cons))
+				{
+					break;
+				}
+
+				Req req;
+
+				memcpy(&req, RING_GET_REQUEST(&mRing, cons), sizeof(req));
+
+				mRing.req_cons = ++cons;
+
+				processRequest(req);
+			}
+
+			RING_FINAL_CHECK_FOR_REQUESTS(&mRing, numPending);
+		}
+		while(numPending);
+	}
+};
+
+#endif /* SRC_COMMON_POOLEDRINGBUFFER_HPP_ */
@@ -0,0 +1,281 @@
+/*
+ *  Ring worker pool
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "RingWorkerPool.hpp"
+
+#include <algorithm>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <xen/be/Exception.hpp>
+
+using std::lock_guard;
+using std::make_shared;
+using std::mutex;
+using std::thread;
+using std::unique_lock;
+
+/*******************************************************************************
+ * RingWorkerPool
+ ******************************************************************************/
+
+RingWorkerPool::RingWorkerPool(size_t numWorkers) :
+	mLog("RingWorkerPool"),
+	mEpollFd(-1),
+	mEventFd(-1),
+	mDispatches(Metrics::Collector::getInstance().getCounter(
+			"ring.pool_dispatches"))
+{
+	try
+	{
+		init(numWorkers);
+	}
+	catch(const std::exception& e)
+	{
+		release();
+
+		throw;
+	}
+}
+
+RingWorkerPool::~RingWorkerPool()
+{
+	release();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void RingWorkerPool::addChannel(int fd, Callback callback)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	if (mChannels.find(fd) != mChannels.end())
+	{
+		throw XenBackend::Exception("Channel already added", EEXIST);
+	}
+
+	epoll_event event {};
+
+	event.events = EPOLLIN | EPOLLONESHOT;
+	event.data.fd = fd;
+
+	if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+	{
+		throw XenBackend::Exception("Can't add channel to epoll", errno);
+	}
+
+	mChannels[fd] = make_shared<Channel>(Channel{callback, false, false});
+
+	LOG(mLog, DEBUG) << "Add channel, fd: " << fd
+					 << ", channels: " << mChannels.size();
+}
+
+void RingWorkerPool::removeChannel(int fd)
+{
+	unique_lock<mutex> lock(mMutex);
+
+	auto it = mChannels.find(fd);
+
+	if (it == mChannels.end())
+	{
+		return;
+	}
+
+	auto channel = it->second;
+
+	channel->removed = true;
+
+	epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+
+	// wait for the worker which is running the callback
+	mCondVar.wait(lock, [&channel] { return !channel->busy; });
+
+	mChannels.erase(fd);
+
+	LOG(mLog, DEBUG) << "Remove channel, fd: " << fd
+					 << ", channels: " << mChannels.size();
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void RingWorkerPool::init(size_t numWorkers)
+{
+	if (!numWorkers)
+	{
+		numWorkers = std::max(thread::hardware_concurrency(), 1u);
+	}
+
+	mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (mEpollFd < 0)
+	{
+		throw XenBackend::Exception("Can't create epoll", errno);
+	}
+
+	mEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+	if (mEventFd < 0)
+	{
+		throw XenBackend::Exception("Can't create event fd", errno);
+	}
+
+	// level triggered: once signaled it wakes up all workers
+	epoll_event event {};
+
+	event.events = EPOLLIN;
+	event.data.fd = mEventFd;
+
+	if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mEventFd, &event) < 0)
+	{
+		throw XenBackend::Exception("Can't add event fd to epoll", errno);
+	}
+
+	for (size_t i = 0; i < numWorkers; i++)
+	{
+		mWorkers.emplace_back(&RingWorkerPool::run, this);
+	}
+
+	LOG(mLog, DEBUG) << "Create, workers: " << numWorkers;
+}
+
+void RingWorkerPool::release()
+{
+	if (mEventFd >= 0)
+	{
+		uint64_t value = 1;
+
+		if (write(mEventFd, &value, sizeof(value)) != sizeof(value))
+		{
+			LOG(mLog, ERROR) << "Can't wake up workers";
+		}
+	}
+
+	for (auto& worker : mWorkers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+	if (mEventFd >= 0)
+	{
+		close(mEventFd);
+	}
+
+	if (mEpollFd >= 0)
+	{
+		close(mEpollFd);
+	}
+}
+
+void RingWorkerPool::run()
+{
+	while(true)
+	{
+		epoll_event event {};
+
+		// one event per wait, other ready channels go to other workers
+		auto num = epoll_wait(mEpollFd, &event, 1, -1);
+
+		if (num < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			LOG(mLog, ERROR) << "Epoll wait error: " << errno;
+
+			return;
+		}
+
+		if (num == 0)
+		{
+			continue;
+		}
+
+		if (event.data.fd == mEventFd)
+		{
+			return;
+		}
+
+		dispatch(event.data.fd);
+	}
+}
+
+void RingWorkerPool::dispatch(int fd)
+{
+	std::shared_ptr<Channel> channel;
+
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		auto it = mChannels.find(fd);
+
+		if (it == mChannels.end() || it->second->removed)
+		{
+			return;
+		}
+
+		channel = it->second;
+		channel->busy = true;
+	}
+
+	mDispatches.add();
+
+	try
+	{
+		channel->callback();
+	}
+	catch(const std::exception& e)
+	{
+		LOG(mLog, ERROR) << "Channel fd: " << fd << ", " << e.what();
+	}
+
+	lock_guard<mutex> lock(mMutex);
+
+	channel->busy = false;
+
+	if (channel->removed)
+	{
+		mCondVar.notify_all();
+
+		return;
+	}
+
+	epoll_event event {};
+
+	event.events = EPOLLIN | EPOLLONESHOT;
+	event.data.fd = fd;
+
+	if (epoll_ctl(mEpollFd, EPOLL_CTL_MOD, fd, &event) < 0)
+	{
+		LOG(mLog, ERROR) << "Can't rearm channel fd: " << fd
+						 << ", error: " << errno;
+	}
+}
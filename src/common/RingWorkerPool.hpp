@@ -0,0 +1,109 @@
+/*
+ *  Ring worker pool
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_COMMON_RINGWORKERPOOL_HPP_
+#define SRC_COMMON_RINGWORKERPOOL_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <xen/be/Log.hpp>
+
+#include "Metrics.hpp"
+
+/***************************************************************************//**
+ * Pool of worker threads which serves event channels of many ring buffers
+ * over one epoll instance.
+ *
+ * A channel is dispatched to one worker at a time: its fd is armed in one shot
+ * mode and rearmed when the callback returns. Thus requests of one ring are
+ * processed in order while different rings are processed in parallel.
+ ******************************************************************************/
+class RingWorkerPool
+{
+public:
+
+	/**
+	 * Callback which is called when the channel fd is readable
+	 */
+	typedef std::function<void()> Callback;
+
+	/**
+	 * @param numWorkers number of worker threads, 0 - number of CPUs
+	 */
+	explicit RingWorkerPool(size_t numWorkers = 0);
+	~RingWorkerPool();
+
+	/**
+	 * Starts serving the channel
+	 * @param fd       event channel file descriptor
+	 * @param callback channel callback
+	 */
+	void addChannel(int fd, Callback callback);
+
+	/**
+	 * Stops serving the channel. The channel callback is not called after
+	 * this function returns. Shall not be called from the channel callback.
+	 * @param fd event channel file descriptor
+	 */
+	void removeChannel(int fd);
+
+	/**
+	 * Returns number of worker threads
+	 */
+	size_t getNumWorkers() const { return mWorkers.size(); }
+
+private:
+
+	struct Channel
+	{
+		Callback callback;
+		bool busy;
+		bool removed;
+	};
+
+	XenBackend::Log mLog;
+
+	int mEpollFd;
+	int mEventFd;
+
+	Metrics::Counter& mDispatches;
+
+	std::mutex mMutex;
+	std::condition_variable mCondVar;
+	std::map<int, std::shared_ptr<Channel>> mChannels;
+	std::vector<std::thread> mWorkers;
+
+	void init(size_t numWorkers);
+	void release();
+
+	void run();
+	void dispatch(int fd);
+};
+
+typedef std::shared_ptr<RingWorkerPool> RingWorkerPoolPtr;
+
+#endif /* SRC_COMMON_RINGWORKERPOOL_HPP_ */
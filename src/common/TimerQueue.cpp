@@ -0,0 +1,176 @@
+/*
+ *  Timer queue
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "TimerQueue.hpp"
+
+#include <chrono>
+
+#include "Metrics.hpp"
+
+using std::chrono::microseconds;
+using std::lock_guard;
+using std::make_pair;
+using std::move;
+using std::mutex;
+using std::thread;
+using std::unique_lock;
+
+/*******************************************************************************
+ * TimerQueue
+ ******************************************************************************/
+
+TimerQueue::TimerQueue() :
+	mLog("TimerQueue"),
+	mRunning(nullptr),
+	mTerminate(false)
+{
+	try
+	{
+		init();
+	}
+	catch(const std::exception& e)
+	{
+		release();
+
+		throw;
+	}
+}
+
+TimerQueue::~TimerQueue()
+{
+	release();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void TimerQueue::schedule(const void* owner, uint64_t timeUs,
+						  Callback callback)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	removeUnlocked(owner);
+
+	mEntries[owner] = {timeUs, move(callback)};
+	mQueue.insert(make_pair(timeUs, owner));
+
+	mCondVar.notify_all();
+}
+
+void TimerQueue::cancel(const void* owner)
+{
+	unique_lock<mutex> lock(mMutex);
+
+	// the running callback may schedule its owner again, remove it after
+	while (mRunning == owner)
+	{
+		mCondVar.wait(lock);
+	}
+
+	removeUnlocked(owner);
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void TimerQueue::init()
+{
+	mThread = thread(&TimerQueue::run, this);
+}
+
+void TimerQueue::release()
+{
+	if (mThread.joinable())
+	{
+		{
+			lock_guard<mutex> lock(mMutex);
+
+			mTerminate = true;
+
+			mCondVar.notify_all();
+		}
+
+		mThread.join();
+	}
+}
+
+void TimerQueue::run()
+{
+	unique_lock<mutex> lock(mMutex);
+
+	while (!mTerminate)
+	{
+		if (mQueue.empty())
+		{
+			mCondVar.wait(lock);
+
+			continue;
+		}
+
+		auto first = *mQueue.begin();
+		auto nowUs = Metrics::getTimeUs();
+
+		if (first.first > nowUs)
+		{
+			mCondVar.wait_for(lock, microseconds(first.first - nowUs));
+
+			continue;
+		}
+
+		auto it = mEntries.find(first.second);
+		auto callback = move(it->second.callback);
+
+		mQueue.erase(mQueue.begin());
+		mEntries.erase(it);
+
+		mRunning = first.second;
+
+		lock.unlock();
+
+		try
+		{
+			callback();
+		}
+		catch(const std::exception& e)
+		{
+			LOG(mLog, ERROR) << e.what();
+		}
+
+		lock.lock();
+
+		mRunning = nullptr;
+
+		mCondVar.notify_all();
+	}
+}
+
+void TimerQueue::removeUnlocked(const void* owner)
+{
+	auto it = mEntries.find(owner);
+
+	if (it != mEntries.end())
+	{
+		mQueue.erase(make_pair(it->second.timeUs, owner));
+		mEntries.erase(it);
+	}
+}
@@ -0,0 +1,95 @@
+/*
+ *  Timer queue
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_COMMON_TIMERQUEUE_HPP_
+#define SRC_COMMON_TIMERQUEUE_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+
+#include <xen/be/Log.hpp>
+
+/***************************************************************************//**
+ * Calls callbacks at their due time from one thread.
+ *
+ * Each owner has at most one scheduled callback: scheduling it again replaces
+ * the previous one. Callbacks are called without the queue lock held, so they
+ * may schedule their owner again.
+ ******************************************************************************/
+class TimerQueue
+{
+public:
+
+	typedef std::function<void()> Callback;
+
+	TimerQueue();
+	~TimerQueue();
+
+	/**
+	 * Schedules the callback
+	 * @param owner    owner of the callback
+	 * @param timeUs   due time, monotonic clock in microseconds
+	 * @param callback callback
+	 */
+	void schedule(const void* owner, uint64_t timeUs, Callback callback);
+
+	/**
+	 * Cancels the scheduled callback of the owner. The callback is not called
+	 * after this function returns. Shall not be called from the callback.
+	 * @param owner owner of the callback
+	 */
+	void cancel(const void* owner);
+
+private:
+
+	struct Entry
+	{
+		uint64_t timeUs;
+		Callback callback;
+	};
+
+	XenBackend::Log mLog;
+
+	std::mutex mMutex;
+	std::condition_variable mCondVar;
+	std::set<std::pair<uint64_t, const void*>> mQueue;
+	std::map<const void*, Entry> mEntries;
+	const void* mRunning;
+	bool mTerminate;
+	std::thread mThread;
+
+	void init();
+	void release();
+
+	void run();
+	void removeUnlocked(const void* owner);
+};
+
+typedef std::shared_ptr<TimerQueue> TimerQueuePtr;
+
+#endif /* SRC_COMMON_TIMERQUEUE_HPP_ */
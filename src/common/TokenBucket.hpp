@@ -0,0 +1,102 @@
+/*
+ *  Token bucket
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_COMMON_TOKENBUCKET_HPP_
+#define SRC_COMMON_TOKENBUCKET_HPP_
+
+#include <cstdint>
+
+/***************************************************************************//**
+ * Token bucket which limits rate of events.
+ *
+ * The bucket is kept as the time when it is full again: each taken token
+ * moves this time one period forward and a token is available while the time
+ * is less than the burst of periods ahead. The bucket is not thread safe.
+ ******************************************************************************/
+class TokenBucket
+{
+public:
+
+	/**
+	 * @param rate  tokens per second, 0 - unlimited
+	 * @param burst number of tokens which may be taken at once
+	 */
+	explicit TokenBucket(uint32_t rate = 0, uint32_t burst = 1) :
+		mPeriodUs(rate ? cUsPerSec / rate : 0),
+		mBurstUs(static_cast<uint64_t>(burst ? burst - 1 : 0) * mPeriodUs),
+		mFullTime(0) {}
+
+	/**
+	 * Returns true if the rate is limited
+	 */
+	bool isLimited() const { return mPeriodUs; }
+
+	/**
+	 * Takes a token
+	 * @param nowUs current time in microseconds
+	 * @return false if there is no token available
+	 */
+	bool take(uint64_t nowUs)
+	{
+		if (!mPeriodUs)
+		{
+			return true;
+		}
+
+		if (mFullTime < nowUs)
+		{
+			mFullTime = nowUs;
+		}
+
+		if (mFullTime - nowUs > mBurstUs)
+		{
+			return false;
+		}
+
+		mFullTime += mPeriodUs;
+
+		return true;
+	}
+
+	/**
+	 * Returns time in microseconds until a token is available
+	 * @param nowUs current time in microseconds
+	 */
+	uint64_t getWaitUs(uint64_t nowUs) const
+	{
+		if (!mPeriodUs || mFullTime <= nowUs + mBurstUs)
+		{
+			return 0;
+		}
+
+		return mFullTime - mBurstUs - nowUs;
+	}
+
+private:
+
+	static const uint64_t cUsPerSec = 1000000;
+
+	uint64_t mPeriodUs;
+	uint64_t mBurstUs;
+	uint64_t mFullTime;
+};
+
+#endif /* SRC_COMMON_TOKENBUCKET_HPP_ */
@@ -20,15 +20,18 @@
 
 #include "BuffersStorage.hpp"
 
+#include <algorithm>
+#include <cstdint>
 #include <iomanip>
 #include <vector>
 
-#include <drm_fourcc.h>
-
 #include <xen/be/Exception.hpp>
 
+#include "PixelFormat.hpp"
+
 using std::hex;
 using std::lock_guard;
+using std::max;
 using std::move;
 using std::mutex;
 using std::setfill;
@@ -44,12 +47,13 @@ using DisplayItf::FrameBufferPtr;
  * BuffersStorage
  ******************************************************************************/
 
-BuffersStorage::BuffersStorage(domid_t domId, DisplayPtr display) :
+BuffersStorage::BuffersStorage(domid_t domId, DisplayPtr display,
+							   uint64_t quota) :
 	mDomId(domId),
 	mDisplay(display),
+	mAccount(MemoryAccount::getAccount(domId, quota)),
 	mLog("BuffersStorage")
 {
-
 }
 
 BuffersStorage::~BuffersStorage()
@@ -60,70 +64,76 @@ BuffersStorage::~BuffersStorage()
 
 	mDisplayBuffers.clear();
 	mPendingDisplayBuffers.clear();
+
+	for (auto& charged : mChargedSizes)
+	{
+		mAccount->uncharge(charged.second);
+	}
 }
 
 /*******************************************************************************
  * Public
  ******************************************************************************/
 
-void BuffersStorage::createDisplayBuffer(uint64_t dbCookie, bool beAllocRefs,
-										 grant_ref_t startDirectory,
-										 size_t offset, uint32_t size,
-										 uint32_t width, uint32_t height,
-										 uint32_t bpp)
+int BuffersStorage::createDisplayBuffer(uint64_t dbCookie, bool beAllocRefs,
+										grant_ref_t startDirectory,
+										size_t offset, uint32_t size,
+										uint32_t width, uint32_t height,
+										uint32_t bpp)
 {
-	lock_guard<mutex> lock(mMutex);
+	if (width == 0 && beAllocRefs)
+	{
+		DLOG(mLog, ERROR) << "Can't create pending display buffer";
 
-	GrantRefs refs;
+		return -EINVAL;
+	}
 
-	if (!beAllocRefs)
+	lock_guard<mutex> lock(mMutex);
+
+	// the reused cookie would be charged twice and its buffer leaked
+	if (findDisplayBufferUnlocked(dbCookie) ||
+		mPendingDisplayBuffers.count(dbCookie))
 	{
-		pgDirGetBufferRefs(mDomId, startDirectory, size, refs);
+		DLOG(mLog, ERROR) << "Display buffer cookie already exists";
+
+		return -EEXIST;
 	}
 
-	if (width == 0)
-	{
-		if (beAllocRefs)
-		{
-			throw XenBackend::Exception("Can't create pending display buffer",
-										EINVAL);
-		}
+	uint64_t allocSize;
 
-		DLOG(mLog, DEBUG) << "Create pending display buffer, start dir: "
-						  << startDirectory
-						  << ", size: " << size << ", offset: " << offset
-						  << ", DB cookie: 0x"
-						  << hex << setfill('0') << setw(16)
-						  << dbCookie;
+	if (!getAllocSize(width, height, bpp, allocSize))
+	{
+		DLOG(mLog, ERROR) << "Display buffer is too big";
 
-		mPendingDisplayBuffers.emplace(dbCookie, PendingBuffer{offset, refs});
+		return -EINVAL;
 	}
-	else
+
+	// the frontend size may be less than the buffer the display allocates
+	if (!chargeUnlocked(dbCookie, max<uint64_t>(size, allocSize)))
 	{
-		DLOG(mLog, DEBUG) << "Create display buffer, w: "
-						  << width << ", h: " << height << ", bpp: " << bpp
-						  << ", offset: " << offset
-						  << ", start dir: " << startDirectory
-						  << ", size: " << size << ", DB cookie: 0x"
-						  << hex << setfill('0') << setw(16)
-						  << dbCookie;
+		DLOG(mLog, ERROR) << "Display buffer quota is exceeded";
 
-		auto displayBuffer = mDisplay->createDisplayBuffer(width, height, bpp,
-														   offset, mDomId, refs,
-														   beAllocRefs);
+		return -ENOMEM;
+	}
 
-		mDisplayBuffers.emplace(dbCookie, displayBuffer);
+	try
+	{
+		createDisplayBufferUnlocked(dbCookie, beAllocRefs, startDirectory,
+									offset, size, width, height, bpp);
+	}
+	catch(const std::exception& e)
+	{
+		unchargeUnlocked(dbCookie);
 
-		if (beAllocRefs)
-		{
-			pgDirSetBufferRefs(mDomId, startDirectory, size, refs);
-		}
+		throw;
 	}
+
+	return 0;
 }
 
-void BuffersStorage::createFrameBuffer(uint64_t dbCookie, uint64_t fbCookie,
-									   uint32_t width, uint32_t height,
-									   uint32_t pixelFormat)
+int BuffersStorage::createFrameBuffer(uint64_t dbCookie, uint64_t fbCookie,
+									  uint32_t width, uint32_t height,
+									  uint32_t pixelFormat)
 {
 	lock_guard<mutex> lock(mMutex);
 
@@ -134,12 +144,44 @@ void BuffersStorage::createFrameBuffer(uint64_t dbCookie, uint64_t fbCookie,
 					  << ", DB cookie: " << setw(16) << dbCookie
 					  << ", FB cookie: " << setw(16) << fbCookie;
 
-	handlePendingDisplayBuffers(dbCookie, width, height, pixelFormat);
+	auto ret = handlePendingDisplayBuffers(dbCookie, width, height,
+										   pixelFormat);
+
+	if (ret < 0)
+	{
+		return ret;
+	}
+
+	auto displayBuffer = findDisplayBufferUnlocked(dbCookie);
+
+	if (!displayBuffer)
+	{
+		DLOG(mLog, ERROR) << "Dumb cookie not found";
+
+		return -ENOENT;
+	}
+
+	if (PixelFormat::getNumPlanes(pixelFormat) > 1)
+	{
+		auto planes = PixelFormat::getPlanes(pixelFormat,
+											 displayBuffer->getStride(),
+											 height);
+		auto& last = planes.back();
+
+		if (last.offset + last.pitch * last.height > displayBuffer->getSize())
+		{
+			DLOG(mLog, ERROR) << "Display buffer is too small for planes";
+
+			return -EINVAL;
+		}
+	}
 
-	auto frameBuffer = mDisplay->createFrameBuffer(
-			getDisplayBufferUnlocked(dbCookie), width, height, pixelFormat);
+	auto frameBuffer = mDisplay->createFrameBuffer(displayBuffer, width,
+												   height, pixelFormat);
 
 	mFrameBuffers.emplace(fbCookie, frameBuffer);
+
+	return 0;
 }
 
 DisplayBufferPtr BuffersStorage::getDisplayBuffer(uint64_t dbCookie)
@@ -149,24 +191,92 @@ DisplayBufferPtr BuffersStorage::getDisplayBuffer(uint64_t dbCookie)
 	DLOG(mLog, DEBUG) << "Get display buffer, DB cookie: 0x"
 					  << hex << setfill('0') << setw(16) << dbCookie;
 
-	return getDisplayBufferUnlocked(dbCookie);
+	auto displayBuffer = findDisplayBufferUnlocked(dbCookie);
+
+	if (!displayBuffer)
+	{
+		throw XenBackend::Exception("Dumb cookie not found", ENOENT);
+	}
+
+	return displayBuffer;
+}
+
+bool BuffersStorage::hasFrameBuffer(uint64_t fbCookie)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	return findFrameBufferUnlocked(fbCookie) != nullptr;
+}
+
+FrameBufferPtr BuffersStorage::getFrameBuffer(uint64_t fbCookie)
+{
+	FrameBufferPtr frameBuffer;
+
+	auto status = getFrameBuffer(fbCookie, frameBuffer);
+
+	if (status)
+	{
+		throw XenBackend::Exception("Frame buffer cookie not found", -status);
+	}
+
+	return frameBuffer;
+}
+
+int BuffersStorage::getFrameBuffer(uint64_t fbCookie,
+								   FrameBufferPtr& frameBuffer)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	DLOG(mLog, DEBUG) << "Get frame buffer, FB cookie: 0x"
+					  << hex << setfill('0') << setw(16) << fbCookie;
+
+	frameBuffer = findFrameBufferUnlocked(fbCookie);
+
+	if (!frameBuffer)
+	{
+		return -ENOENT;
+	}
+
+	return 0;
 }
 
 FrameBufferPtr BuffersStorage::getFrameBufferAndCopy(uint64_t fbCookie)
+{
+	FrameBufferPtr frameBuffer;
+
+	auto status = getFrameBufferAndCopy(fbCookie, frameBuffer);
+
+	if (status)
+	{
+		throw XenBackend::Exception("Frame buffer cookie not found", -status);
+	}
+
+	return frameBuffer;
+}
+
+int BuffersStorage::getFrameBufferAndCopy(uint64_t fbCookie,
+										  FrameBufferPtr& frameBuffer)
 {
 	lock_guard<mutex> lock(mMutex);
 
 	DLOG(mLog, DEBUG) << "Get frame buffer and copy, FB cookie: 0x"
 					  << hex << setfill('0') << setw(16) << fbCookie;
 
-	auto frameBuffer = getFrameBufferUnlocked(fbCookie);
+	frameBuffer = findFrameBufferUnlocked(fbCookie);
+
+	if (!frameBuffer)
+	{
+		DLOG(mLog, ERROR) << "Frame buffer cookie not found";
+
+		return -ENOENT;
+	}
 
 	if (frameBuffer->getDisplayBuffer()->needsCopy())
 	{
 		frameBuffer->getDisplayBuffer()->copy();
 	}
 
-	return frameBuffer;
+	return 0;
 }
 
 void BuffersStorage::destroyDisplayBuffer(uint64_t dbCookie)
@@ -178,6 +288,8 @@ void BuffersStorage::destroyDisplayBuffer(uint64_t dbCookie)
 
 	mDisplayBuffers.erase(dbCookie);
 	mPendingDisplayBuffers.erase(dbCookie);
+
+	unchargeUnlocked(dbCookie);
 }
 
 void BuffersStorage::destroyFrameBuffer(uint64_t fbCookie)
@@ -194,79 +306,108 @@ void BuffersStorage::destroyFrameBuffer(uint64_t fbCookie)
  * Private
  ******************************************************************************/
 
-uint32_t BuffersStorage::getBpp(uint32_t format)
+void BuffersStorage::createDisplayBufferUnlocked(uint64_t dbCookie,
+												 bool beAllocRefs,
+												 grant_ref_t startDirectory,
+												 size_t offset, uint32_t size,
+												 uint32_t width,
+												 uint32_t height, uint32_t bpp)
 {
-	switch (format)
+	GrantRefs refs;
+
+	if (!beAllocRefs)
 	{
-	case DRM_FORMAT_C8:
-	case DRM_FORMAT_RGB332:
-	case DRM_FORMAT_BGR233:
-		return 8;
-
-	case DRM_FORMAT_XRGB1555:
-	case DRM_FORMAT_XBGR1555:
-	case DRM_FORMAT_RGBX5551:
-	case DRM_FORMAT_BGRX5551:
-	case DRM_FORMAT_ARGB1555:
-	case DRM_FORMAT_ABGR1555:
-	case DRM_FORMAT_RGBA5551:
-	case DRM_FORMAT_BGRA5551:
-	case DRM_FORMAT_RGB565:
-	case DRM_FORMAT_BGR565:
-	case DRM_FORMAT_YUYV:
-		return 16;
-
-	case DRM_FORMAT_RGB888:
-	case DRM_FORMAT_BGR888:
-		return 24;
-
-	case DRM_FORMAT_XRGB8888:
-	case DRM_FORMAT_XBGR8888:
-	case DRM_FORMAT_RGBX8888:
-	case DRM_FORMAT_BGRX8888:
-	case DRM_FORMAT_XRGB2101010:
-	case DRM_FORMAT_XBGR2101010:
-	case DRM_FORMAT_RGBX1010102:
-	case DRM_FORMAT_BGRX1010102:
-	case DRM_FORMAT_ARGB2101010:
-	case DRM_FORMAT_ABGR2101010:
-	case DRM_FORMAT_RGBA1010102:
-	case DRM_FORMAT_BGRA1010102:
-	case DRM_FORMAT_ARGB8888:
-	case DRM_FORMAT_ABGR8888:
-	case DRM_FORMAT_RGBA8888:
-	case DRM_FORMAT_BGRA8888:
-		return 32;
-
-	default:
-		throw XenBackend::Exception("Invalid pixel format", EINVAL);
+		pgDirGetBufferRefs(mDomId, startDirectory, size, refs);
+	}
+
+	if (width == 0)
+	{
+		DLOG(mLog, DEBUG) << "Create pending display buffer, start dir: "
+						  << startDirectory
+						  << ", size: " << size << ", offset: " << offset
+						  << ", DB cookie: 0x"
+						  << hex << setfill('0') << setw(16)
+						  << dbCookie;
+
+		mPendingDisplayBuffers.emplace(dbCookie, PendingBuffer{offset, refs});
+	}
+	else
+	{
+		DLOG(mLog, DEBUG) << "Create display buffer, w: "
+						  << width << ", h: " << height << ", bpp: " << bpp
+						  << ", offset: " << offset
+						  << ", start dir: " << startDirectory
+						  << ", size: " << size << ", DB cookie: 0x"
+						  << hex << setfill('0') << setw(16)
+						  << dbCookie;
+
+		auto displayBuffer = mDisplay->createDisplayBuffer(width, height, bpp,
+														   offset, mDomId, refs,
+														   beAllocRefs);
+
+		mDisplayBuffers.emplace(dbCookie, displayBuffer);
+
+		if (beAllocRefs)
+		{
+			pgDirSetBufferRefs(mDomId, startDirectory, size, refs);
+		}
 	}
 }
 
-void BuffersStorage::handlePendingDisplayBuffers(uint64_t dbCookie,
-												 uint32_t width,
-												 uint32_t height,
-												 uint32_t pixelFormat)
+int BuffersStorage::handlePendingDisplayBuffers(uint64_t dbCookie,
+												uint32_t width,
+												uint32_t height,
+												uint32_t pixelFormat)
 {
 	if (mPendingDisplayBuffers.size() == 0)
 	{
-		return;
+		return 0;
 	}
 
 	auto iter = mPendingDisplayBuffers.find(dbCookie);
 
 	if (iter != mPendingDisplayBuffers.end())
 	{
-		auto bpp = getBpp(pixelFormat);
+		auto bpp = PixelFormat::getBpp(pixelFormat);
+		uint64_t allocSize;
+
+		// chroma planes take at most twice the luma plane size
+		if (!getAllocSize(width, height, bpp, allocSize) ||
+			allocSize > UINT32_MAX / 3)
+		{
+			DLOG(mLog, ERROR) << "Display buffer is too big";
+
+			return -EINVAL;
+		}
+
+		// multi-planar formats keep chroma planes after the luma one
+		auto bufferHeight = PixelFormat::getBufferHeight(
+				pixelFormat, (static_cast<uint64_t>(width) * bpp + 7) / 8,
+				height);
+
+		getAllocSize(width, bufferHeight, bpp, allocSize);
+
+		// only the size declared by the frontend is charged on create
+		auto charged = mChargedSizes[dbCookie];
+
+		if (allocSize > charged &&
+			!chargeUnlocked(dbCookie, allocSize - charged))
+		{
+			DLOG(mLog, ERROR) << "Display buffer quota is exceeded";
+
+			return -ENOMEM;
+		}
 
 		DLOG(mLog, DEBUG) << "Create display buffer from pending, w: "
-						  << width << ", h: " << height << ", bpp: " << bpp
+						  << width << ", h: " << bufferHeight
+						  << ", bpp: " << bpp
 						  << ", offset: " << iter->second.offset
 						  << ", DB cookie: 0x"
 						  << hex << setfill('0') << setw(16)
 						  << dbCookie;
 
-		auto displayBuffer = mDisplay->createDisplayBuffer(width, height, bpp,
+		auto displayBuffer = mDisplay->createDisplayBuffer(width, bufferHeight,
+														   bpp,
 														   iter->second.offset,
 														   mDomId,
 														   iter->second.refs,
@@ -276,28 +417,70 @@ void BuffersStorage::handlePendingDisplayBuffers(uint64_t dbCookie,
 
 		mPendingDisplayBuffers.erase(iter);
 	}
+
+	return 0;
 }
 
-DisplayBufferPtr BuffersStorage::getDisplayBufferUnlocked(uint64_t dbCookie)
+DisplayBufferPtr BuffersStorage::findDisplayBufferUnlocked(uint64_t dbCookie)
 {
 	auto iter = mDisplayBuffers.find(dbCookie);
 
 	if (iter == mDisplayBuffers.end())
 	{
-		throw XenBackend::Exception("Dumb cookie not found", ENOENT);
+		return nullptr;
 	}
 
 	return iter->second;
 }
 
-FrameBufferPtr BuffersStorage::getFrameBufferUnlocked(uint64_t fbCookie)
+FrameBufferPtr BuffersStorage::findFrameBufferUnlocked(uint64_t fbCookie)
 {
 	auto iter = mFrameBuffers.find(fbCookie);
 
 	if (iter == mFrameBuffers.end())
 	{
-		throw XenBackend::Exception("Frame buffer cookie not found", ENOENT);
+		return nullptr;
 	}
 
 	return iter->second;
 }
+
+bool BuffersStorage::getAllocSize(uint32_t width, uint32_t height,
+								  uint32_t bpp, uint64_t& size)
+{
+	uint64_t stride = (static_cast<uint64_t>(width) * bpp + 7) / 8;
+
+	// the protocol and the display describe buffers with 32-bit sizes
+	if (stride > UINT32_MAX)
+	{
+		return false;
+	}
+
+	size = stride * height;
+
+	return size <= UINT32_MAX;
+}
+
+bool BuffersStorage::chargeUnlocked(uint64_t dbCookie, uint64_t size)
+{
+	if (!mAccount->charge(size))
+	{
+		return false;
+	}
+
+	mChargedSizes[dbCookie] += size;
+
+	return true;
+}
+
+void BuffersStorage::unchargeUnlocked(uint64_t dbCookie)
+{
+	auto iter = mChargedSizes.find(dbCookie);
+
+	if (iter != mChargedSizes.end())
+	{
+		mAccount->uncharge(iter->second);
+
+		mChargedSizes.erase(iter);
+	}
+}
@@ -29,6 +29,7 @@
 #include <xen/be/XenGnttab.hpp>
 
 #include "DisplayItf.hpp"
+#include "MemoryAccount.hpp"
 
 using std::memcpy;
 using std::move;
@@ -44,8 +45,11 @@ public:
 	/**
 	 * @param domId   domain id
 	 * @param display display object
+	 * @param quota   max bytes of display buffers of the domain, 0 - unlimited,
+	 *                used if the storage is the first one of the domain
 	 */
-	BuffersStorage(domid_t domId, DisplayItf::DisplayPtr display);
+	BuffersStorage(domid_t domId, DisplayItf::DisplayPtr display,
+				   uint64_t quota = 0);
 	~BuffersStorage();
 
 	/**
@@ -58,12 +62,14 @@ public:
 	 * @param width          width in pixels
 	 * @param height         height in pixels
 	 * @param bpp            bits per pixel
+	 * @return 0 or negative error code if the request is invalid, the cookie
+	 *         already exists or the domain quota is exceeded
 	 */
-	void createDisplayBuffer(uint64_t dbCookie, bool beAllocRefs,
-							 grant_ref_t startDirectory,
-							 size_t offset, uint32_t size,
-							 uint32_t width, uint32_t height,
-							 uint32_t bpp);
+	int createDisplayBuffer(uint64_t dbCookie, bool beAllocRefs,
+							grant_ref_t startDirectory,
+							size_t offset, uint32_t size,
+							uint32_t width, uint32_t height,
+							uint32_t bpp);
 
 	/**
 	 * Creates frame buffer
@@ -72,10 +78,12 @@ public:
 	 * @param width        width in pixel
 	 * @param height       height in pixel
 	 * @param pixelFormat  pixel format
+	 * @return 0 or negative error code if the request is invalid or the
+	 *         domain quota is exceeded
 	 */
-	void createFrameBuffer(uint64_t dbCookie, uint64_t fbCookie,
-						   uint32_t width, uint32_t height,
-						   uint32_t pixelFormat);
+	int createFrameBuffer(uint64_t dbCookie, uint64_t fbCookie,
+						  uint32_t width, uint32_t height,
+						  uint32_t pixelFormat);
 
 	/**
 	 * Returns display buffer object
@@ -83,12 +91,43 @@ public:
 	 */
 	DisplayItf::DisplayBufferPtr getDisplayBuffer(uint64_t dbCookie);
 
+	/**
+	 * Checks if the frame buffer exists
+	 * @param fbCookie frame buffer cookie
+	 */
+	bool hasFrameBuffer(uint64_t fbCookie);
+
+	/**
+	 * Returns frame buffer object without copying its content
+	 * @param fbCookie frame buffer cookie
+	 */
+	DisplayItf::FrameBufferPtr getFrameBuffer(uint64_t fbCookie);
+
+	/**
+	 * Gets frame buffer object without copying its content and without
+	 * throwing on unknown cookie
+	 * @param fbCookie    frame buffer cookie
+	 * @param frameBuffer frame buffer object
+	 * @return 0 or -ENOENT if the cookie is not found
+	 */
+	int getFrameBuffer(uint64_t fbCookie,
+					   DisplayItf::FrameBufferPtr& frameBuffer);
+
 	/**
 	 * Returns frame buffer object
 	 * @param fbCookie frame buffer cookie
 	 */
 	DisplayItf::FrameBufferPtr getFrameBufferAndCopy(uint64_t fbCookie);
 
+	/**
+	 * Gets frame buffer object without throwing on unknown cookie
+	 * @param fbCookie    frame buffer cookie
+	 * @param frameBuffer frame buffer object
+	 * @return 0 or -ENOENT if the cookie is not found
+	 */
+	int getFrameBufferAndCopy(uint64_t fbCookie,
+							  DisplayItf::FrameBufferPtr& frameBuffer);
+
 	/**
 	 * Destroys display buffer
 	 * @param dbCookie display buffer cookie
@@ -105,6 +144,7 @@ private:
 
 	domid_t mDomId;
 	DisplayItf::DisplayPtr mDisplay;
+	MemoryAccountPtr mAccount;
 	XenBackend::Log mLog;
 
 	std::mutex mMutex;
@@ -117,12 +157,22 @@ private:
 	std::unordered_map<uint64_t, DisplayItf::FrameBufferPtr> mFrameBuffers;
 	std::unordered_map<uint64_t, DisplayItf::DisplayBufferPtr> mDisplayBuffers;
 	std::unordered_map<uint64_t, PendingBuffer> mPendingDisplayBuffers;
-
-	uint32_t getBpp(uint32_t format);
-	void handlePendingDisplayBuffers(uint64_t dbCookie, uint32_t width,
-									 uint32_t height, uint32_t pixelFormat);
-	DisplayItf::DisplayBufferPtr getDisplayBufferUnlocked(uint64_t dbCookie);
-	DisplayItf::FrameBufferPtr getFrameBufferUnlocked(uint64_t fbCookie);
+	// bytes charged to the domain account per display buffer
+	std::unordered_map<uint64_t, uint64_t> mChargedSizes;
+
+	void createDisplayBufferUnlocked(uint64_t dbCookie, bool beAllocRefs,
+									 grant_ref_t startDirectory,
+									 size_t offset, uint32_t size,
+									 uint32_t width, uint32_t height,
+									 uint32_t bpp);
+	int handlePendingDisplayBuffers(uint64_t dbCookie, uint32_t width,
+									uint32_t height, uint32_t pixelFormat);
+	DisplayItf::DisplayBufferPtr findDisplayBufferUnlocked(uint64_t dbCookie);
+	DisplayItf::FrameBufferPtr findFrameBufferUnlocked(uint64_t fbCookie);
+	bool getAllocSize(uint32_t width, uint32_t height, uint32_t bpp,
+					  uint64_t& size);
+	bool chargeUnlocked(uint64_t dbCookie, uint64_t size);
+	void unchargeUnlocked(uint64_t dbCookie);
 };
 
 typedef std::shared_ptr<BuffersStorage> BuffersStoragePtr;
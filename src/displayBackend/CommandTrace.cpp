@@ -0,0 +1,308 @@
+/*
+ *  Command trace
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ */
+
+#include "CommandTrace.hpp"
+
+#include <cerrno>
+
+#include <xen/be/Exception.hpp>
+
+#include "Metrics.hpp"
+
+using std::lock_guard;
+using std::mutex;
+using std::string;
+
+namespace CommandTrace {
+
+/*******************************************************************************
+ * Writer
+ ******************************************************************************/
+
+Writer::Writer(const string& path, uint32_t samplePeriod) :
+	mSamplePeriod(samplePeriod),
+	mFile(nullptr),
+	mStartTime(Metrics::getTimeUs()),
+	mFailed(false),
+	mNumFlips(0),
+	mLog("CommandTrace")
+{
+	try
+	{
+		init(path);
+	}
+	catch(const std::exception& e)
+	{
+		release();
+
+		throw;
+	}
+}
+
+Writer::~Writer()
+{
+	release();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void Writer::addConnector(domid_t domId, int conIndex, const string& name,
+						  uint32_t width, uint32_t height)
+{
+	ConnectorRecord record {width, height};
+
+	lock_guard<mutex> lock(mMutex);
+
+	writeRecord(RECORD_CONNECTOR, domId, conIndex, &record, sizeof(record),
+				name.data(), name.size());
+}
+
+void Writer::addRequest(domid_t domId, int conIndex, uint64_t startTime,
+						const xendispl_req& req, int status,
+						BuffersStoragePtr buffersStorage)
+{
+	auto time = Metrics::getTimeUs();
+
+	RequestRecord record {};
+
+	record.timeUs = startTime - mStartTime;
+	record.durationUs = time - startTime;
+	record.status = status;
+	record.req = req;
+
+	DisplayItf::DisplayBufferPtr sample;
+	DisplayItf::FrameBufferPtr frameBuffer;
+
+	// the frame buffer may be already destroyed by another ring of the
+	// frontend, the request is recorded without the sample then
+	if (mSamplePeriod && req.operation == XENDISPL_OP_PG_FLIP && !status &&
+		++mNumFlips % mSamplePeriod == 0 &&
+		!buffersStorage->getFrameBuffer(req.op.pg_flip.fb_cookie, frameBuffer))
+	{
+		sample = frameBuffer->getDisplayBuffer();
+	}
+
+	const void* payload = nullptr;
+	size_t payloadSize = 0;
+
+	if (sample && sample->getBuffer())
+	{
+		payload = sample->getBuffer();
+		payloadSize = sample->getSize();
+	}
+
+	lock_guard<mutex> lock(mMutex);
+
+	writeRecord(RECORD_REQUEST, domId, conIndex, &record, sizeof(record),
+				payload, payloadSize);
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void Writer::init(const string& path)
+{
+	mFile = fopen(path.c_str(), "wb");
+
+	if (!mFile)
+	{
+		throw XenBackend::Exception("Can't open trace file: " + path, errno);
+	}
+
+	setvbuf(mFile, nullptr, _IOFBF, cBufferSize);
+
+	FileHeader header {cMagic, cVersion, sizeof(xendispl_req)};
+
+	if (fwrite(&header, sizeof(header), 1, mFile) != 1)
+	{
+		throw XenBackend::Exception("Can't write trace file: " + path, errno);
+	}
+
+	LOG(mLog, INFO) << "Record trace: " << path
+					<< ", sample period: " << mSamplePeriod;
+}
+
+void Writer::release()
+{
+	if (mFile)
+	{
+		fclose(mFile);
+
+		mFile = nullptr;
+	}
+}
+
+void Writer::writeRecord(RecordType type, domid_t domId, int conIndex,
+						 const void* data, size_t size,
+						 const void* payload, size_t payloadSize)
+{
+	// tracing shall not break the backend, stop on the first error
+	if (mFailed)
+	{
+		return;
+	}
+
+	RecordHeader header {};
+
+	header.type = type;
+	header.domId = domId;
+	header.conIndex = conIndex;
+	header.size = size + payloadSize;
+
+	if (fwrite(&header, sizeof(header), 1, mFile) != 1 ||
+		fwrite(data, size, 1, mFile) != 1 ||
+		(payloadSize && fwrite(payload, payloadSize, 1, mFile) != 1))
+	{
+		LOG(mLog, ERROR) << "Can't write trace, error: " << errno
+						 << ", tracing is stopped";
+
+		mFailed = true;
+	}
+}
+
+/*******************************************************************************
+ * Reader
+ ******************************************************************************/
+
+Reader::Reader(const string& path) :
+	mFile(nullptr)
+{
+	try
+	{
+		init(path);
+	}
+	catch(const std::exception& e)
+	{
+		release();
+
+		throw;
+	}
+}
+
+Reader::~Reader()
+{
+	release();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+bool Reader::read(Record& record)
+{
+	RecordHeader header;
+
+	if (fread(&header, sizeof(header), 1, mFile) != 1)
+	{
+		if (feof(mFile))
+		{
+			return false;
+		}
+
+		throw XenBackend::Exception("Can't read trace", errno);
+	}
+
+	record.domId = header.domId;
+	record.conIndex = header.conIndex;
+
+	if (header.type == RECORD_CONNECTOR &&
+		header.size >= sizeof(ConnectorRecord))
+	{
+		ConnectorRecord data;
+
+		readData(&data, sizeof(data));
+
+		record.type = RECORD_CONNECTOR;
+		record.width = data.width;
+		record.height = data.height;
+		record.name.resize(header.size - sizeof(data));
+
+		readData(&record.name[0], record.name.size());
+	}
+	else if (header.type == RECORD_REQUEST &&
+			 header.size >= sizeof(RequestRecord))
+	{
+		RequestRecord data;
+
+		readData(&data, sizeof(data));
+
+		record.type = RECORD_REQUEST;
+		record.timeUs = data.timeUs;
+		record.durationUs = data.durationUs;
+		record.status = data.status;
+		record.req = data.req;
+		record.sample.resize(header.size - sizeof(data));
+
+		readData(record.sample.data(), record.sample.size());
+	}
+	else
+	{
+		throw XenBackend::Exception("Invalid trace record", EINVAL);
+	}
+
+	return true;
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void Reader::init(const string& path)
+{
+	mFile = fopen(path.c_str(), "rb");
+
+	if (!mFile)
+	{
+		throw XenBackend::Exception("Can't open trace file: " + path, errno);
+	}
+
+	FileHeader header;
+
+	readData(&header, sizeof(header));
+
+	if (header.magic != cMagic || header.version != cVersion ||
+		header.reqSize != sizeof(xendispl_req))
+	{
+		throw XenBackend::Exception("Unsupported trace file: " + path, EINVAL);
+	}
+}
+
+void Reader::release()
+{
+	if (mFile)
+	{
+		fclose(mFile);
+
+		mFile = nullptr;
+	}
+}
+
+void Reader::readData(void* data, size_t size)
+{
+	if (size && fread(data, size, 1, mFile) != 1)
+	{
+		throw XenBackend::Exception("Truncated trace", EIO);
+	}
+}
+
+}
@@ -0,0 +1,207 @@
+/*
+ *  Command trace
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ */
+
+#ifndef SRC_COMMANDTRACE_HPP_
+#define SRC_COMMANDTRACE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <xen/be/Log.hpp>
+
+#include "BuffersStorage.hpp"
+#include "displif.h"
+
+/***************************************************************************//**
+ * Trace of display commands. The trace file starts with a file header and
+ * contains records in native byte order: a connector record is written when
+ * the connector is created and a request record for each processed request.
+ * A request record of a page flip may be followed by the content of the
+ * flipped display buffer.
+ * @ingroup displ_be
+ ******************************************************************************/
+namespace CommandTrace {
+
+const uint32_t cMagic = 0x52544244; // "DBTR"
+const uint16_t cVersion = 1;
+
+enum RecordType : uint16_t
+{
+	RECORD_CONNECTOR = 1,
+	RECORD_REQUEST = 2
+};
+
+struct FileHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t reqSize;
+};
+
+struct RecordHeader
+{
+	uint16_t type;
+	uint16_t domId;
+	uint16_t conIndex;
+	uint16_t reserved;
+	// size of the data following the header
+	uint32_t size;
+};
+
+struct ConnectorRecord
+{
+	uint32_t width;
+	uint32_t height;
+	// followed by the connector name
+};
+
+struct RequestRecord
+{
+	// time since the trace start
+	uint64_t timeUs;
+	uint32_t durationUs;
+	int32_t status;
+	xendispl_req req;
+	// followed by the sampled buffer content
+};
+
+/**
+ * Record read from the trace
+ */
+struct Record
+{
+	RecordType type;
+	domid_t domId;
+	uint16_t conIndex;
+
+	// connector record
+	std::string name;
+	uint32_t width;
+	uint32_t height;
+
+	// request record
+	uint64_t timeUs;
+	uint32_t durationUs;
+	int32_t status;
+	xendispl_req req;
+	std::vector<uint8_t> sample;
+};
+
+/***************************************************************************//**
+ * Writes the trace. Records of all connectors go to the same file.
+ * @ingroup displ_be
+ ******************************************************************************/
+class Writer
+{
+public:
+
+	/**
+	 * @param path         trace file path
+	 * @param samplePeriod content of each n-th flipped buffer is written,
+	 *                     0 - buffer content is not written
+	 */
+	explicit Writer(const std::string& path, uint32_t samplePeriod = 0);
+
+	~Writer();
+
+	/**
+	 * Writes connector record
+	 * @param domId    frontend domain id
+	 * @param conIndex connector index
+	 * @param name     connector name
+	 * @param width    connector width
+	 * @param height   connector height
+	 */
+	void addConnector(domid_t domId, int conIndex, const std::string& name,
+					  uint32_t width, uint32_t height);
+
+	/**
+	 * Writes request record, is called when the request is processed
+	 * @param domId          frontend domain id
+	 * @param conIndex       connector index
+	 * @param startTime      time when processing was started
+	 * @param req            request
+	 * @param status         response status
+	 * @param buffersStorage buffers storage to sample flipped buffer from
+	 */
+	void addRequest(domid_t domId, int conIndex, uint64_t startTime,
+					const xendispl_req& req, int status,
+					BuffersStoragePtr buffersStorage);
+
+private:
+
+	static const size_t cBufferSize = 1 << 20;
+
+	uint32_t mSamplePeriod;
+	FILE* mFile;
+	uint64_t mStartTime;
+	bool mFailed;
+	std::atomic<uint32_t> mNumFlips;
+	std::mutex mMutex;
+	XenBackend::Log mLog;
+
+	void init(const std::string& path);
+	void release();
+	void writeRecord(RecordType type, domid_t domId, int conIndex,
+					 const void* data, size_t size,
+					 const void* payload, size_t payloadSize);
+};
+
+typedef std::shared_ptr<Writer> WriterPtr;
+
+/***************************************************************************//**
+ * Reads the trace.
+ * @ingroup displ_be
+ ******************************************************************************/
+class Reader
+{
+public:
+
+	/**
+	 * @param path trace file path
+	 */
+	explicit Reader(const std::string& path);
+
+	~Reader();
+
+	/**
+	 * Reads next record
+	 * @param record record
+	 * @return false if the end of the trace is reached
+	 */
+	bool read(Record& record);
+
+private:
+
+	FILE* mFile;
+
+	void init(const std::string& path);
+	void release();
+	void readData(void* data, size_t size);
+};
+
+}
+
+#endif /* SRC_COMMANDTRACE_HPP_ */
@@ -25,6 +25,8 @@
 
 #include <xen/be/XenStore.hpp>
 
+#include "Metrics.hpp"
+
 #ifdef WITH_IVI_EXTENSION
 #include "wayland/Connector.hpp"
 #endif
@@ -50,6 +52,60 @@ using XenBackend::FrontendHandlerPtr;
 using DisplayItf::ConnectorPtr;
 using DisplayItf::DisplayPtr;
 
+namespace {
+
+// optional backend nodes which limit commands of the guest
+const char* const cFieldMaxFlipRate = "max-flip-rate";
+const char* const cFieldMaxDbufRate = "max-dbuf-rate";
+// in KiB as memory nodes of the toolstack
+const char* const cFieldMaxBufferMemory = "max-buffer-memory";
+
+}
+
+/*******************************************************************************
+ * CtrlRequestProcessor
+ ******************************************************************************/
+
+CtrlRequestProcessor::CtrlRequestProcessor(DisplayPtr display,
+										   ConnectorPtr connector,
+										   BuffersStoragePtr buffersStorage,
+										   EventRingBufferPtr eventBuffer,
+										   domid_t domId, int conIndex,
+										   CommandTrace::WriterPtr trace,
+										   const CommandLimits& limits,
+										   TimerQueuePtr timerQueue) :
+	mCommandHandler(display, connector, buffersStorage, eventBuffer,
+					limits, timerQueue),
+	mBuffersStorage(buffersStorage),
+	mDomId(domId),
+	mConIndex(conIndex),
+	mTrace(trace),
+	mLog("ConCtrlRing")
+{
+}
+
+xendispl_resp CtrlRequestProcessor::processRequest(const xendispl_req& req)
+{
+	DLOG(mLog, DEBUG) << "Request received, cmd:"
+					  << static_cast<int>(req.operation);
+
+	auto startTime = mTrace ? Metrics::getTimeUs() : 0;
+
+	xendispl_resp rsp {};
+
+	rsp.id = req.id;
+	rsp.operation = req.operation;
+	rsp.status = mCommandHandler.processCommand(req, rsp);
+
+	if (mTrace)
+	{
+		mTrace->addRequest(mDomId, mConIndex, startTime, req, rsp.status,
+						   mBuffersStorage);
+	}
+
+	return rsp;
+}
+
 /*******************************************************************************
  * ConCtrlRingBuffer
  ******************************************************************************/
@@ -59,28 +115,56 @@ CtrlRingBuffer::CtrlRingBuffer(DisplayPtr display,
 							   BuffersStoragePtr buffersStorage,
 							   EventRingBufferPtr eventBuffer,
 							   domid_t domId,
-							   evtchn_port_t port, grant_ref_t ref) :
+							   evtchn_port_t port, grant_ref_t ref,
+							   int conIndex,
+							   CommandTrace::WriterPtr trace,
+							   const CommandLimits& limits,
+							   TimerQueuePtr timerQueue) :
 	RingBufferInBase<xen_displif_back_ring, xen_displif_sring,
 					 xendispl_req, xendispl_resp>(domId, port, ref),
-	mCommandHandler(display, connector, buffersStorage, eventBuffer),
-	mLog("ConCtrlRing")
+	mRequestProcessor(display, connector, buffersStorage, eventBuffer,
+					  domId, conIndex, trace, limits, timerQueue)
 {
-	LOG(mLog, DEBUG) << "Create ctrl ring buffer";
+	LOG("ConCtrlRing", DEBUG) << "Create ctrl ring buffer";
 }
 
 void CtrlRingBuffer::processRequest(const xendispl_req& req)
 {
-	DLOG(mLog, DEBUG) << "Request received, cmd:"
-					  << static_cast<int>(req.operation);
+	sendResponse(mRequestProcessor.processRequest(req));
+}
 
-	xendispl_resp rsp {};
+/*******************************************************************************
+ * PooledCtrlRingBuffer
+ ******************************************************************************/
 
-	rsp.id = req.id;
-	rsp.id = req.id;
-	rsp.operation = req.operation;
-	rsp.status = mCommandHandler.processCommand(req, rsp);
+PooledCtrlRingBuffer::PooledCtrlRingBuffer(RingWorkerPoolPtr pool,
+										   DisplayPtr display,
+										   ConnectorPtr connector,
+										   BuffersStoragePtr buffersStorage,
+										   EventRingBufferPtr eventBuffer,
+										   domid_t domId,
+										   evtchn_port_t port,
+										   grant_ref_t ref,
+										   int conIndex,
+										   CommandTrace::WriterPtr trace,
+										   const CommandLimits& limits,
+										   TimerQueuePtr timerQueue) :
+	PooledRingBufferIn<xen_displif_back_ring, xen_displif_sring,
+					   xendispl_req, xendispl_resp>(pool, domId, port, ref),
+	mRequestProcessor(display, connector, buffersStorage, eventBuffer,
+					  domId, conIndex, trace, limits, timerQueue)
+{
+	LOG("ConCtrlRing", DEBUG) << "Create pooled ctrl ring buffer";
+}
 
-	sendResponse(rsp);
+PooledCtrlRingBuffer::~PooledCtrlRingBuffer()
+{
+	stop();
+}
+
+void PooledCtrlRingBuffer::processRequest(const xendispl_req& req)
+{
+	sendResponse(mRequestProcessor.processRequest(req));
 }
 
 /*******************************************************************************
@@ -91,7 +175,10 @@ void DisplayFrontendHandler::onBind()
 {
 	LOG(mLog, DEBUG) << "On frontend bind : " << getDomId();
 
-	BuffersStoragePtr buffersStorage(new BuffersStorage(getDomId(), mDisplay));
+	readLimits();
+
+	BuffersStoragePtr buffersStorage(new BuffersStorage(getDomId(), mDisplay,
+														mLimits.bufferQuota));
 
 	string conBasePath = getXsFrontendPath() + "/";
 	int conIndex = 0;
@@ -107,6 +194,33 @@ void DisplayFrontendHandler::onBind()
 	}
 }
 
+void DisplayFrontendHandler::readLimits()
+{
+	// the toolstack may override the default limits of the guest
+	string flipRatePath = getXsBackendPath() + "/" + cFieldMaxFlipRate;
+	string dbufRatePath = getXsBackendPath() + "/" + cFieldMaxDbufRate;
+	string memoryPath = getXsBackendPath() + "/" + cFieldMaxBufferMemory;
+
+	if (getXenStore().checkIfExist(flipRatePath))
+	{
+		mLimits.flipRate = getXenStore().readUint(flipRatePath);
+	}
+
+	if (getXenStore().checkIfExist(dbufRatePath))
+	{
+		mLimits.dbufRate = getXenStore().readUint(dbufRatePath);
+	}
+
+	if (getXenStore().checkIfExist(memoryPath))
+	{
+		mLimits.bufferQuota = getXenStore().readUint(memoryPath) * 1024ull;
+	}
+
+	LOG(mLog, DEBUG) << "Flip rate: " << mLimits.flipRate
+					 << ", dbuf rate: " << mLimits.dbufRate
+					 << ", buffer quota: " << mLimits.bufferQuota;
+}
+
 void DisplayFrontendHandler::createConnector(const string& conPath,
 											 int conIndex,
 											 BuffersStoragePtr bufferStorage)
@@ -118,9 +232,15 @@ void DisplayFrontendHandler::createConnector(const string& conPath,
 										 XENDISPL_FIELD_EVT_RING_REF);
 
 	EventRingBufferPtr eventRingBuffer(new EventRingBuffer(conIndex, getDomId(),
-			port, ref, XENDISPL_IN_RING_OFFS, XENDISPL_IN_RING_SIZE));
+			port, ref, XENDISPL_IN_RING_OFFS, XENDISPL_IN_RING_SIZE,
+			mTimerQueue));
 
-	addRingBuffer(eventRingBuffer);
+	// the event ring only notifies the frontend, with the pool it is not
+	// started to not spend a thread on waiting for its indications
+	if (!mPool)
+	{
+		addRingBuffer(eventRingBuffer);
+	}
 
 	port = getXenStore().readInt(conPath + XENDISPL_FIELD_REQ_CHANNEL);
 
@@ -136,12 +256,34 @@ void DisplayFrontendHandler::createConnector(const string& conPath,
 
 	auto connector = mDisplay->createConnector(getDomId(), id, width, height);
 
+	if (mTrace)
+	{
+		mTrace->addConnector(getDomId(), conIndex, id, width, height);
+	}
+
+	if (mPool)
+	{
+		addRingBuffer(XenBackend::RingBufferPtr(
+				new PooledCtrlRingBuffer(mPool,
+										 mDisplay,
+										 connector,
+										 bufferStorage,
+										 eventRingBuffer,
+										 getDomId(), port, ref,
+										 conIndex, mTrace,
+										 mLimits, mTimerQueue)));
+
+		return;
+	}
+
 	CtrlRingBufferPtr ctrlRingBuffer(
 			new CtrlRingBuffer(mDisplay,
 							   connector,
 							   bufferStorage,
 							   eventRingBuffer,
-							   getDomId(), port, ref));
+							   getDomId(), port, ref,
+							   conIndex, mTrace,
+							   mLimits, mTimerQueue));
 
 	addRingBuffer(ctrlRingBuffer);
 }
@@ -151,9 +293,17 @@ void DisplayFrontendHandler::createConnector(const string& conPath,
  ******************************************************************************/
 
 DisplayBackend::DisplayBackend(DisplayPtr display,
-							   const string& deviceName) :
+							   const string& deviceName,
+							   RingWorkerPoolPtr pool,
+							   CommandTrace::WriterPtr trace,
+							   const CommandLimits& limits,
+							   TimerQueuePtr timerQueue) :
 	BackendBase("DisplBackend", deviceName),
-	mDisplay(display)
+	mDisplay(display),
+	mPool(pool),
+	mTrace(trace),
+	mLimits(limits),
+	mTimerQueue(timerQueue ? timerQueue : std::make_shared<TimerQueue>())
 {
 	mDisplay->start();
 }
@@ -162,5 +312,6 @@ void DisplayBackend::onNewFrontend(domid_t domId, uint16_t devId)
 {
 	addFrontendHandler(FrontendHandlerPtr(
 			new DisplayFrontendHandler(mDisplay, getDeviceName(),
-									   domId, devId)));
+									   domId, devId, mPool, mTrace,
+									   mLimits, mTimerQueue)));
 }
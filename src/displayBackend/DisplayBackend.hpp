@@ -26,13 +26,60 @@
 #include <xen/be/RingBufferBase.hpp>
 #include <xen/be/Log.hpp>
 
+#include "CommandTrace.hpp"
 #include "DisplayCommandHandler.hpp"
+#include "PooledRingBuffer.hpp"
 
 /***************************************************************************//**
  * @defgroup displ_be Display backend
  * Backend related classes.
  ******************************************************************************/
 
+/***************************************************************************//**
+ * Processes connector control requests of both ring buffer kinds: handles the
+ * command and traces it.
+ * @ingroup displ_be
+ ******************************************************************************/
+class CtrlRequestProcessor
+{
+public:
+	/**
+	 * @param display        display object
+	 * @param connector      connector object
+	 * @param buffersStorage buffers storage
+	 * @param eventBuffer    event ring buffer
+	 * @param domId          frontend domain id
+	 * @param conIndex       connector index
+	 * @param trace          command trace, nullptr - commands are not traced
+	 * @param limits         command limits
+	 * @param timerQueue     timer queue for deferred flips
+	 */
+	CtrlRequestProcessor(DisplayItf::DisplayPtr display,
+						 DisplayItf::ConnectorPtr connector,
+						 BuffersStoragePtr buffersStorage,
+						 EventRingBufferPtr eventBuffer,
+						 domid_t domId, int conIndex,
+						 CommandTrace::WriterPtr trace,
+						 const CommandLimits& limits,
+						 TimerQueuePtr timerQueue);
+
+	/**
+	 * Processes the request
+	 * @param req request
+	 * @return response to send
+	 */
+	xendispl_resp processRequest(const xendispl_req& req);
+
+private:
+
+	DisplayCommandHandler mCommandHandler;
+	BuffersStoragePtr mBuffersStorage;
+	domid_t mDomId;
+	int mConIndex;
+	CommandTrace::WriterPtr mTrace;
+	XenBackend::Log mLog;
+};
+
 /***************************************************************************//**
  * Ring buffer used for the connector control.
  * @ingroup displ_be
@@ -49,23 +96,72 @@ public:
 	 * @param domId          frontend domain id
 	 * @param port           event channel port number
 	 * @param ref            grant table reference
+	 * @param conIndex       connector index
+	 * @param trace          command trace, nullptr - commands are not traced
+	 * @param limits         command limits
+	 * @param timerQueue     timer queue for deferred flips
 	 */
 	CtrlRingBuffer(DisplayItf::DisplayPtr display,
 				   DisplayItf::ConnectorPtr connector,
 				   BuffersStoragePtr buffersStorage,
 				   EventRingBufferPtr eventBuffer,
-				   domid_t domId, evtchn_port_t port, grant_ref_t ref);
+				   domid_t domId, evtchn_port_t port, grant_ref_t ref,
+				   int conIndex = 0,
+				   CommandTrace::WriterPtr trace = nullptr,
+				   const CommandLimits& limits = CommandLimits(),
+				   TimerQueuePtr timerQueue = nullptr);
 
 private:
 
-	DisplayCommandHandler mCommandHandler;
-	XenBackend::Log mLog;
+	CtrlRequestProcessor mRequestProcessor;
 
 	void processRequest(const xendispl_req& req);
 };
 
 typedef std::shared_ptr<CtrlRingBuffer> CtrlRingBufferPtr;
 
+/***************************************************************************//**
+ * Ring buffer used for the connector control which is served by the ring
+ * worker pool.
+ * @ingroup displ_be
+ ******************************************************************************/
+class PooledCtrlRingBuffer : public PooledRingBufferIn<
+		xen_displif_back_ring, xen_displif_sring, xendispl_req, xendispl_resp>
+{
+public:
+	/**
+	 * @param pool           ring worker pool
+	 * @param display        display object
+	 * @param connector      connector object
+	 * @param buffersStorage buffers storage
+	 * @param eventBuffer    event ring buffer
+	 * @param domId          frontend domain id
+	 * @param port           event channel port number
+	 * @param ref            grant table reference
+	 * @param conIndex       connector index
+	 * @param trace          command trace, nullptr - commands are not traced
+	 * @param limits         command limits
+	 * @param timerQueue     timer queue for deferred flips
+	 */
+	PooledCtrlRingBuffer(RingWorkerPoolPtr pool,
+						 DisplayItf::DisplayPtr display,
+						 DisplayItf::ConnectorPtr connector,
+						 BuffersStoragePtr buffersStorage,
+						 EventRingBufferPtr eventBuffer,
+						 domid_t domId, evtchn_port_t port, grant_ref_t ref,
+						 int conIndex = 0,
+						 CommandTrace::WriterPtr trace = nullptr,
+						 const CommandLimits& limits = CommandLimits(),
+						 TimerQueuePtr timerQueue = nullptr);
+	~PooledCtrlRingBuffer();
+
+private:
+
+	CtrlRequestProcessor mRequestProcessor;
+
+	void processRequest(const xendispl_req& req) override;
+};
+
 /***************************************************************************//**
  * Display frontend handler.
  * @ingroup displ_be
@@ -79,12 +175,24 @@ public:
 	 * @param devName   device name
 	 * @param domId     frontend domain id
 	 * @param devId     frontend device id
+	 * @param pool      ring worker pool, nullptr - ring per thread
+	 * @param trace     command trace, nullptr - commands are not traced
+	 * @param limits    default command limits
+	 * @param timerQueue timer queue for deferred flips and event batches
 	 */
 	DisplayFrontendHandler(DisplayItf::DisplayPtr display,
 						   const std::string& devName,
-						   domid_t domId, uint16_t devId) :
+						   domid_t domId, uint16_t devId,
+						   RingWorkerPoolPtr pool = nullptr,
+						   CommandTrace::WriterPtr trace = nullptr,
+						   const CommandLimits& limits = CommandLimits(),
+						   TimerQueuePtr timerQueue = nullptr) :
 		FrontendHandlerBase("DisplFrontend", devName, domId, devId),
 		mDisplay(display),
+		mPool(pool),
+		mTrace(trace),
+		mLimits(limits),
+		mTimerQueue(timerQueue),
 		mLog("DisplFrontend") {}
 
 protected:
@@ -97,8 +205,13 @@ protected:
 private:
 
 	DisplayItf::DisplayPtr mDisplay;
+	RingWorkerPoolPtr mPool;
+	CommandTrace::WriterPtr mTrace;
+	CommandLimits mLimits;
+	TimerQueuePtr mTimerQueue;
 	XenBackend::Log mLog;
 
+	void readLimits();
 	void createConnector(const std::string& streamPath, int conIndex,
 						 BuffersStoragePtr bufferStorage);
 };
@@ -115,9 +228,18 @@ public:
 	 * @param deviceName    device name
 	 * @param domId         domain id
 	 * @param devId         device id
+	 * @param pool          ring worker pool, nullptr - ring per thread
+	 * @param trace         command trace, nullptr - commands are not traced
+	 * @param limits        default command limits
+	 * @param timerQueue    timer queue for deferred flips and event batches,
+	 *                      nullptr - own queue
 	 */
 	DisplayBackend(DisplayItf::DisplayPtr display,
-				   const std::string& deviceName);
+				   const std::string& deviceName,
+				   RingWorkerPoolPtr pool = nullptr,
+				   CommandTrace::WriterPtr trace = nullptr,
+				   const CommandLimits& limits = CommandLimits(),
+				   TimerQueuePtr timerQueue = nullptr);
 
 protected:
 
@@ -131,6 +253,10 @@ protected:
 private:
 
 	DisplayItf::DisplayPtr mDisplay;
+	RingWorkerPoolPtr mPool;
+	CommandTrace::WriterPtr mTrace;
+	CommandLimits mLimits;
+	TimerQueuePtr mTimerQueue;
 };
 
 #endif /* DISPLAYBACKEND_HPP_ */
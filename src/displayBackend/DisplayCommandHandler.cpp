@@ -27,9 +27,10 @@
 
 using std::dec;
 using std::hex;
+using std::lock_guard;
+using std::mutex;
 using std::setfill;
 using std::setw;
-using std::unordered_map;
 
 using DisplayItf::ConnectorPtr;
 using DisplayItf::DisplayPtr;
@@ -47,16 +48,28 @@ using DisplayItf::DisplayPtr;
  *   version 1 it is not known to it, thus it is not going to be issued.
  ******************************************************************************/
 
-unordered_map<int, DisplayCommandHandler::CommandFn>
-	DisplayCommandHandler::sCmdTable =
+constexpr uint8_t DisplayCommandHandler::cFirstCommand;
+constexpr uint8_t DisplayCommandHandler::cNumCommands;
+
+// entries are in the operation order
+static_assert(XENDISPL_OP_DBUF_DESTROY == XENDISPL_OP_DBUF_CREATE + 1 &&
+			  XENDISPL_OP_FB_ATTACH == XENDISPL_OP_DBUF_CREATE + 2 &&
+			  XENDISPL_OP_FB_DETACH == XENDISPL_OP_DBUF_CREATE + 3 &&
+			  XENDISPL_OP_SET_CONFIG == XENDISPL_OP_DBUF_CREATE + 4 &&
+			  XENDISPL_OP_PG_FLIP == XENDISPL_OP_DBUF_CREATE + 5 &&
+			  XENDISPL_OP_GET_EDID == XENDISPL_OP_DBUF_CREATE + 6,
+			  "Display commands are not dense");
+
+const DisplayCommandHandler::CommandFn
+	DisplayCommandHandler::sCmdTable[cNumCommands] =
 {
-	{XENDISPL_OP_PG_FLIP,		&DisplayCommandHandler::pageFlip},
-	{XENDISPL_OP_FB_ATTACH,		&DisplayCommandHandler::attachFrameBuffer},
-	{XENDISPL_OP_FB_DETACH,		&DisplayCommandHandler::detachFrameBuffer},
-	{XENDISPL_OP_DBUF_CREATE,	&DisplayCommandHandler::createDisplayBuffer},
-	{XENDISPL_OP_DBUF_DESTROY,	&DisplayCommandHandler::destroyDisplayBuffer},
-	{XENDISPL_OP_SET_CONFIG,	&DisplayCommandHandler::setConfig},
-	{XENDISPL_OP_GET_EDID,		&DisplayCommandHandler::getEDID}
+	&DisplayCommandHandler::createDisplayBuffer,	// XENDISPL_OP_DBUF_CREATE
+	&DisplayCommandHandler::destroyDisplayBuffer,	// XENDISPL_OP_DBUF_DESTROY
+	&DisplayCommandHandler::attachFrameBuffer,		// XENDISPL_OP_FB_ATTACH
+	&DisplayCommandHandler::detachFrameBuffer,		// XENDISPL_OP_FB_DETACH
+	&DisplayCommandHandler::setConfig,				// XENDISPL_OP_SET_CONFIG
+	&DisplayCommandHandler::pageFlip,				// XENDISPL_OP_PG_FLIP
+	&DisplayCommandHandler::getEDID					// XENDISPL_OP_GET_EDID
 };
 
 /*******************************************************************************
@@ -65,15 +78,25 @@ unordered_map<int, DisplayCommandHandler::CommandFn>
 
 EventRingBuffer::EventRingBuffer(int conIndex, domid_t domId,
 								 evtchn_port_t port, grant_ref_t ref,
-								 int offset, size_t size) :
-	RingBufferOutBase<xendispl_event_page, xendispl_evt>(domId, port, ref,
-														 offset, size),
+								 int offset, size_t size,
+								 TimerQueuePtr timerQueue) :
+	BatchRingBufferOut<xendispl_event_page, xendispl_evt>(domId, port, ref,
+														  offset, size,
+														  cRetryTimeoutMs,
+														  timerQueue),
 	mConIndex(conIndex),
 	mLog("ConEventRing")
 {
 	LOG(mLog, DEBUG) << "Create event ring buffer, index: " << mConIndex;
 }
 
+EventRingBuffer::~EventRingBuffer()
+{
+	stopTimer();
+
+	LOG(mLog, DEBUG) << "Delete event ring buffer, index: " << mConIndex;
+}
+
 /*******************************************************************************
  * CommandHandler
  ******************************************************************************/
@@ -82,13 +105,28 @@ DisplayCommandHandler::DisplayCommandHandler(
 		DisplayPtr display,
 		ConnectorPtr connector,
 		BuffersStoragePtr buffersStorage,
-		EventRingBufferPtr eventBuffer) :
+		EventRingBufferPtr eventBuffer,
+		const CommandLimits& limits,
+		TimerQueuePtr timerQueue) :
 	mDisplay(display),
 	mConnector(connector),
 	mBuffersStorage(buffersStorage),
 	mEventBuffer(eventBuffer),
 	mEventId(0),
-	mLog("CommandHandler")
+	mTimerQueue(timerQueue),
+	mFlipBucket(timerQueue ? limits.flipRate : 0, cFlipBurst),
+	mDbufBucket(limits.dbufRate, limits.dbufRate),
+	mFlipDeferred(false),
+	mDeferredCookie(0),
+	mLog("CommandHandler"),
+	mFailedRequests(Metrics::Collector::getInstance().getCounter(
+			"display.failed_requests")),
+	mThrottledFlips(Metrics::Collector::getInstance().getCounter(
+			"display.throttled_flips")),
+	mCoalescedFlips(Metrics::Collector::getInstance().getCounter(
+			"display.coalesced_flips")),
+	mRejectedDbufs(Metrics::Collector::getInstance().getCounter(
+			"display.rejected_dbufs"))
 {
 	assert(display);
 	assert(connector);
@@ -96,7 +134,9 @@ DisplayCommandHandler::DisplayCommandHandler(
 	assert(eventBuffer);
 	
 	LOG(mLog, DEBUG) << "Create command handler, connector name: "
-					 << mConnector->getName();
+					 << mConnector->getName()
+					 << ", flip rate: " << limits.flipRate
+					 << ", dbuf rate: " << limits.dbufRate;
 }
 
 DisplayCommandHandler::~DisplayCommandHandler()
@@ -104,6 +144,11 @@ DisplayCommandHandler::~DisplayCommandHandler()
 	LOG(mLog, DEBUG) << "Delete command handler, connector name: "
 					 << mConnector->getName();
 
+	if (mTimerQueue)
+	{
+		mTimerQueue->cancel(this);
+	}
+
 	mConnector.reset();
 }
 
@@ -114,13 +159,31 @@ DisplayCommandHandler::~DisplayCommandHandler()
 int DisplayCommandHandler::processCommand(const xendispl_req& req,
 										  xendispl_resp& rsp)
 {
+	// operations below the first command wrap around to large indexes
+	uint8_t index = req.operation - cFirstCommand;
+
+	if (index >= cNumCommands)
+	{
+		LOG(mLog, ERROR) << "Unknown command: "
+						 << static_cast<int>(req.operation);
+
+		mFailedRequests.add();
+
+		return -EINVAL;
+	}
+
 	int status = 0;
 
+	lock_guard<mutex> lock(mMutex);
+
 	try
 	{
-		(this->*sCmdTable.at(req.operation))(req, rsp);
+		status = (this->*sCmdTable[index])(req, rsp);
 
-		mDisplay->flush();
+		if (!status)
+		{
+			mDisplay->flush();
+		}
 	}
 	catch(const XenBackend::Exception& e)
 	{
@@ -136,12 +199,6 @@ int DisplayCommandHandler::processCommand(const xendispl_req& req,
 			status = -EINVAL;
 		}
 	}
-	catch(const std::out_of_range& e)
-	{
-		LOG(mLog, ERROR) << e.what();
-
-		status = -EINVAL;
-	}
 	catch(const std::exception& e)
 	{
 		LOG(mLog, ERROR) << e.what();
@@ -149,6 +206,11 @@ int DisplayCommandHandler::processCommand(const xendispl_req& req,
 		status = -EIO;
 	}
 
+	if (status)
+	{
+		mFailedRequests.add();
+	}
+
 	DLOG(mLog, DEBUG) << "Return status: ["
 					  << static_cast<signed int>(status) << "]";
 
@@ -159,8 +221,8 @@ int DisplayCommandHandler::processCommand(const xendispl_req& req,
  * Private
  ******************************************************************************/
 
-void DisplayCommandHandler::pageFlip(const xendispl_req& req,
-									 xendispl_resp& rsp)
+int DisplayCommandHandler::pageFlip(const xendispl_req& req,
+									xendispl_resp& rsp)
 {
 	xendispl_page_flip_req flipReq = req.op.pg_flip;
 
@@ -170,12 +232,25 @@ void DisplayCommandHandler::pageFlip(const xendispl_req& req,
 					  << hex << setfill('0') << setw(16)
 					  << cookie;
 
-	mConnector->pageFlip(mBuffersStorage->getFrameBufferAndCopy(cookie),
-						 [cookie, this] () { sendFlipEvent(cookie); });
+	if (!mConnector->isInitialized())
+	{
+		DLOG(mLog, ERROR) << "Connector is not initialized";
+
+		return -EINVAL;
+	}
+
+	// keep the order of flips once one is deferred
+	if (mFlipBucket.isLimited() &&
+		(mFlipDeferred || !mFlipBucket.take(Metrics::getTimeUs())))
+	{
+		return deferFlip(cookie);
+	}
+
+	return flip(cookie);
 }
 
-void DisplayCommandHandler::createDisplayBuffer(const xendispl_req& req,
-												xendispl_resp& rsp)
+int DisplayCommandHandler::createDisplayBuffer(const xendispl_req& req,
+											   xendispl_resp& rsp)
 {
 	const xendispl_dbuf_create_req* dbufReq = &req.op.dbuf_create;
 
@@ -193,23 +268,35 @@ void DisplayCommandHandler::createDisplayBuffer(const xendispl_req& req,
 					  << dbufReq->dbuf_cookie
 					  << ", offset: " << dec << data_ofs;
 
+	if (mDbufBucket.isLimited() && !mDbufBucket.take(Metrics::getTimeUs()))
+	{
+		DLOG(mLog, ERROR) << "Display buffer creation rate is exceeded";
+
+		mRejectedDbufs.add();
+
+		return -EAGAIN;
+	}
+
 	if (beAllocRefs && data_ofs)
 	{
-		throw XenBackend::Exception("Can't create buffer with non-zero offset in this mode",
-									EINVAL);
+		DLOG(mLog, ERROR) << "Can't create buffer with non-zero offset "
+						  << "in this mode";
+
+		return -EINVAL;
 	}
 
-	mBuffersStorage->createDisplayBuffer(dbufReq->dbuf_cookie,
-										 beAllocRefs,
-										 dbufReq->gref_directory,
-										 data_ofs,
-										 dbufReq->buffer_sz,
-										 dbufReq->width, dbufReq->height,
-										 dbufReq->bpp);
+	return mBuffersStorage->createDisplayBuffer(dbufReq->dbuf_cookie,
+												beAllocRefs,
+												dbufReq->gref_directory,
+												data_ofs,
+												dbufReq->buffer_sz,
+												dbufReq->width,
+												dbufReq->height,
+												dbufReq->bpp);
 }
 
-void DisplayCommandHandler::destroyDisplayBuffer(const xendispl_req& req,
-												 xendispl_resp& rsp)
+int DisplayCommandHandler::destroyDisplayBuffer(const xendispl_req& req,
+												xendispl_resp& rsp)
 {
 	const xendispl_dbuf_destroy_req* dbufReq = &req.op.dbuf_destroy;
 
@@ -218,10 +305,12 @@ void DisplayCommandHandler::destroyDisplayBuffer(const xendispl_req& req,
 					  << dbufReq->dbuf_cookie;
 
 	mBuffersStorage->destroyDisplayBuffer(dbufReq->dbuf_cookie);
+
+	return 0;
 }
 
-void DisplayCommandHandler::attachFrameBuffer(const xendispl_req& req,
-											  xendispl_resp& rsp)
+int DisplayCommandHandler::attachFrameBuffer(const xendispl_req& req,
+											 xendispl_resp& rsp)
 {
 	const xendispl_fb_attach_req* fbReq = &req.op.fb_attach;
 
@@ -230,14 +319,14 @@ void DisplayCommandHandler::attachFrameBuffer(const xendispl_req& req,
 					  << fbReq->dbuf_cookie << ", FB cookie: "
 					  << setw(16) << fbReq->fb_cookie;
 
-	mBuffersStorage->createFrameBuffer(fbReq->dbuf_cookie, fbReq->fb_cookie,
-									   fbReq->width, fbReq->height,
-									   fbReq->pixel_format);
-
+	return mBuffersStorage->createFrameBuffer(fbReq->dbuf_cookie,
+											  fbReq->fb_cookie,
+											  fbReq->width, fbReq->height,
+											  fbReq->pixel_format);
 }
 
-void DisplayCommandHandler::detachFrameBuffer(const xendispl_req& req,
-											  xendispl_resp& rsp)
+int DisplayCommandHandler::detachFrameBuffer(const xendispl_req& req,
+											 xendispl_resp& rsp)
 {
 	const xendispl_fb_detach_req* fbReq = &req.op.fb_detach;
 
@@ -246,10 +335,12 @@ void DisplayCommandHandler::detachFrameBuffer(const xendispl_req& req,
 					  << fbReq->fb_cookie;
 
 	mBuffersStorage->destroyFrameBuffer(fbReq->fb_cookie);
+
+	return 0;
 }
 
-void DisplayCommandHandler::setConfig(const xendispl_req& req,
-									  xendispl_resp& rsp)
+int DisplayCommandHandler::setConfig(const xendispl_req& req,
+									 xendispl_resp& rsp)
 {
 	const xendispl_set_config_req* configReq = &req.op.set_config;
 
@@ -274,10 +365,12 @@ void DisplayCommandHandler::setConfig(const xendispl_req& req,
 	{
 		mConnector->release();
 	}
+
+	return 0;
 }
 
-void DisplayCommandHandler::getEDID(const xendispl_req& req,
-									xendispl_resp& rsp)
+int DisplayCommandHandler::getEDID(const xendispl_req& req,
+								   xendispl_resp& rsp)
 {
 	xendispl_get_edid_req edidReq = req.op.get_edid;
 	xendispl_get_edid_resp& edidResp = rsp.op.get_edid;
@@ -288,6 +381,133 @@ void DisplayCommandHandler::getEDID(const xendispl_req& req,
 	edidResp.edid_sz = static_cast<uint32_t>(mConnector->getEDID(
 			edidReq.gref_directory,
 			edidReq.buffer_sz));
+
+	return 0;
+}
+
+int DisplayCommandHandler::flip(uint64_t fbCookie)
+{
+	if (!mConnector->isInitialized())
+	{
+		DLOG(mLog, ERROR) << "Connector is not initialized";
+
+		return -EINVAL;
+	}
+
+	if (mConnector->isFlipPending())
+	{
+		DLOG(mLog, ERROR) << "Page flip is already pending";
+
+		return -EBUSY;
+	}
+
+	DisplayItf::FrameBufferPtr frameBuffer;
+
+	auto status = mBuffersStorage->getFrameBufferAndCopy(fbCookie,
+														 frameBuffer);
+
+	if (status)
+	{
+		return status;
+	}
+
+	mConnector->pageFlip(frameBuffer,
+						 [fbCookie, this] () { sendFlipEvent(fbCookie); });
+
+	return 0;
+}
+
+int DisplayCommandHandler::deferFlip(uint64_t fbCookie)
+{
+	if (!mBuffersStorage->hasFrameBuffer(fbCookie))
+	{
+		DLOG(mLog, ERROR) << "Frame buffer cookie not found";
+
+		return -ENOENT;
+	}
+
+	DLOG(mLog, DEBUG) << "Flip rate is exceeded, defer flip";
+
+	mThrottledFlips.add();
+
+	if (mFlipDeferred)
+	{
+		// the older flip is never shown, complete it as if it was
+		mCoalescedFlips.add();
+
+		sendFlipEvent(mDeferredCookie);
+	}
+	else
+	{
+		auto nowUs = Metrics::getTimeUs();
+
+		scheduleFlip(nowUs + mFlipBucket.getWaitUs(nowUs));
+
+		mFlipDeferred = true;
+	}
+
+	mDeferredCookie = fbCookie;
+
+	return 0;
+}
+
+void DisplayCommandHandler::scheduleFlip(uint64_t timeUs)
+{
+	mTimerQueue->schedule(this, timeUs, [this] () { onFlipTimer(); });
+}
+
+void DisplayCommandHandler::onFlipTimer()
+{
+	lock_guard<mutex> lock(mMutex);
+
+	if (!mFlipDeferred)
+	{
+		return;
+	}
+
+	auto nowUs = Metrics::getTimeUs();
+
+	if (mConnector->isFlipPending())
+	{
+		scheduleFlip(nowUs + cFlipRetryUs);
+
+		return;
+	}
+
+	if (!mFlipBucket.take(nowUs))
+	{
+		scheduleFlip(nowUs + mFlipBucket.getWaitUs(nowUs));
+
+		return;
+	}
+
+	mFlipDeferred = false;
+
+	int status = 0;
+
+	try
+	{
+		status = flip(mDeferredCookie);
+
+		if (!status)
+		{
+			mDisplay->flush();
+		}
+	}
+	catch(const std::exception& e)
+	{
+		LOG(mLog, ERROR) << e.what();
+
+		status = -EIO;
+	}
+
+	// the frontend got OK when the flip was deferred, don't leave it waiting
+	if (status)
+	{
+		mFailedRequests.add();
+
+		sendFlipEvent(mDeferredCookie);
+	}
 }
 
 void DisplayCommandHandler::sendFlipEvent(uint64_t fbCookie)
@@ -300,6 +520,10 @@ void DisplayCommandHandler::sendFlipEvent(uint64_t fbCookie)
 
 	event.type = XENDISPL_EVT_PG_FLIP;
 	event.op.pg_flip.fb_cookie = fbCookie;
+
+	// event ids shall come to the ring in order
+	lock_guard<mutex> lock(mEventMutex);
+
 	event.id = mEventId++;
 
 	mEventBuffer->sendEvent(event);
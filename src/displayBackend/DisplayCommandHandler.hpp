@@ -22,41 +22,66 @@
 #define SRC_DISPLAYCOMMANDHANDLER_HPP_
 
 #include <cstdint>
-#include <unordered_map>
+#include <mutex>
 #include <vector>
 
-#include <xen/be/RingBufferBase.hpp>
 #include <xen/be/Log.hpp>
 
+#include "BatchRingBuffer.hpp"
 #include "BuffersStorage.hpp"
 #include "DisplayItf.hpp"
+#include "Metrics.hpp"
+#include "TimerQueue.hpp"
+#include "TokenBucket.hpp"
 
 /***************************************************************************//**
- * Ring buffer used to send events to the frontend.
+ * Ring buffer used to send events to the frontend. Flip events are sent from
+ * display threads without serializing on a lock and are never dropped.
  * @ingroup displ_be
  ******************************************************************************/
-class EventRingBuffer : public XenBackend::RingBufferOutBase<
-		xendispl_event_page, xendispl_evt>
+class EventRingBuffer : public BatchRingBufferOut<xendispl_event_page,
+												  xendispl_evt>
 {
 public:
 	/**
-	 * @param conIndex  connector index
-	 * @param domId     frontend domain id
-	 * @param port      event channel port number
-	 * @param ref       grant table reference
-	 * @param offset    start of the ring buffer inside the page
-	 * @param size      size of the ring buffer
+	 * @param conIndex   connector index
+	 * @param domId      frontend domain id
+	 * @param port       event channel port number
+	 * @param ref        grant table reference
+	 * @param offset     start of the ring buffer inside the page
+	 * @param size       size of the ring buffer
+	 * @param timerQueue timer queue of batch deadlines, nullptr - own queue
 	 */
 	EventRingBuffer(int conIndex, domid_t domId, evtchn_port_t port,
-					grant_ref_t ref, int offset, size_t size);
+					grant_ref_t ref, int offset, size_t size,
+					TimerQueuePtr timerQueue = nullptr);
+
+	~EventRingBuffer();
 
 private:
+	// retry period of events which don't fit into the ring
+	static const uint32_t cRetryTimeoutMs = 5;
+
 	int mConIndex;
 	XenBackend::Log mLog;
 };
 
 typedef std::shared_ptr<EventRingBuffer> EventRingBufferPtr;
 
+/**
+ * Limits of the frontend commands, 0 - unlimited.
+ * @ingroup displ_be
+ */
+struct CommandLimits
+{
+	// page flips per second of the connector, excess flips are coalesced
+	uint32_t flipRate;
+	// display buffers created per second, excess requests fail with EAGAIN
+	uint32_t dbufRate;
+	// bytes of display buffers of the domain, excess requests fail with ENOMEM
+	uint64_t bufferQuota;
+};
+
 /**
  * Handles commands received from the frontend.
  * @ingroup displ_be
@@ -69,11 +94,16 @@ public:
 	 * @param connector      connector object
 	 * @param buffersStorage buffers storage
 	 * @param eventBuffer    event ring buffer
+	 * @param limits         command limits
+	 * @param timerQueue     timer queue to run deferred flips from,
+	 *                       nullptr - flips are not limited
 	 */
 	DisplayCommandHandler(DisplayItf::DisplayPtr display,
 						  DisplayItf::ConnectorPtr connector,
 						  BuffersStoragePtr buffersStorage,
-						  EventRingBufferPtr eventBuffer);
+						  EventRingBufferPtr eventBuffer,
+						  const CommandLimits& limits = CommandLimits(),
+						  TimerQueuePtr timerQueue = nullptr);
 	~DisplayCommandHandler();
 
 	/**
@@ -85,26 +115,60 @@ public:
 	int processCommand(const xendispl_req& req, xendispl_resp& rsp);
 
 private:
-	typedef void(DisplayCommandHandler::*CommandFn)(const xendispl_req& req,
-													xendispl_resp& rsp);
+	// guest errors are returned as negative error codes, exceptions are left
+	// for failures of the backend
+	typedef int(DisplayCommandHandler::*CommandFn)(const xendispl_req& req,
+												   xendispl_resp& rsp);
+
+	// commands are dense, the table is indexed by the operation offset
+	static constexpr uint8_t cFirstCommand = XENDISPL_OP_DBUF_CREATE;
+	static constexpr uint8_t cNumCommands =
+			XENDISPL_OP_GET_EDID - XENDISPL_OP_DBUF_CREATE + 1;
 
-	static std::unordered_map<int, CommandFn> sCmdTable;
+	static const CommandFn sCmdTable[cNumCommands];
+
+	// flips which may be shown at once before throttling starts
+	static const uint32_t cFlipBurst = 2;
+	// retry period of the deferred flip while the previous one is pending
+	static const uint64_t cFlipRetryUs = 1000;
 
 	DisplayItf::DisplayPtr mDisplay;
 	DisplayItf::ConnectorPtr mConnector;
 	BuffersStoragePtr mBuffersStorage;
 	EventRingBufferPtr mEventBuffer;
+
+	// flip events are sent by the ring thread for coalesced flips and by the
+	// display thread for shown ones
+	std::mutex mEventMutex;
 	uint16_t mEventId;
 
-	XenBackend::Log mLog;
+	TimerQueuePtr mTimerQueue;
+	TokenBucket mFlipBucket;
+	TokenBucket mDbufBucket;
+
+	// serializes commands with the deferred flip
+	std::mutex mMutex;
+	bool mFlipDeferred;
+	uint64_t mDeferredCookie;
 
-	void pageFlip(const xendispl_req& req, xendispl_resp& rsp);
-	void createDisplayBuffer(const xendispl_req& req, xendispl_resp& rsp);
-	void destroyDisplayBuffer(const xendispl_req& req, xendispl_resp& rsp);
-	void attachFrameBuffer(const xendispl_req& req, xendispl_resp& rsp);
-	void detachFrameBuffer(const xendispl_req& req, xendispl_resp& rsp);
-	void setConfig(const xendispl_req& req, xendispl_resp& rsp);
-	void getEDID(const xendispl_req& req, xendispl_resp& rsp);
+	XenBackend::Log mLog;
+	Metrics::Counter& mFailedRequests;
+	Metrics::Counter& mThrottledFlips;
+	Metrics::Counter& mCoalescedFlips;
+	Metrics::Counter& mRejectedDbufs;
+
+	int pageFlip(const xendispl_req& req, xendispl_resp& rsp);
+	int createDisplayBuffer(const xendispl_req& req, xendispl_resp& rsp);
+	int destroyDisplayBuffer(const xendispl_req& req, xendispl_resp& rsp);
+	int attachFrameBuffer(const xendispl_req& req, xendispl_resp& rsp);
+	int detachFrameBuffer(const xendispl_req& req, xendispl_resp& rsp);
+	int setConfig(const xendispl_req& req, xendispl_resp& rsp);
+	int getEDID(const xendispl_req& req, xendispl_resp& rsp);
+
+	int flip(uint64_t fbCookie);
+	int deferFlip(uint64_t fbCookie);
+	void scheduleFlip(uint64_t timeUs);
+	void onFlipTimer();
 
 	void sendFlipEvent(uint64_t fbCookie);
 };
@@ -0,0 +1,128 @@
+/*
+ *  Memory account
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ */
+
+#include "MemoryAccount.hpp"
+
+using std::lock_guard;
+using std::map;
+using std::mutex;
+using std::to_string;
+using std::weak_ptr;
+
+/*******************************************************************************
+ * MemoryAccount
+ ******************************************************************************/
+
+mutex MemoryAccount::sMutex;
+map<domid_t, weak_ptr<MemoryAccount>> MemoryAccount::sAccounts;
+
+MemoryAccount::MemoryAccount(domid_t domId, uint64_t quota) :
+	mDomId(domId),
+	mQuota(quota),
+	mUsage(0),
+	mLog("MemoryAccount"),
+	mUsageGauge(Metrics::Collector::getInstance().getGauge(
+			"display.dom" + to_string(domId) + ".buffer_bytes")),
+	mRejected(Metrics::Collector::getInstance().getCounter(
+			"display.quota_rejects"))
+{
+	LOG(mLog, DEBUG) << "Create memory account, dom: " << mDomId
+					 << ", quota: " << mQuota;
+}
+
+MemoryAccount::~MemoryAccount()
+{
+	LOG(mLog, DEBUG) << "Delete memory account, dom: " << mDomId;
+
+	lock_guard<mutex> lock(sMutex);
+
+	auto it = sAccounts.find(mDomId);
+
+	// the entry may already refer to a new account of the domain
+	if (it != sAccounts.end() && it->second.expired())
+	{
+		sAccounts.erase(it);
+	}
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+MemoryAccountPtr MemoryAccount::getAccount(domid_t domId, uint64_t quota)
+{
+	lock_guard<mutex> lock(sMutex);
+
+	auto account = sAccounts[domId].lock();
+
+	if (!account)
+	{
+		account.reset(new MemoryAccount(domId, quota));
+
+		sAccounts[domId] = account;
+	}
+	else if (account->mQuota != quota)
+	{
+		// a later frontend of the domain can't override the quota of the
+		// buffers already created by others
+		LOG(account->mLog, WARNING) << "Keep quota, dom: " << domId
+									<< ", quota: " << account->mQuota
+									<< ", requested: " << quota;
+	}
+
+	return account;
+}
+
+bool MemoryAccount::charge(uint64_t size)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	if (mQuota && mUsage + size > mQuota)
+	{
+		// a guest may retry over its quota, rejects are counted instead
+		DLOG(mLog, WARNING) << "Quota exceeded, dom: " << mDomId
+							<< ", usage: " << mUsage << ", size: " << size
+							<< ", quota: " << mQuota;
+
+		mRejected.add();
+
+		return false;
+	}
+
+	mUsage += size;
+	mUsageGauge.add(size);
+
+	return true;
+}
+
+void MemoryAccount::uncharge(uint64_t size)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	mUsage -= size;
+	mUsageGauge.sub(size);
+}
+
+uint64_t MemoryAccount::getUsage()
+{
+	lock_guard<mutex> lock(mMutex);
+
+	return mUsage;
+}
@@ -0,0 +1,95 @@
+/*
+ *  Memory account
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ */
+
+#ifndef SRC_MEMORYACCOUNT_HPP_
+#define SRC_MEMORYACCOUNT_HPP_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <xenctrl.h>
+
+#include <xen/be/Log.hpp>
+
+#include "Metrics.hpp"
+
+/***************************************************************************//**
+ * Accounts memory of display buffers created for a frontend domain. Frontends
+ * of the same domain share one account and its quota, which is set when the
+ * account is created. The usage is exposed as the display.dom<id>.buffer_bytes
+ * gauge.
+ * @ingroup displ_be
+ ******************************************************************************/
+class MemoryAccount
+{
+public:
+
+	/**
+	 * Returns account of the domain, creates it if not exist
+	 * @param domId domain id
+	 * @param quota max bytes of display buffers, 0 - unlimited. It is used
+	 *              only if the account is created, an existing account keeps
+	 *              its quota.
+	 */
+	static std::shared_ptr<MemoryAccount> getAccount(domid_t domId,
+													 uint64_t quota);
+
+	~MemoryAccount();
+
+	/**
+	 * Charges the account
+	 * @param size size in bytes
+	 * @return false if the quota is exceeded, the account is not charged
+	 */
+	bool charge(uint64_t size);
+
+	/**
+	 * Releases previously charged bytes
+	 * @param size size in bytes
+	 */
+	void uncharge(uint64_t size);
+
+	/**
+	 * Returns charged bytes
+	 */
+	uint64_t getUsage();
+
+private:
+
+	static std::mutex sMutex;
+	static std::map<domid_t, std::weak_ptr<MemoryAccount>> sAccounts;
+
+	domid_t mDomId;
+	uint64_t mQuota;
+	uint64_t mUsage;
+	std::mutex mMutex;
+
+	XenBackend::Log mLog;
+	Metrics::Gauge& mUsageGauge;
+	Metrics::Counter& mRejected;
+
+	MemoryAccount(domid_t domId, uint64_t quota);
+};
+
+typedef std::shared_ptr<MemoryAccount> MemoryAccountPtr;
+
+#endif /* SRC_MEMORYACCOUNT_HPP_ */
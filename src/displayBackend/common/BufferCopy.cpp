@@ -0,0 +1,82 @@
+/*
+ *  Buffer copy helpers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ */
+
+#include "BufferCopy.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using std::min;
+
+namespace BufferCopy {
+
+void copyRows(uint8_t* dst, size_t dstStride, const uint8_t* src,
+			  size_t srcStride, uint32_t numRows)
+{
+	auto rowSize = min(dstStride, srcStride);
+
+	for (uint32_t i = 0; i < numRows; i++)
+	{
+		memcpy(dst + i * dstStride, src + i * srcStride, rowSize);
+	}
+}
+
+bool copyChangedSpan(uint8_t* dst, const uint8_t* src, size_t size,
+					 size_t chunkSize, size_t& start, size_t& end)
+{
+	start = 0;
+
+	while (start < size)
+	{
+		auto chunk = min(chunkSize, size - start);
+
+		if (memcmp(dst + start, src + start, chunk) != 0)
+		{
+			break;
+		}
+
+		start += chunk;
+	}
+
+	if (start == size)
+	{
+		return false;
+	}
+
+	end = size;
+
+	while (end > start)
+	{
+		auto chunk = min(chunkSize, end - start);
+
+		if (memcmp(dst + end - chunk, src + end - chunk, chunk) != 0)
+		{
+			break;
+		}
+
+		end -= chunk;
+	}
+
+	memcpy(dst + start, src + start, end - start);
+
+	return true;
+}
+
+}
@@ -0,0 +1,57 @@
+/*
+ *  Buffer copy helpers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ */
+
+#ifndef SRC_BUFFERCOPY_HPP_
+#define SRC_BUFFERCOPY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace BufferCopy {
+
+/**
+ * Copies rows of the buffer which source and destination strides differ
+ * @param dst       destination buffer
+ * @param dstStride destination stride in bytes
+ * @param src       source buffer
+ * @param srcStride source stride in bytes
+ * @param numRows   number of rows
+ */
+void copyRows(uint8_t* dst, size_t dstStride, const uint8_t* src,
+			  size_t srcStride, uint32_t numRows);
+
+/**
+ * Copies the changed span of the row. The row is compared by chunks from both
+ * ends, so only the span between the first and the last changed chunks is
+ * copied.
+ * @param dst       destination row
+ * @param src       source row
+ * @param size      row size in bytes
+ * @param chunkSize compare granularity in bytes
+ * @param start     start of the copied span
+ * @param end       end of the copied span
+ * @return <i>true</i> if the row is changed
+ */
+bool copyChangedSpan(uint8_t* dst, const uint8_t* src, size_t size,
+					 size_t chunkSize, size_t& start, size_t& end);
+
+}
+
+#endif /* SRC_BUFFERCOPY_HPP_ */
@@ -26,6 +26,10 @@
 #include "drm_edid.h"
 #include "Edid.hpp"
 
+using std::lock_guard;
+using std::mutex;
+using std::vector;
+
 using XenBackend::Exception;
 using XenBackend::XenGnttabBuffer;
 
@@ -42,6 +46,14 @@ ConnectorBase::ConnectorBase(domid_t domId, uint32_t width, uint32_t height) :
  ******************************************************************************/
 size_t ConnectorBase::getEDID(grant_ref_t startDirectory, uint32_t size) const
 {
+	// copied as the cache may be invalidated by another thread
+	auto edid = getCachedEDID();
+
+	if (size < edid.size())
+	{
+		throw Exception("EDID buffer is too small", EINVAL);
+	}
+
 	GrantRefs refs;
 
 	pgDirGetBufferRefs(mDomId, startDirectory, size, refs);
@@ -53,17 +65,44 @@ size_t ConnectorBase::getEDID(grant_ref_t startDirectory, uint32_t size) const
 
 	XenGnttabBuffer edidBuffer(mDomId, refs.data(), refs.size());
 
-	memset(edidBuffer.get(), 0, XENDISPL_EDID_BLOCK_SIZE);
+	memcpy(edidBuffer.get(), edid.data(), edid.size());
+
+	return edid.size();
+}
+
+vector<uint8_t> ConnectorBase::createEDID() const
+{
+	return Edid::create({Edid::getTiming(mCfgWidth, mCfgHeight,
+										 Edid::EDID_REFRESH_RATE_HZ * 1000,
+										 Edid::EDID_DPI)});
+}
 
-	auto edidBlock = static_cast<edid*>(edidBuffer.get());
+void ConnectorBase::invalidateEDID() const
+{
+	lock_guard<mutex> lock(mEdidMutex);
 
-	Edid::putEssentials(edidBlock);
-	Edid::putColorSpace(edidBlock);
-	Edid::putTimings(edidBlock);
-	Edid::putDetailedTiming(edidBlock, 0, mCfgWidth, mCfgHeight, Edid::EDID_DPI);
-	Edid::putDisplayDescritor(edidBlock, 1);
-	Edid::putBlockCheckSum(static_cast<uint8_t*>(edidBuffer.get()));
+	if (!mEdid.empty())
+	{
+		mEdid.clear();
 
-	return XENDISPL_EDID_BLOCK_SIZE;
+		LOG(mLog, DEBUG) << "Invalidate EDID";
+	}
 }
 
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+vector<uint8_t> ConnectorBase::getCachedEDID() const
+{
+	lock_guard<mutex> lock(mEdidMutex);
+
+	if (mEdid.empty())
+	{
+		mEdid = createEDID();
+
+		LOG(mLog, DEBUG) << "Create EDID, size: " << mEdid.size();
+	}
+
+	return mEdid;
+}
@@ -22,6 +22,9 @@
 #ifndef SRC_CONNECTOR_BASE_HPP_
 #define SRC_CONNECTOR_BASE_HPP_
 
+#include <mutex>
+#include <vector>
+
 #include <xen/be/Log.hpp>
 
 #include "DisplayItf.hpp"
@@ -53,12 +56,31 @@ protected:
 	ConnectorBase(domid_t domId, uint32_t width, uint32_t height);
 
 	/**
-	 * Queries connector's EDID
+	 * Queries connector's EDID. The EDID is created on the first query and
+	 * copied from the cache afterwards.
 	 * @param startDirectory grant table reference to the buffer start directory
 	 * @param size           buffer size
 	 */
 	size_t getEDID(grant_ref_t startDirectory, uint32_t size) const;
 
+	/**
+	 * Creates connector's EDID. By default EDID with the configured
+	 * resolution is created.
+	 */
+	virtual std::vector<uint8_t> createEDID() const;
+
+	/**
+	 * Drops the cached EDID, it is created again on the next query. Shall be
+	 * called when the connector modes are changed.
+	 */
+	void invalidateEDID() const;
+
+private:
+
+	mutable std::mutex mEdidMutex;
+	mutable std::vector<uint8_t> mEdid;
+
+	std::vector<uint8_t> getCachedEDID() const;
 };
 
 #endif /* SRC_CONNECTOR_BASE_HPP_ */
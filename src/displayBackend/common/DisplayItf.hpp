@@ -40,6 +40,23 @@ namespace DisplayItf {
  * Abstract classes for display implementation.
  ******************************************************************************/
 
+/***************************************************************************//**
+ * Rectangle in buffer coordinates.
+ * @ingroup display_itf
+ ******************************************************************************/
+struct Rect
+{
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+};
+
+/**
+ * List of changed rectangles
+ */
+typedef std::vector<Rect> DamageRegion;
+
 /***************************************************************************//**
  * Provides display buffer functionality.
  * @ingroup display_itf
@@ -90,6 +107,13 @@ public:
 	 */
 	virtual void copy() = 0;
 
+	/**
+	 * Returns regions changed by copy operations since the previous call
+	 * @param region changed regions
+	 * @return <i>false</i> if changes are unknown and the whole buffer shall
+	 * be treated as changed
+	 */
+	virtual bool takeDamage(DamageRegion& region) { return false; }
 };
 
 typedef std::shared_ptr<DisplayBuffer> DisplayBufferPtr;
@@ -155,6 +179,12 @@ public:
 	 */
 	virtual bool isInitialized() const = 0;
 
+	/**
+	 * Checks if a page flip is pending
+	 * @return <i>true</i> if the previous page flip is not done yet
+	 */
+	virtual bool isFlipPending() const { return false; }
+
 	/**
 	 * Initializes connector
 	 * @param width       width
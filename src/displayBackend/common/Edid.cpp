@@ -29,11 +29,69 @@
 
 namespace {
 
+/* Max pixel clock of detailed timing descriptor in kHz. */
+const uint32_t cMaxPixelClock = 0xffff * 10;
+
+/* VESA CVT reduced blanking parameters. */
+const uint32_t cCvtRbHBlank = 160;
+const uint32_t cCvtRbHFront = 48;
+const uint32_t cCvtRbHSync = 32;
+const uint32_t cCvtRbVFront = 3;
+const uint32_t cCvtRbMinVBack = 6;
+const double cCvtRbMinVBlankUs = 460.0;
+
 uint32_t edid_to_10bit(float value)
 {
 	return (uint32_t)(value * 1024 + 0.5);
 }
 
+uint32_t getCvtVSync(uint32_t xres, uint32_t yres)
+{
+	/* Sync width encodes the aspect ratio. */
+	if (yres * 4 == xres * 3)
+	{
+		return 4;
+	}
+
+	if (yres * 16 == xres * 9)
+	{
+		return 5;
+	}
+
+	if (yres * 16 == xres * 10)
+	{
+		return 6;
+	}
+
+	if (yres * 5 == xres * 4 || yres * 15 == xres * 9)
+	{
+		return 7;
+	}
+
+	return 10;
+}
+
+void setCvtClock(Edid::DetailedTiming& timing, uint32_t refreshMhz)
+{
+	/* Vertical blanking takes at least 460 us of the frame. */
+	double frameUs = 1000000000.0 / refreshMhz;
+	uint32_t vblank = timing.vfront + timing.vsync + cCvtRbMinVBack;
+
+	if (frameUs > cCvtRbMinVBlankUs)
+	{
+		double lineUs = (frameUs - cCvtRbMinVBlankUs) / timing.vactive;
+
+		vblank = std::max(vblank,
+						  static_cast<uint32_t>(cCvtRbMinVBlankUs / lineUs) + 1);
+	}
+
+	timing.vblank = vblank;
+
+	timing.clock = static_cast<uint64_t>(refreshMhz) *
+				   (timing.hactive + timing.hblank) *
+				   (timing.vactive + timing.vblank) / 1000000;
+}
+
 }
 
 namespace Edid {
@@ -89,14 +147,14 @@ void putEssentials(edid* edidBlock)
 	edidBlock->input = DRM_EDID_INPUT_DIGITAL | DRM_EDID_DIGITAL_DEPTH_8 |
 		DRM_EDID_DIGITAL_TYPE_DP;
 
+	/* Set width and hight as undefined, create() sets the preferred one. */
+	edidBlock->width_cm = 0;
+	edidBlock->height_cm = 0;
+
 	/***************************************************************************
 	 * TODO: read the below values from the compositor or DRM subsystem.
 	 **************************************************************************/
 
-	/* Set width and hight as undefined. */
-	edidBlock->width_cm = 0;
-	edidBlock->height_cm = 0;
-
 	/* Display gamma, 2.2. */
 	edidBlock->gamma = 220 - 100;
 
@@ -154,38 +212,92 @@ void putColorSpace(edid* edidBlock)
 void putDetailedTiming(edid* edidBlock, int index,
 										  uint32_t xres, uint32_t yres,
 										  uint32_t dpi)
+{
+	putDetailedTiming(edidBlock, index,
+					  getTiming(xres, yres, EDID_REFRESH_RATE_HZ * 1000, dpi));
+}
+
+DetailedTiming getTiming(uint32_t xres, uint32_t yres, uint32_t refreshMhz,
+						 uint32_t dpi)
+{
+	DetailedTiming timing {};
+
+	timing.hactive = xres;
+	timing.vactive = yres;
+
+	/* Physical display size. */
+	timing.widthMm = xres * dpi / 254;
+	timing.heightMm = yres * dpi / 254;
+
+	/* VESA CVT reduced blanking timing. */
+	timing.hfront = cCvtRbHFront;
+	timing.hsync = cCvtRbHSync;
+	timing.hblank = cCvtRbHBlank;
+
+	timing.vfront = cCvtRbVFront;
+	timing.vsync = getCvtVSync(xres, yres);
+
+	timing.hsyncPositive = true;
+	timing.vsyncPositive = false;
+
+	if (!refreshMhz || !yres)
+	{
+		refreshMhz = EDID_REFRESH_RATE_HZ * 1000;
+	}
+
+	setCvtClock(timing, refreshMhz);
+
+	if (timing.clock > cMaxPixelClock)
+	{
+		/* Lower the refresh rate to the max pixel clock of the descriptor. */
+		refreshMhz = static_cast<uint64_t>(cMaxPixelClock) * 1000000 /
+					 ((timing.hactive + timing.hblank) *
+					  (timing.vactive + timing.vblank));
+
+		setCvtClock(timing, refreshMhz);
+	}
+
+	return timing;
+}
+
+bool isValid(const DetailedTiming& timing)
+{
+	/* Field widths of the detailed timing descriptor. */
+	return timing.clock && timing.clock / 10 <= 0xffff &&
+		   timing.hactive && timing.hactive <= 0xfff &&
+		   timing.hblank <= 0xfff && timing.hfront <= 0x3ff &&
+		   timing.hsync <= 0x3ff &&
+		   timing.vactive && timing.vactive <= 0xfff &&
+		   timing.vblank <= 0xfff && timing.vfront <= 0x3f &&
+		   timing.vsync <= 0x3f &&
+		   timing.widthMm <= 0xfff && timing.heightMm <= 0xfff;
+}
+
+void putDetailedTiming(edid* edidBlock, int index,
+					   const DetailedTiming& timing)
 {
 	/*
 	 * Detailed timing descriptors, in decreasing preference order,
 	 * followed by Display descriptors.
-	 *
-	 * We only provide a single timing here which corresponds to
-	 * XenStore configuration of this connector.
 	 */
 	detailed_timing* desc = &edidBlock->detailed_timings[index];
 	detailed_pixel_timing* pixelData = &desc->data.pixel_data;
 
-	/***************************************************************************
-	 * TODO: read the below values from the compositor or DRM subsystem.
-	 **************************************************************************/
-
-	/* Physical display size. */
-	uint32_t xmm = xres * dpi / 254;
-	uint32_t ymm = yres * dpi / 254;
-
-	/* Pull some realistic looking timings out of thin air. */
-	uint32_t xfront = xres * 25 / 100;
-	uint32_t xsync  = xres *  3 / 100;
-	uint32_t xblank = xres * 35 / 100;
+	uint32_t xres = timing.hactive;
+	uint32_t xfront = timing.hfront;
+	uint32_t xsync = timing.hsync;
+	uint32_t xblank = timing.hblank;
 
-	uint32_t yfront = yres *  5 / 1000;
-	uint32_t ysync  = yres *  5 / 1000;
-	uint32_t yblank = yres * 35 / 1000;
+	uint32_t yres = timing.vactive;
+	uint32_t yfront = timing.vfront;
+	uint32_t ysync = timing.vsync;
+	uint32_t yblank = timing.vblank;
 
-	uint32_t clock = EDID_REFRESH_RATE_HZ * (xres + xblank) * (yres + yblank);
+	uint32_t xmm = timing.widthMm;
+	uint32_t ymm = timing.heightMm;
 
 	/* 10 KHz granularity, little endian. */
-	desc->pixel_clock = htole32(clock / 10000);
+	desc->pixel_clock = htole16(timing.clock / 10);
 
 	pixelData->hactive_lo = xres & 0xff;
 	pixelData->hblank_lo = xblank & 0xff;
@@ -215,7 +327,93 @@ void putDetailedTiming(edid* edidBlock, int index,
 	pixelData->hborder = 0;
 	pixelData->vborder = 0;
 
-	pixelData->misc = DRM_EDID_PT_SEPARATE_SYNC;
+	pixelData->misc = DRM_EDID_PT_SEPARATE_SYNC |
+					  (timing.hsyncPositive ? DRM_EDID_PT_HSYNC_POSITIVE : 0) |
+					  (timing.vsyncPositive ? DRM_EDID_PT_VSYNC_POSITIVE : 0);
+}
+
+std::vector<uint8_t> create(const std::vector<DetailedTiming>& timings)
+{
+	std::vector<uint8_t> data(XENDISPL_EDID_BLOCK_SIZE, 0);
+
+	auto edidBlock = reinterpret_cast<edid*>(data.data());
+	int index = 0;
+
+	putEssentials(edidBlock);
+	putColorSpace(edidBlock);
+	putTimings(edidBlock);
+
+	for (auto& timing : timings)
+	{
+		if (index == EDID_MAX_DETAILED_TIMINGS)
+		{
+			break;
+		}
+
+		/* Don't put timings with truncated fields. */
+		if (!isValid(timing))
+		{
+			continue;
+		}
+
+		if (index == 0)
+		{
+			/* Screen size in cm, both or none of them are set. */
+			uint32_t widthCm = std::min((timing.widthMm + 5) / 10, 255u);
+			uint32_t heightCm = std::min((timing.heightMm + 5) / 10, 255u);
+
+			if (widthCm && heightCm)
+			{
+				edidBlock->width_cm = widthCm;
+				edidBlock->height_cm = heightCm;
+			}
+		}
+
+		putDetailedTiming(edidBlock, index++, timing);
+	}
+
+	putDisplayDescritor(edidBlock, index);
+	putBlockCheckSum(data.data());
+
+	return data;
+}
+
+bool isValid(const uint8_t* data, size_t size)
+{
+	const uint8_t edidHeader[] = {
+		0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00
+	};
+
+	if (size < XENDISPL_EDID_BLOCK_SIZE || size % XENDISPL_EDID_BLOCK_SIZE ||
+		size > XENDISPL_EDID_MAX_SIZE ||
+		memcmp(data, edidHeader, sizeof(edidHeader)))
+	{
+		return false;
+	}
+
+	auto edidBlock = reinterpret_cast<const edid*>(data);
+
+	if ((edidBlock->extensions + 1u) * XENDISPL_EDID_BLOCK_SIZE != size)
+	{
+		return false;
+	}
+
+	for (size_t offset = 0; offset < size; offset += XENDISPL_EDID_BLOCK_SIZE)
+	{
+		uint8_t checkSum = 0;
+
+		for (int i = 0; i < XENDISPL_EDID_BLOCK_SIZE; i++)
+		{
+			checkSum += data[offset + i];
+		}
+
+		if (checkSum)
+		{
+			return false;
+		}
+	}
+
+	return true;
 }
 
 void putTimings(edid* edidBlock)
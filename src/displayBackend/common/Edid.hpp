@@ -22,7 +22,9 @@
 
 #ifndef SRC_EDID_HPP_
 #define SRC_EDID_HPP_
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 struct edid;
 
 namespace Edid {
@@ -35,6 +37,71 @@ namespace Edid {
     /* EDID advertized manufacturing year. */
     const int EDID_MANUFACTURING_YEAR = 2020;
 
+	/* Detailed timings put into the base block, one descriptor is the name. */
+	const int EDID_MAX_DETAILED_TIMINGS = 3;
+
+	/**
+	 * Detailed timing of a display mode
+	 */
+	struct DetailedTiming
+	{
+		/* Pixel clock in kHz. */
+		uint32_t clock;
+
+		uint32_t hactive;
+		uint32_t hfront;
+		uint32_t hsync;
+		uint32_t hblank;
+
+		uint32_t vactive;
+		uint32_t vfront;
+		uint32_t vsync;
+		uint32_t vblank;
+
+		/* Physical image size. */
+		uint32_t widthMm;
+		uint32_t heightMm;
+
+		bool hsyncPositive;
+		bool vsyncPositive;
+	};
+
+	/**
+	 * Returns VESA CVT reduced blanking timing for the resolution. The
+	 * refresh rate is lowered if the pixel clock doesn't fit into the
+	 * detailed timing descriptor.
+	 * @param xres       X resolution
+	 * @param yres       Y resolution
+	 * @param refreshMhz refresh rate in mHz
+	 * @param dpi        DPI to derive physical size from
+	 */
+	DetailedTiming getTiming(uint32_t xres, uint32_t yres, uint32_t refreshMhz,
+							 uint32_t dpi);
+
+	/**
+	 * Checks that the timing fits into a detailed timing descriptor
+	 * @param timing timing
+	 */
+	bool isValid(const DetailedTiming& timing);
+
+	/**
+	 * Creates EDID base block
+	 * @param timings detailed timings in decreasing preference order, up to
+	 *                EDID_MAX_DETAILED_TIMINGS valid ones are used. Physical
+	 *                size of the first timing is the screen size of the
+	 *                display.
+	 * @return EDID of XENDISPL_EDID_BLOCK_SIZE octets
+	 */
+	std::vector<uint8_t> create(const std::vector<DetailedTiming>& timings);
+
+	/**
+	 * Checks that EDID has a valid header, block checksums and extension
+	 * count
+	 * @param data EDID data
+	 * @param size EDID size
+	 */
+	bool isValid(const uint8_t* data, size_t size);
+
     /**
 	 * Calculate and append checksum of the EDID block
 	 * @param edidBlock buffer with EDID block
@@ -79,6 +146,15 @@ namespace Edid {
        			    uint32_t xres, uint32_t yres,
 					uint32_t dpi);
 
+	/**
+	 * Put detailed timing into the EDID
+	 * @param edidBlock buffer with EDID block
+	 * @param index     index amid 4 possible 18 byte descriptors
+	 * @param timing    timing
+	 */
+	void putDetailedTiming(edid* edidBlock, int index,
+						   const DetailedTiming& timing);
+
 };
 
 #endif
@@ -0,0 +1,184 @@
+/*
+ *  Pixel format helpers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ */
+
+#include "PixelFormat.hpp"
+
+#include <drm_fourcc.h>
+
+#include <xen/be/Exception.hpp>
+
+namespace PixelFormat {
+
+namespace {
+
+/**
+ * Layout of the multi-planar format
+ */
+struct PlanarInfo
+{
+	size_t numPlanes;
+	// bytes per pixel for each plane
+	uint32_t cpp[3];
+	// chroma subsampling
+	uint32_t hsub;
+	uint32_t vsub;
+};
+
+bool getPlanarInfo(uint32_t format, PlanarInfo& info)
+{
+	switch (format)
+	{
+	case DRM_FORMAT_NV12:
+	case DRM_FORMAT_NV21:
+		info = {2, {1, 2, 0}, 2, 2};
+		return true;
+
+	case DRM_FORMAT_P010:
+		info = {2, {2, 4, 0}, 2, 2};
+		return true;
+
+	case DRM_FORMAT_YUV420:
+	case DRM_FORMAT_YVU420:
+		info = {3, {1, 1, 1}, 2, 2};
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+uint32_t getBpp(uint32_t format)
+{
+	PlanarInfo info;
+
+	if (getPlanarInfo(format, info))
+	{
+		return info.cpp[0] * 8;
+	}
+
+	switch (format)
+	{
+	case DRM_FORMAT_C8:
+	case DRM_FORMAT_RGB332:
+	case DRM_FORMAT_BGR233:
+		return 8;
+
+	case DRM_FORMAT_XRGB1555:
+	case DRM_FORMAT_XBGR1555:
+	case DRM_FORMAT_RGBX5551:
+	case DRM_FORMAT_BGRX5551:
+	case DRM_FORMAT_ARGB1555:
+	case DRM_FORMAT_ABGR1555:
+	case DRM_FORMAT_RGBA5551:
+	case DRM_FORMAT_BGRA5551:
+	case DRM_FORMAT_RGB565:
+	case DRM_FORMAT_BGR565:
+	case DRM_FORMAT_YUYV:
+		return 16;
+
+	case DRM_FORMAT_RGB888:
+	case DRM_FORMAT_BGR888:
+		return 24;
+
+	case DRM_FORMAT_XRGB8888:
+	case DRM_FORMAT_XBGR8888:
+	case DRM_FORMAT_RGBX8888:
+	case DRM_FORMAT_BGRX8888:
+	case DRM_FORMAT_XRGB2101010:
+	case DRM_FORMAT_XBGR2101010:
+	case DRM_FORMAT_RGBX1010102:
+	case DRM_FORMAT_BGRX1010102:
+	case DRM_FORMAT_ARGB2101010:
+	case DRM_FORMAT_ABGR2101010:
+	case DRM_FORMAT_RGBA1010102:
+	case DRM_FORMAT_BGRA1010102:
+	case DRM_FORMAT_ARGB8888:
+	case DRM_FORMAT_ABGR8888:
+	case DRM_FORMAT_RGBA8888:
+	case DRM_FORMAT_BGRA8888:
+		return 32;
+
+	default:
+		throw XenBackend::Exception("Invalid pixel format", EINVAL);
+	}
+}
+
+size_t getNumPlanes(uint32_t format)
+{
+	PlanarInfo info;
+
+	if (getPlanarInfo(format, info))
+	{
+		return info.numPlanes;
+	}
+
+	return 1;
+}
+
+uint32_t getBufferHeight(uint32_t format, uint32_t pitch, uint32_t height)
+{
+	if (pitch == 0)
+	{
+		return height;
+	}
+
+	auto planes = getPlanes(format, pitch, height);
+	auto& last = planes.back();
+
+	return (last.offset + last.pitch * last.height + pitch - 1) / pitch;
+}
+
+Planes getPlanes(uint32_t format, uint32_t pitch, uint32_t height)
+{
+	PlanarInfo info;
+
+	if (!getPlanarInfo(format, info))
+	{
+		return {{0, pitch, height}};
+	}
+
+	Planes planes;
+	uint32_t offset = 0;
+
+	for (size_t i = 0; i < info.numPlanes; i++)
+	{
+		Plane plane = {offset, pitch, height};
+
+		if (i > 0)
+		{
+			plane.pitch = pitch * info.cpp[i] / (info.cpp[0] * info.hsub);
+			plane.height = (height + info.vsub - 1) / info.vsub;
+		}
+
+		planes.push_back(plane);
+
+		offset += plane.pitch * plane.height;
+	}
+
+	return planes;
+}
+
+}
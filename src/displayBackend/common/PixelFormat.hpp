@@ -0,0 +1,79 @@
+/*
+ *  Pixel format helpers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ */
+
+#ifndef SRC_PIXELFORMAT_HPP_
+#define SRC_PIXELFORMAT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PixelFormat {
+
+/***************************************************************************//**
+ * Plane of the frame buffer.
+ * @ingroup display_itf
+ ******************************************************************************/
+struct Plane
+{
+	uint32_t offset;
+	uint32_t pitch;
+	uint32_t height;
+};
+
+/**
+ * Planes of the frame buffer
+ */
+typedef std::vector<Plane> Planes;
+
+/**
+ * Returns bits per pixel of the first plane
+ * @param format DRM fourcc pixel format
+ */
+uint32_t getBpp(uint32_t format);
+
+/**
+ * Returns number of planes
+ * @param format DRM fourcc pixel format
+ */
+size_t getNumPlanes(uint32_t format);
+
+/**
+ * Returns number of first plane lines the buffer shall have to keep all
+ * planes
+ * @param format DRM fourcc pixel format
+ * @param pitch  first plane pitch in bytes
+ * @param height frame height in pixels
+ */
+uint32_t getBufferHeight(uint32_t format, uint32_t pitch, uint32_t height);
+
+/**
+ * Returns planes of the buffer. Displif passes only one buffer and its stride
+ * per frame buffer, so planes are expected to follow each other without gaps
+ * and the pitch of the chroma planes is derived from the first plane one.
+ * @param format DRM fourcc pixel format
+ * @param pitch  first plane pitch in bytes
+ * @param height frame height in pixels
+ */
+Planes getPlanes(uint32_t format, uint32_t pitch, uint32_t height);
+
+}
+
+#endif /* SRC_PIXELFORMAT_HPP_ */
@@ -21,7 +21,9 @@
 
 #include "Connector.hpp"
 #include <cassert>
+#include <cstring>
 #include "Display.hpp"
+#include "Edid.hpp"
 
 using std::chrono::milliseconds;
 using std::list;
@@ -30,9 +32,40 @@ using std::mutex;
 using std::string;
 using std::this_thread::sleep_for;
 using std::to_string;
+using std::vector;
 
 using DisplayItf::FrameBufferPtr;
 
+namespace {
+
+Edid::DetailedTiming getTiming(const drmModeModeInfo& mode,
+							   uint32_t widthMm, uint32_t heightMm)
+{
+	Edid::DetailedTiming timing {};
+
+	timing.clock = mode.clock;
+
+	timing.hactive = mode.hdisplay;
+	timing.hfront = mode.hsync_start - mode.hdisplay;
+	timing.hsync = mode.hsync_end - mode.hsync_start;
+	timing.hblank = mode.htotal - mode.hdisplay;
+
+	timing.vactive = mode.vdisplay;
+	timing.vfront = mode.vsync_start - mode.vdisplay;
+	timing.vsync = mode.vsync_end - mode.vsync_start;
+	timing.vblank = mode.vtotal - mode.vdisplay;
+
+	timing.widthMm = widthMm;
+	timing.heightMm = heightMm;
+
+	timing.hsyncPositive = mode.flags & DRM_MODE_FLAG_PHSYNC;
+	timing.vsyncPositive = mode.flags & DRM_MODE_FLAG_PVSYNC;
+
+	return timing;
+}
+
+}
+
 namespace Drm {
 
 mutex Connector::sMutex;
@@ -86,6 +119,11 @@ void Connector::init(uint32_t width, uint32_t height,
 	
 	lock_guard<mutex> lock(sMutex);
 
+	// the monitor may be replugged since the connector is created
+	mConnector.update(mFd);
+
+	invalidateEDID();
+
 	if (mConnector->connection != DRM_MODE_CONNECTED)
 	{
 		throw Exception("Connector is not connected", EINVAL);
@@ -185,6 +223,141 @@ void Connector::pageFlip(FrameBufferPtr frameBuffer, FlipCallback cbk)
  * Private
  ******************************************************************************/
 
+vector<uint8_t> Connector::createEDID() const
+{
+	try
+	{
+		for (int i = 0; i < mConnector->count_props; i++)
+		{
+			ModeProperty property(mFd, mConnector->props[i]);
+
+			if (strcmp(property->name, "EDID") || !mConnector->prop_values[i])
+			{
+				continue;
+			}
+
+			ModePropertyBlob blob(mFd, mConnector->prop_values[i]);
+
+			auto data = static_cast<const uint8_t*>(blob->data);
+
+			if (!Edid::isValid(data, blob->length))
+			{
+				LOG(mLog, WARNING) << "Invalid monitor EDID, size: "
+								   << blob->length;
+
+				break;
+			}
+
+			LOG(mLog, DEBUG) << "Use monitor EDID, size: " << blob->length;
+
+			return vector<uint8_t>(data, data + blob->length);
+		}
+	}
+	catch(const std::exception& e)
+	{
+		LOG(mLog, WARNING) << "Can't read monitor EDID: " << e.what();
+	}
+
+	return createModesEDID();
+}
+
+vector<uint8_t> Connector::createModesEDID() const
+{
+	vector<int> indexes;
+
+	auto cfgIndex = findModeIndex(mCfgWidth, mCfgHeight);
+
+	if (cfgIndex >= 0)
+	{
+		indexes.push_back(cfgIndex);
+	}
+
+	for (int i = 0; i < mConnector->count_modes; i++)
+	{
+		if (i != cfgIndex &&
+			(mConnector->modes[i].type & DRM_MODE_TYPE_PREFERRED))
+		{
+			indexes.push_back(i);
+		}
+	}
+
+	for (int i = 0; i < mConnector->count_modes; i++)
+	{
+		if (i != cfgIndex &&
+			!(mConnector->modes[i].type & DRM_MODE_TYPE_PREFERRED))
+		{
+			indexes.push_back(i);
+		}
+	}
+
+	vector<Edid::DetailedTiming> timings;
+	bool cfgFound = false;
+
+	for (auto i : indexes)
+	{
+		auto& mode = mConnector->modes[i];
+
+		if (mode.flags & (DRM_MODE_FLAG_INTERLACE | DRM_MODE_FLAG_DBLSCAN))
+		{
+			continue;
+		}
+
+		auto timing = getTiming(mode, mConnector->mmWidth,
+								mConnector->mmHeight);
+
+		if (!Edid::isValid(timing))
+		{
+			continue;
+		}
+
+		timings.push_back(timing);
+
+		cfgFound |= i == cfgIndex;
+
+		if (timings.size() == Edid::EDID_MAX_DETAILED_TIMINGS)
+		{
+			break;
+		}
+	}
+
+	if (!cfgFound)
+	{
+		/*
+		 * The configured resolution is not supported by the monitor, keep
+		 * it preferred at the monitor refresh rate and pixel density.
+		 */
+		uint32_t refreshMhz = Edid::EDID_REFRESH_RATE_HZ * 1000;
+		auto timing = Edid::getTiming(mCfgWidth, mCfgHeight, refreshMhz,
+									  Edid::EDID_DPI);
+
+		if (!timings.empty())
+		{
+			auto& first = timings.front();
+
+			refreshMhz = static_cast<uint64_t>(first.clock) * 1000000 /
+						 ((first.hactive + first.hblank) *
+						  (first.vactive + first.vblank));
+
+			timing = Edid::getTiming(mCfgWidth, mCfgHeight, refreshMhz,
+									 Edid::EDID_DPI);
+
+			if (first.widthMm && first.heightMm)
+			{
+				timing.widthMm = first.widthMm * mCfgWidth / first.hactive;
+				timing.heightMm = first.heightMm * mCfgHeight / first.vactive;
+			}
+		}
+
+		timings.insert(timings.begin(), timing);
+	}
+
+	LOG(mLog, DEBUG) << "Create EDID from modes, timings: " << timings.size()
+					 << ", size: " << mConnector->mmWidth << "x"
+					 << mConnector->mmHeight << " mm";
+
+	return Edid::create(timings);
+}
+
 uint32_t Connector::findCrtcId()
 {
 	auto crtcId = getAssignedCrtcId();
@@ -267,21 +440,43 @@ uint32_t Connector::findMatchingCrtcId()
 	return cInvalidId;
 }
 
-drmModeModeInfoPtr Connector::findMode(uint32_t width, uint32_t height)
+int Connector::findModeIndex(uint32_t width, uint32_t height) const
 {
+	int index = -1;
+
 	for (int i = 0; i < mConnector->count_modes; i++)
 	{
 		if (mConnector->modes[i].hdisplay == width &&
 			mConnector->modes[i].vdisplay == height)
 		{
-			LOG(mLog, DEBUG) << "Found mode: " << mConnector->modes[i].name
-							 << ", con id: " << mConnector->connector_id;
+			if (mConnector->modes[i].type & DRM_MODE_TYPE_PREFERRED)
+			{
+				return i;
+			}
 
-			return &mConnector->modes[i];
+			if (index < 0)
+			{
+				index = i;
+			}
 		}
 	}
 
-	return nullptr;
+	return index;
+}
+
+drmModeModeInfoPtr Connector::findMode(uint32_t width, uint32_t height)
+{
+	auto index = findModeIndex(width, height);
+
+	if (index < 0)
+	{
+		return nullptr;
+	}
+
+	LOG(mLog, DEBUG) << "Found mode: " << mConnector->modes[index].name
+					 << ", con id: " << mConnector->connector_id;
+
+	return &mConnector->modes[index];
 }
 
 void Connector::flipFinished()
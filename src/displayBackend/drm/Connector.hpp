@@ -87,6 +87,12 @@ public:
 	 */
 	void release() override;
 
+	/**
+	 * Checks if a page flip is pending
+	 * @return <i>true</i> if the previous page flip is not done yet
+	 */
+	bool isFlipPending() const override { return mFlipPending; }
+
 	/**
 	 * Performs page flip
 	 * @param frameBuffer frame buffer
@@ -110,10 +116,14 @@ private:
 	std::atomic_bool mFlipPending;
 	FlipCallback mFlipCallback;
 
+	std::vector<uint8_t> createEDID() const override;
+	std::vector<uint8_t> createModesEDID() const;
+
 	uint32_t findCrtcId();
 	uint32_t getAssignedCrtcId();
 	uint32_t findMatchingCrtcId();
 	bool isCrtcIdUsedByOther(uint32_t crtcId);
+	int findModeIndex(uint32_t width, uint32_t height) const;
 	drmModeModeInfoPtr findMode(uint32_t width, uint32_t height);
 
 	friend class Display;
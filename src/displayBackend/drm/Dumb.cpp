@@ -32,6 +32,7 @@
 #include <xen/be/XenGnttab.hpp>
 #endif
 
+#include "BufferCopy.hpp"
 #include "Exception.hpp"
 
 using std::string;
@@ -155,12 +156,10 @@ void DumbDrm::copy()
 		memcpy(mBuffer, mGnttabBuffer->get(), mSize);
 		return;
 	}
-	auto src = reinterpret_cast<uint8_t*>(mGnttabBuffer->get());
-	auto dst = reinterpret_cast<uint8_t*>(mBuffer);
-	for (unsigned int i = 0; i < mHeight; i++)
-	{
-		memcpy(dst + i * mBackStride, src + i * mFrontStride, mFrontStride);
-	}
+
+	BufferCopy::copyRows(reinterpret_cast<uint8_t*>(mBuffer), mBackStride,
+						 reinterpret_cast<uint8_t*>(mGnttabBuffer->get()),
+						 mFrontStride, mHeight);
 }
 
 /*******************************************************************************
@@ -21,11 +21,14 @@
 
 #include "FrameBuffer.hpp"
 
+#include <xf86drm.h>
 #include <xf86drmMode.h>
+#include <drm_fourcc.h>
 
 #include <xen/be/Log.hpp>
 
 #include "Exception.hpp"
+#include "PixelFormat.hpp"
 
 using std::string;
 
@@ -75,12 +78,36 @@ FrameBuffer::~FrameBuffer()
 void FrameBuffer::init(uint32_t pixelFormat)
 {
 	uint32_t handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0};
+	uint64_t modifiers[4] = {0};
+	uint64_t hasModifiers = 0;
 
-	handles[0] = mDisplayBuffer->getHandle();
-	pitches[0] = mDisplayBuffer->getStride();
+	auto planes = PixelFormat::getPlanes(pixelFormat,
+										 mDisplayBuffer->getStride(), mHeight);
 
-	auto ret = drmModeAddFB2(mDrmFd, mWidth, mHeight, pixelFormat,
-							 handles, pitches, offsets, &mId, 0);
+	for (size_t i = 0; i < planes.size(); i++)
+	{
+		handles[i] = mDisplayBuffer->getHandle();
+		pitches[i] = planes[i].pitch;
+		offsets[i] = planes[i].offset;
+		modifiers[i] = DRM_FORMAT_MOD_LINEAR;
+	}
+
+	int ret = 0;
+
+	// Dumb buffers are linear. Pass the layout explicitly if the device
+	// supports modifiers, so the driver doesn't assume the implicit one.
+	if (drmGetCap(mDrmFd, DRM_CAP_ADDFB2_MODIFIERS, &hasModifiers) == 0 &&
+		hasModifiers)
+	{
+		ret = drmModeAddFB2WithModifiers(mDrmFd, mWidth, mHeight, pixelFormat,
+										 handles, pitches, offsets, modifiers,
+										 &mId, DRM_MODE_FB_MODIFIERS);
+	}
+	else
+	{
+		ret = drmModeAddFB2(mDrmFd, mWidth, mHeight, pixelFormat,
+							handles, pitches, offsets, &mId, 0);
+	}
 
 	if (ret)
 	{
@@ -88,6 +115,7 @@ void FrameBuffer::init(uint32_t pixelFormat)
 	}
 
 	DLOG("FrameBuffer", DEBUG) << "Create frame buffer, handle: " << handles[0]
+							  << ", planes: " << planes.size()
 							  << ", id: " << mId;
 }
 
@@ -82,6 +82,20 @@ ModeConnector::~ModeConnector()
 	}
 }
 
+void ModeConnector::update(int fd)
+{
+	auto data = drmModeGetConnector(fd, mData->connector_id);
+
+	if (!data)
+	{
+		throw Exception("Cannot retrieve DRM connector", errno);
+	}
+
+	drmModeFreeConnector(mData);
+
+	mData = data;
+}
+
 /*******************************************************************************
  * ModeEncoder
  ******************************************************************************/
@@ -111,4 +125,50 @@ ModeEncoder::~ModeEncoder()
 	}
 }
 
+/*******************************************************************************
+ * ModeProperty
+ ******************************************************************************/
+
+ModeProperty::ModeProperty(int fd, uint32_t propertyId)
+{
+	mData = drmModeGetProperty(fd, propertyId);
+
+	if (!mData)
+	{
+		throw Exception("Cannot retrieve DRM property: " +
+						to_string(propertyId), errno);
+	}
+}
+
+ModeProperty::~ModeProperty()
+{
+	if (mData)
+	{
+		drmModeFreeProperty(mData);
+	}
+}
+
+/*******************************************************************************
+ * ModePropertyBlob
+ ******************************************************************************/
+
+ModePropertyBlob::ModePropertyBlob(int fd, uint32_t blobId)
+{
+	mData = drmModeGetPropertyBlob(fd, blobId);
+
+	if (!mData)
+	{
+		throw Exception("Cannot retrieve DRM property blob: " +
+						to_string(blobId), errno);
+	}
+}
+
+ModePropertyBlob::~ModePropertyBlob()
+{
+	if (mData)
+	{
+		drmModeFreePropertyBlob(mData);
+	}
+}
+
 }
@@ -95,6 +95,12 @@ public:
 	ModeConnector(int fd, int connectorId);
 
 	~ModeConnector();
+
+	/**
+	 * Retrieves the connector object again to get the current state
+	 * @param fd DRM device file descriptor
+	 */
+	void update(int fd);
 };
 
 /***************************************************************************//**
@@ -116,6 +122,44 @@ public:
 	~ModeEncoder();
 };
 
+/***************************************************************************//**
+ * Wrapper for DRM mode property object.
+ * It creates the DRM mode property object in the constructor and
+ * deletes it in the destructor.
+ * @ingroup drm
+ ******************************************************************************/
+class ModeProperty : public ModeData<drmModePropertyPtr>
+{
+public:
+
+	/**
+	 * @param fd         DRM device file descriptor
+	 * @param propertyId property id
+	 */
+	ModeProperty(int fd, uint32_t propertyId);
+
+	~ModeProperty();
+};
+
+/***************************************************************************//**
+ * Wrapper for DRM mode property blob object.
+ * It creates the DRM mode property blob object in the constructor and
+ * deletes it in the destructor.
+ * @ingroup drm
+ ******************************************************************************/
+class ModePropertyBlob : public ModeData<drmModePropertyBlobPtr>
+{
+public:
+
+	/**
+	 * @param fd     DRM device file descriptor
+	 * @param blobId blob id
+	 */
+	ModePropertyBlob(int fd, uint32_t blobId);
+
+	~ModePropertyBlob();
+};
+
 }
 
 #endif /* SRC_DRM_MODES_HPP_ */
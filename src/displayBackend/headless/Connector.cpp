@@ -0,0 +1,150 @@
+/*
+ *  Headless connector
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "Connector.hpp"
+
+#include <cassert>
+
+using std::function;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+
+using DisplayItf::FrameBufferPtr;
+
+namespace Headless {
+
+/*******************************************************************************
+ * Connector
+ ******************************************************************************/
+
+Connector::Connector(domid_t domId, const string& name,
+					 uint32_t width, uint32_t height,
+					 function<void()> flipRequested) :
+	ConnectorBase(domId, width, height),
+	mName(name),
+	mInitialized(false),
+	mFlipRequested(flipRequested),
+	mFlipCallback(nullptr)
+{
+	LOG(mLog, DEBUG) << "Create, name: " << mName;
+}
+
+Connector::~Connector()
+{
+	if (mFlipCallback)
+	{
+		LOG(mLog, WARNING) << "Delete connector on pending flip, name: "
+						   << mName;
+	}
+
+	LOG(mLog, DEBUG) << "Delete, name: " << mName;
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void Connector::init(uint32_t width, uint32_t height,
+					 FrameBufferPtr frameBuffer)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	mFrameBuffer = frameBuffer;
+	mInitialized = true;
+
+	LOG(mLog, DEBUG) << "Init, name: " << mName << ", w: " << width
+					 << ", h: " << height;
+}
+
+void Connector::release()
+{
+	lock_guard<mutex> lock(mMutex);
+
+	mFrameBuffer.reset();
+	mInitialized = false;
+
+	LOG(mLog, DEBUG) << "Release, name: " << mName;
+}
+
+bool Connector::isFlipPending() const
+{
+	lock_guard<mutex> lock(mMutex);
+
+	return static_cast<bool>(mFlipCallback);
+}
+
+void Connector::pageFlip(FrameBufferPtr frameBuffer, FlipCallback cbk)
+{
+	assert(frameBuffer);
+
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		if (!mInitialized)
+		{
+			throw Exception("Connector is not initialized", EINVAL);
+		}
+
+		if (mFlipCallback)
+		{
+			throw Exception("Page flip is already pending", EBUSY);
+		}
+
+		mFrameBuffer = frameBuffer;
+		mFlipCallback = cbk ? cbk : [] {};
+	}
+
+	DLOG(mLog, DEBUG) << "Page flip, name: " << mName;
+
+	if (mFlipRequested)
+	{
+		mFlipRequested();
+	}
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+bool Connector::onVblank()
+{
+	FlipCallback cbk;
+
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		cbk.swap(mFlipCallback);
+	}
+
+	if (!cbk)
+	{
+		return false;
+	}
+
+	DLOG(mLog, DEBUG) << "Flip done, name: " << mName;
+
+	cbk();
+
+	return true;
+}
+
+}
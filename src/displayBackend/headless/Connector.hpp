@@ -0,0 +1,120 @@
+/*
+ *  Headless connector
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_HEADLESS_CONNECTOR_HPP_
+#define SRC_HEADLESS_CONNECTOR_HPP_
+
+#include <functional>
+#include <mutex>
+
+#include "ConnectorBase.hpp"
+#include "Exception.hpp"
+
+namespace Headless {
+
+class Display;
+
+/***************************************************************************//**
+ * Connector which is always connected. Page flips are completed by the
+ * display on the next simulated vblank.
+ * @ingroup headless
+ ******************************************************************************/
+class Connector : public ConnectorBase
+{
+public:
+
+	/**
+	 * @param domId         domain id
+	 * @param name          connector name
+	 * @param width         connector width as configured in XenStore
+	 * @param height        connector height as configured in XenStore
+	 * @param flipRequested called when a page flip is requested
+	 */
+	Connector(domid_t domId, const std::string& name,
+			  uint32_t width, uint32_t height,
+			  std::function<void()> flipRequested);
+
+	~Connector();
+
+	/**
+	 * Returns connector name
+	 */
+	std::string getName() const override { return mName; }
+
+	/**
+	 * Checks if the connector is connected
+	 * @return <i>true</i> if connected
+	 */
+	bool isConnected() const override { return true; }
+
+	/**
+	 * Checks if the connector is initialized
+	 * @return <i>true</i> if initialized
+	 */
+	bool isInitialized() const override { return mInitialized; }
+
+	/**
+	 * Checks if a page flip is pending
+	 * @return <i>true</i> if the previous page flip is not done yet
+	 */
+	bool isFlipPending() const override;
+
+	/**
+	 * Initializes connector
+	 * @param width       width
+	 * @param height      height
+	 * @param frameBuffer frame buffer
+	 */
+	void init(uint32_t width, uint32_t height,
+			  DisplayItf::FrameBufferPtr frameBuffer) override;
+
+	/**
+	 * Releases the previously initialized connector
+	 */
+	void release() override;
+
+	/**
+	 * Performs page flip
+	 * @param frameBuffer frame buffer
+	 * @param cbk         callback which will be called when page flip is done
+	 */
+	void pageFlip(DisplayItf::FrameBufferPtr frameBuffer,
+				  FlipCallback cbk) override;
+
+private:
+
+	std::string mName;
+	bool mInitialized;
+	std::function<void()> mFlipRequested;
+	mutable std::mutex mMutex;
+	DisplayItf::FrameBufferPtr mFrameBuffer;
+	FlipCallback mFlipCallback;
+
+	friend class Display;
+
+	bool onVblank();
+};
+
+typedef std::shared_ptr<Connector> ConnectorPtr;
+
+}
+
+#endif /* SRC_HEADLESS_CONNECTOR_HPP_ */
@@ -0,0 +1,256 @@
+/*
+ *  Headless display
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "Display.hpp"
+
+#include <vector>
+
+#include "DisplayBuffer.hpp"
+#include "Exception.hpp"
+#include "FrameBuffer.hpp"
+
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+using std::lock_guard;
+using std::make_shared;
+using std::mutex;
+using std::string;
+using std::thread;
+using std::unique_lock;
+using std::vector;
+
+using DisplayItf::DisplayBufferPtr;
+using DisplayItf::FrameBufferPtr;
+
+namespace Headless {
+
+/*******************************************************************************
+ * Display
+ ******************************************************************************/
+
+Display::Display(uint32_t refreshRate) :
+	mRefreshRate(refreshRate),
+	mLog("HeadlessDisplay"),
+	mTerminate(false),
+	mFlipRequested(false),
+	mVblanks(Metrics::Collector::getInstance().getCounter("headless.vblanks")),
+	mFlips(Metrics::Collector::getInstance().getCounter("headless.flips"))
+{
+	LOG(mLog, DEBUG) << "Create, refresh rate: " << mRefreshRate;
+}
+
+Display::~Display()
+{
+	stop();
+
+	LOG(mLog, DEBUG) << "Delete";
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void Display::start()
+{
+	DLOG(mLog, DEBUG) << "Start";
+
+	if (mThread.joinable())
+	{
+		throw Exception("Display already started", EPERM);
+	}
+
+	mTerminate = false;
+
+	mThread = thread(&Display::vblankThread, this);
+}
+
+void Display::stop()
+{
+	DLOG(mLog, DEBUG) << "Stop";
+
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		mTerminate = true;
+	}
+
+	mCondVar.notify_all();
+
+	if (mThread.joinable())
+	{
+		mThread.join();
+	}
+}
+
+DisplayItf::ConnectorPtr Display::createConnector(domid_t domId,
+												  const string& name,
+												  uint32_t width,
+												  uint32_t height)
+{
+	LOG(mLog, DEBUG) << "Create connector, name: " << name
+					 << ", dom: " << domId;
+
+	auto connector = make_shared<Connector>(domId, name, width, height,
+											[this] { onFlipRequested(); });
+
+	lock_guard<mutex> lock(mMutex);
+
+	mConnectors.remove_if([](const std::weak_ptr<Connector>& connector)
+						  { return connector.expired(); });
+
+	mConnectors.push_back(connector);
+
+	return connector;
+}
+
+DisplayBufferPtr Display::createDisplayBuffer(uint32_t width, uint32_t height,
+											  uint32_t bpp, size_t offset)
+{
+	return make_shared<DisplayBuffer>(width, height, bpp, offset);
+}
+
+DisplayBufferPtr Display::createDisplayBuffer(uint32_t width, uint32_t height,
+											  uint32_t bpp, size_t offset,
+											  domid_t domId, GrantRefs& refs,
+											  bool allocRefs)
+{
+	if (allocRefs)
+	{
+		throw Exception("Allocating refs is not supported", EINVAL);
+	}
+
+	return make_shared<DisplayBuffer>(width, height, bpp, offset,
+									  domId, refs);
+}
+
+FrameBufferPtr Display::createFrameBuffer(DisplayBufferPtr displayBuffer,
+										  uint32_t width, uint32_t height,
+										  uint32_t pixelFormat)
+{
+	return make_shared<FrameBuffer>(displayBuffer, width, height,
+									pixelFormat);
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void Display::onFlipRequested()
+{
+	if (mRefreshRate)
+	{
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		mFlipRequested = true;
+	}
+
+	mCondVar.notify_all();
+}
+
+void Display::vblankThread()
+{
+	auto period = mRefreshRate ? microseconds(1000000 / mRefreshRate) :
+								 microseconds(0);
+	auto next = steady_clock::now() + period;
+
+	unique_lock<mutex> lock(mMutex);
+
+	while(!mTerminate)
+	{
+		if (mRefreshRate)
+		{
+			mCondVar.wait_until(lock, next, [this] { return mTerminate; });
+
+			auto now = steady_clock::now();
+
+			if (now < next)
+			{
+				continue;
+			}
+
+			// skip missed vblanks as a real display does
+			next += period;
+
+			if (next <= now)
+			{
+				next = now + period;
+			}
+		}
+		else
+		{
+			mCondVar.wait(lock, [this] { return mTerminate || mFlipRequested; });
+
+			mFlipRequested = false;
+		}
+
+		if (mTerminate)
+		{
+			break;
+		}
+
+		lock.unlock();
+
+		vblank();
+
+		lock.lock();
+	}
+}
+
+void Display::vblank()
+{
+	vector<ConnectorPtr> connectors;
+
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		for (auto& connector : mConnectors)
+		{
+			if (auto ptr = connector.lock())
+			{
+				connectors.push_back(ptr);
+			}
+		}
+	}
+
+	mVblanks.add();
+
+	// flip callbacks send events to the frontend, don't hold the lock
+	for (auto& connector : connectors)
+	{
+		try
+		{
+			if (connector->onVblank())
+			{
+				mFlips.add();
+			}
+		}
+		catch(const std::exception& e)
+		{
+			LOG(mLog, ERROR) << e.what();
+		}
+	}
+}
+
+}
@@ -0,0 +1,154 @@
+/*
+ *  Headless display
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_HEADLESS_DISPLAY_HPP_
+#define SRC_HEADLESS_DISPLAY_HPP_
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#include <xen/be/Log.hpp>
+
+#include "Connector.hpp"
+#include "DisplayItf.hpp"
+#include "Metrics.hpp"
+
+namespace Headless {
+
+/***************************************************************************//**
+ * @defgroup headless Headless
+ * In-process display which keeps buffers in memory and simulates vblank.
+ * It is used to measure the backend without DRM or Wayland.
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * Headless Display class.
+ * @ingroup headless
+ ******************************************************************************/
+class Display : public DisplayItf::Display
+{
+public:
+
+	static const uint32_t cDefaultRefreshRate = 60;
+
+	/**
+	 * @param refreshRate simulated vblank rate in Hz, 0 completes page flips
+	 *                    as soon as possible
+	 */
+	explicit Display(uint32_t refreshRate = cDefaultRefreshRate);
+
+	~Display();
+
+	/**
+	 * Starts vblank simulation
+	 */
+	void start() override;
+
+	/**
+	 * Stops vblank simulation
+	 */
+	void stop() override;
+
+	/**
+	 * Flushes events
+	 */
+	void flush() override {}
+
+	/**
+	 * Creates connector
+	 * @param domId  domain id
+	 * @param name   connector name
+	 * @param width  connector width as configured in XenStore
+	 * @param height connector height as configured in XenStore
+	 */
+	DisplayItf::ConnectorPtr createConnector(domid_t domId,
+											 const std::string& name,
+											 uint32_t width,
+											 uint32_t height) override;
+
+	/**
+	 * Creates display buffer
+	 * @param width  width
+	 * @param height height
+	 * @param bpp    bits per pixel
+	 * @param offset offset of the data in the buffer
+	 * @return shared pointer to the display buffer
+	 */
+	DisplayItf::DisplayBufferPtr createDisplayBuffer(
+			uint32_t width, uint32_t height, uint32_t bpp,
+			size_t offset) override;
+
+	/**
+	 * Creates display buffer with associated grand table buffer
+	 * @param width     width
+	 * @param height    height
+	 * @param bpp       bits per pixel
+	 * @param offset    offset of the data in the buffer
+	 * @param domId     domain id
+	 * @param refs      grant table references
+	 * @param allocRefs not supported, shall be false
+	 * @return shared pointer to the display buffer
+	 */
+	DisplayItf::DisplayBufferPtr createDisplayBuffer(
+			uint32_t width, uint32_t height, uint32_t bpp, size_t offset,
+			domid_t domId, GrantRefs& refs,
+			bool allocRefs) override;
+
+	/**
+	 * Creates frame buffer
+	 * @param displayBuffer pointer to the display buffer
+	 * @param width         width
+	 * @param height        height
+	 * @param pixelFormat   pixel format
+	 * @return shared pointer to the frame buffer
+	 */
+	DisplayItf::FrameBufferPtr createFrameBuffer(
+			DisplayItf::DisplayBufferPtr displayBuffer,
+			uint32_t width, uint32_t height, uint32_t pixelFormat) override;
+
+private:
+
+	uint32_t mRefreshRate;
+	XenBackend::Log mLog;
+
+	std::mutex mMutex;
+	std::condition_variable mCondVar;
+	bool mTerminate;
+	bool mFlipRequested;
+	std::thread mThread;
+
+	std::list<std::weak_ptr<Connector>> mConnectors;
+
+	Metrics::Counter& mVblanks;
+	Metrics::Counter& mFlips;
+
+	void onFlipRequested();
+	void vblankThread();
+	void vblank();
+};
+
+typedef std::shared_ptr<Display> DisplayPtr;
+
+}
+
+#endif /* SRC_HEADLESS_DISPLAY_HPP_ */
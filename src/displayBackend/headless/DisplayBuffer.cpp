@@ -0,0 +1,124 @@
+/*
+ *  Headless display buffer
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "DisplayBuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <sys/mman.h>
+
+#include "Exception.hpp"
+
+using XenBackend::XenGnttabBuffer;
+
+namespace Headless {
+
+/*******************************************************************************
+ * DisplayBuffer
+ ******************************************************************************/
+
+DisplayBuffer::DisplayBuffer(uint32_t width, uint32_t height, uint32_t bpp,
+							 size_t offset, domid_t domId,
+							 const GrantRefs& refs) :
+	mWidth(width),
+	mHeight(height),
+	mStride(4 * ((width * bpp + 31) / 32)),
+	mSize(static_cast<size_t>(mStride) * height),
+	mBuffer(nullptr),
+	mLog("HeadlessBuffer")
+{
+	try
+	{
+		init(offset, domId, refs);
+	}
+	catch(const std::exception& e)
+	{
+		release();
+
+		throw;
+	}
+}
+
+DisplayBuffer::~DisplayBuffer()
+{
+	release();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void DisplayBuffer::copy()
+{
+	if (!mGnttabBuffer)
+	{
+		throw Exception("There is no buffer to copy from", EINVAL);
+	}
+
+	DLOG(mLog, DEBUG) << "Copy buffer, size: " << mSize;
+
+	// strides of both buffers are the same
+	memcpy(mBuffer, mGnttabBuffer->get(),
+		   std::min(mSize, mGnttabBuffer->size()));
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void DisplayBuffer::init(size_t offset, domid_t domId, const GrantRefs& refs)
+{
+	if (refs.size())
+	{
+		mGnttabBuffer.reset(
+				new XenGnttabBuffer(domId, refs.data(), refs.size(),
+									PROT_READ | PROT_WRITE, offset));
+	}
+
+	auto map = mmap(nullptr, mSize, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (map == MAP_FAILED)
+	{
+		throw Exception("Cannot allocate buffer", errno);
+	}
+
+	mBuffer = map;
+
+	DLOG(mLog, DEBUG) << "Create buffer, width: " << mWidth
+					  << ", height: " << mHeight << ", size: " << mSize
+					  << ", stride: " << mStride;
+}
+
+void DisplayBuffer::release()
+{
+	if (mBuffer)
+	{
+		munmap(mBuffer, mSize);
+
+		mBuffer = nullptr;
+	}
+
+	DLOG(mLog, DEBUG) << "Delete buffer";
+}
+
+}
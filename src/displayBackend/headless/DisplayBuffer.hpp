@@ -0,0 +1,114 @@
+/*
+ *  Headless display buffer
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_HEADLESS_DISPLAYBUFFER_HPP_
+#define SRC_HEADLESS_DISPLAYBUFFER_HPP_
+
+#include <memory>
+
+#include <xen/be/Log.hpp>
+#include <xen/be/XenGnttab.hpp>
+
+#include "DisplayItf.hpp"
+
+namespace Headless {
+
+/***************************************************************************//**
+ * Display buffer in anonymous memory. The content is copied from the
+ * associated grant table buffer as DRM dumb buffers do.
+ * @ingroup headless
+ ******************************************************************************/
+class DisplayBuffer : public DisplayItf::DisplayBuffer
+{
+public:
+
+	/**
+	 * @param width  buffer width
+	 * @param height buffer height
+	 * @param bpp    bits per pixel
+	 * @param offset offset of the data in the buffer
+	 * @param domId  domain id
+	 * @param refs   grant table refs
+	 */
+	DisplayBuffer(uint32_t width, uint32_t height, uint32_t bpp,
+				  size_t offset = 0, domid_t domId = 0,
+				  const GrantRefs& refs = GrantRefs());
+
+	~DisplayBuffer();
+
+	/**
+	 * Returns buffer size
+	 */
+	size_t getSize() const override { return mSize; }
+
+	/**
+	 * Returns pointer to the data buffer
+	 */
+	void* getBuffer() const override { return mBuffer; }
+
+	/**
+	 * Gets stride
+	 */
+	uint32_t getStride() const override { return mStride; }
+
+	/**
+	 * Gets handle
+	 */
+	uintptr_t getHandle() const override { return 0; }
+
+	/**
+	 * Gets fd
+	 */
+	int getFd() const override { return -1; }
+
+	/**
+	 * Reads name
+	 */
+	uint32_t readName() override { return 0; }
+
+	/**
+	 * Indicates if copy operation shall be applied
+	 */
+	bool needsCopy() override { return static_cast<bool>(mGnttabBuffer); }
+
+	/**
+	 * Copies data from associated grant table buffer
+	 */
+	void copy() override;
+
+private:
+
+	uint32_t mWidth;
+	uint32_t mHeight;
+	uint32_t mStride;
+	size_t mSize;
+	void* mBuffer;
+	XenBackend::Log mLog;
+
+	std::unique_ptr<XenBackend::XenGnttabBuffer> mGnttabBuffer;
+
+	void init(size_t offset, domid_t domId, const GrantRefs& refs);
+	void release();
+};
+
+}
+
+#endif /* SRC_HEADLESS_DISPLAYBUFFER_HPP_ */
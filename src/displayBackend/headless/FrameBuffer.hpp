@@ -0,0 +1,83 @@
+/*
+ *  Headless frame buffer
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_HEADLESS_FRAMEBUFFER_HPP_
+#define SRC_HEADLESS_FRAMEBUFFER_HPP_
+
+#include "DisplayItf.hpp"
+
+namespace Headless {
+
+/***************************************************************************//**
+ * Frame buffer which only refers to its display buffer.
+ * @ingroup headless
+ ******************************************************************************/
+class FrameBuffer : public DisplayItf::FrameBuffer
+{
+public:
+
+	/**
+	 * @param displayBuffer display buffer
+	 * @param width         frame buffer width
+	 * @param height        frame buffer height
+	 * @param pixelFormat   frame buffer pixel format
+	 */
+	FrameBuffer(DisplayItf::DisplayBufferPtr displayBuffer,
+				uint32_t width, uint32_t height, uint32_t pixelFormat) :
+		mDisplayBuffer(displayBuffer),
+		mWidth(width),
+		mHeight(height),
+		mPixelFormat(pixelFormat) {}
+
+	/**
+	 * Gets width
+	 */
+	uint32_t getWidth() const override { return mWidth; }
+
+	/**
+	 * Gets height
+	 */
+	uint32_t getHeight() const override { return mHeight; }
+
+	/**
+	 * Gets pixel format
+	 */
+	uint32_t getPixelFormat() const { return mPixelFormat; }
+
+	/**
+	 * Returns pointer to the display buffer
+	 */
+	DisplayItf::DisplayBufferPtr getDisplayBuffer() override
+	{
+		return mDisplayBuffer;
+	}
+
+private:
+
+	DisplayItf::DisplayBufferPtr mDisplayBuffer;
+	uint32_t mWidth;
+	uint32_t mHeight;
+	uint32_t mPixelFormat;
+};
+
+}
+
+#endif /* SRC_HEADLESS_FRAMEBUFFER_HPP_ */
@@ -47,7 +47,13 @@ SurfacePtr Compositor::createSurface()
 {
 	LOG(mLog, DEBUG) << "Create surface";
 
-	return SurfacePtr(new Surface(mWlCompositor));
+	SurfacePtr surface(new Surface(mWlCompositor, mPresentation));
+
+#ifdef WITH_DMABUF_ZCOPY
+	surface->mExplicitSync = mExplicitSync;
+#endif
+
+	return surface;
 }
 
 void Compositor::displayRpundtrip()
@@ -59,6 +65,23 @@ void Compositor::displayRpundtrip()
  * Private
  ******************************************************************************/
 
+void Compositor::setPresentation(PresentationPtr presentation)
+{
+	LOG(mLog, DEBUG) << "Use presentation feedback";
+
+	mPresentation = presentation;
+}
+
+#ifdef WITH_DMABUF_ZCOPY
+void Compositor::setExplicitSynchronization(
+		ExplicitSynchronizationPtr explicitSync)
+{
+	LOG(mLog, DEBUG) << "Use explicit synchronization";
+
+	mExplicitSync = explicitSync;
+}
+#endif
+
 void Compositor::init()
 {
 	mWlCompositor = bind<wl_compositor*>(&wl_compositor_interface);
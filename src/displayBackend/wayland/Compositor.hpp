@@ -12,6 +12,7 @@
 
 #include <xen/be/Log.hpp>
 
+#include "Presentation.hpp"
 #include "Registry.hpp"
 #include "Surface.hpp"
 
@@ -47,8 +48,17 @@ private:
 
 	wl_display* mWlDisplay;
 	wl_compositor* mWlCompositor;
+	PresentationPtr mPresentation;
+#ifdef WITH_DMABUF_ZCOPY
+	ExplicitSynchronizationPtr mExplicitSync;
+#endif
 	XenBackend::Log mLog;
 
+	void setPresentation(PresentationPtr presentation);
+#ifdef WITH_DMABUF_ZCOPY
+	void setExplicitSynchronization(ExplicitSynchronizationPtr explicitSync);
+#endif
+
 	void init();
 	void release();
 };
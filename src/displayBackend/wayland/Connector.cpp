@@ -20,9 +20,12 @@
  */
 
 #include "Connector.hpp"
+#include "Edid.hpp"
 #include "Exception.hpp"
 #include "SurfaceManager.hpp"
 
+using std::vector;
+
 using DisplayItf::FrameBufferPtr;
 
 namespace Wayland {
@@ -32,11 +35,13 @@ namespace Wayland {
  ******************************************************************************/
 
 Connector::Connector(domid_t domId, const std::string& name,
-					 CompositorPtr compositor,
+					 CompositorPtr compositor, OutputPtr output,
 					 uint32_t width, uint32_t height) :
 	ConnectorBase(domId, width, height),
 	mCompositor(compositor),
-	mName(name)
+	mName(name),
+	mOutput(output),
+	mEdidSerial(0)
 {
 	LOG(mLog, DEBUG) << "Create, name: "  << mName;
 }
@@ -110,4 +115,52 @@ void Connector::onRelease()
 	}
 }
 
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+size_t Connector::getEDID(grant_ref_t startDirectory, uint32_t size) const
+{
+	// the compositor may change the output mode after the EDID is created
+	if (mOutput && mOutput->getMode().serial != mEdidSerial)
+	{
+		invalidateEDID();
+	}
+
+	return ConnectorBase::getEDID(startDirectory, size);
+}
+
+vector<uint8_t> Connector::createEDID() const
+{
+	if (!mOutput)
+	{
+		return ConnectorBase::createEDID();
+	}
+
+	auto mode = mOutput->getMode();
+
+	mEdidSerial = mode.serial;
+
+	if (mode.width <= 0 || mode.height <= 0 || mode.refresh <= 0)
+	{
+		return ConnectorBase::createEDID();
+	}
+
+	auto timing = Edid::getTiming(mCfgWidth, mCfgHeight, mode.refresh,
+								  Edid::EDID_DPI);
+
+	// keep pixel density of the output for the connector resolution
+	if (mode.widthMm && mode.heightMm)
+	{
+		timing.widthMm = mode.widthMm * mCfgWidth / mode.width;
+		timing.heightMm = mode.heightMm * mCfgHeight / mode.height;
+	}
+
+	LOG(mLog, DEBUG) << "Create EDID from output, refresh: " << mode.refresh
+					 << " mHz, size: " << timing.widthMm << "x"
+					 << timing.heightMm << " mm";
+
+	return Edid::create({timing});
+}
+
 }
@@ -30,6 +30,7 @@
 #include "IviApplication.hpp"
 #include "IviSurface.hpp"
 #endif
+#include "Output.hpp"
 #include "Shell.hpp"
 #include "ShellSurface.hpp"
 
@@ -98,11 +99,18 @@ private:
 	friend class IviConnector;
 
 	Connector(domid_t domId, const std::string& name, CompositorPtr compositor,
-			  uint32_t width, uint32_t height);
+			  OutputPtr output, uint32_t width, uint32_t height);
 
 	std::string mName;
+	OutputPtr mOutput;
+	// output mode serial the cached EDID is created for
+	mutable std::atomic<uint32_t> mEdidSerial;
 
 	SurfacePtr mSurface;
+
+	size_t getEDID(grant_ref_t startDirectory,
+				   uint32_t size) const override;
+	std::vector<uint8_t> createEDID() const override;
 };
 
 /***************************************************************************//**
@@ -151,8 +159,9 @@ private:
 	friend class Display;
 
 	ShellConnector(domid_t domId, const std::string& name, ShellPtr shell,
-				   CompositorPtr compositor, uint32_t width, uint32_t height) :
-		Connector(domId, name, compositor, width, height),
+				   CompositorPtr compositor, OutputPtr output,
+				   uint32_t width, uint32_t height) :
+		Connector(domId, name, compositor, output, width, height),
 		mShell(shell) {}
 
 	ShellPtr mShell;
@@ -201,8 +210,9 @@ private:
 
 	IviConnector(domid_t domId, const std::string& name,
 				 IviApplicationPtr iviApplication, CompositorPtr compositor,
-				 uint32_t surfaceId, uint32_t width, uint32_t height) :
-		Connector(domId, name, compositor, width, height),
+				 OutputPtr output, uint32_t surfaceId, uint32_t width,
+				 uint32_t height) :
+		Connector(domId, name, compositor, output, width, height),
 		mIviApplication(iviApplication),
 		mSurfaceId(surfaceId) {}
 
@@ -21,6 +21,8 @@
 
 #include "Display.hpp"
 
+#include <algorithm>
+
 #include <signal.h>
 
 #include "Exception.hpp"
@@ -47,10 +49,11 @@ namespace Wayland {
  * Display
  ******************************************************************************/
 
-Display::Display(bool disable_zcopy) :
+Display::Display(bool disable_zcopy, TimerQueuePtr repeatQueue) :
 	mWlDisplay(nullptr),
 	mWlRegistry(nullptr),
 	mDisableZCopy(disable_zcopy),
+	mRepeatQueue(repeatQueue),
 	mLog("Display")
 {
 	try
@@ -138,7 +141,7 @@ DisplayItf::ConnectorPtr Display::createConnector(domid_t domId,
 		}
 
 		connector = new IviConnector(domId, name, mIviApplication, mCompositor,
-									 surfaceId, width, height);
+									 mOutput, surfaceId, width, height);
 
 		LOG(mLog, DEBUG) << "Create ivi connector, name: " << name;
 	}
@@ -147,13 +150,14 @@ DisplayItf::ConnectorPtr Display::createConnector(domid_t domId,
 	if (mShell)
 	{
 		connector = new ShellConnector(domId, name, mShell, mCompositor,
-									   width, height);
+									   mOutput, width, height);
 
 		LOG(mLog, DEBUG) << "Create shell connector, name: " << name;
 	}
 	else
 	{
-		connector = new Connector(domId, name, mCompositor, width, height);
+		connector = new Connector(domId, name, mCompositor, mOutput,
+								  width, height);
 
 		LOG(mLog, DEBUG) << "Create connector, name: " << name;
 	}
@@ -442,6 +446,18 @@ void Display::registryHandler(wl_registry *registry, uint32_t id,
 		mCompositor.reset(new Compositor(mWlDisplay, registry, id, version));
 	}
 
+	// connectors take EDID from the first output
+	if (interface == "wl_output" && !mOutput)
+	{
+		mOutput.reset(new Output(registry, id,
+								 std::min(version, Output::cVersion)));
+	}
+
+	if (interface == "wp_presentation")
+	{
+		mPresentation.reset(new Presentation(registry, id, version));
+	}
+
 	if (interface == "xdg_wm_base")
 	{
 		mShell.reset(new Shell(registry, id, version));
@@ -460,7 +476,7 @@ void Display::registryHandler(wl_registry *registry, uint32_t id,
 #ifdef WITH_INPUT
 	if (interface == "wl_seat")
 	{
-		mSeat.reset(new Seat(registry, id, Seat::cVersion));
+		mSeat.reset(new Seat(registry, id, Seat::cVersion, mRepeatQueue));
 	}
 #endif
 #ifdef WITH_ZCOPY
@@ -481,7 +497,14 @@ void Display::registryHandler(wl_registry *registry, uint32_t id,
 #ifdef WITH_DMABUF_ZCOPY
 		if (interface == "zwp_linux_dmabuf_v1")
 		{
-			mWaylandLinuxDmabuf.reset(new WaylandLinuxDmabuf(registry, id, version));
+			mWaylandLinuxDmabuf.reset(new WaylandLinuxDmabuf(registry, id,
+					std::min(version, WaylandLinuxDmabuf::cVersion)));
+		}
+
+		if (interface == "zwp_linux_explicit_synchronization_v1")
+		{
+			mExplicitSync.reset(new ExplicitSynchronization(registry, id,
+															version));
 		}
 #endif
 	}
@@ -522,10 +545,29 @@ void Display::init()
 	wl_display_dispatch(mWlDisplay);
 	wl_display_roundtrip(mWlDisplay);
 
+	// the output sends its mode after it is bound by the roundtrip above
+	if (mOutput)
+	{
+		wl_display_roundtrip(mWlDisplay);
+	}
+
 	if (!mCompositor)
 	{
 		throw Exception("Can't get compositor", ENOENT);
 	}
+
+	if (mPresentation)
+	{
+		mCompositor->setPresentation(mPresentation);
+	}
+
+#ifdef WITH_DMABUF_ZCOPY
+	// explicit synchronization is used for dmabuf buffers only
+	if (mExplicitSync && mWaylandLinuxDmabuf)
+	{
+		mCompositor->setExplicitSynchronization(mExplicitSync);
+	}
+#endif
 }
 
 void Display::release()
@@ -539,6 +581,8 @@ void Display::release()
 	mShell.reset();
 	mSharedMemory.reset();
 	mCompositor.reset();
+	mOutput.reset();
+	mPresentation.reset();
 #ifdef WITH_INPUT
 	mSeat.reset();
 #endif
@@ -551,6 +595,7 @@ void Display::release()
 #endif
 #ifdef WITH_DMABUF_ZCOPY
 	mWaylandLinuxDmabuf.reset();
+	mExplicitSync.reset();
 #endif
 #endif
 
@@ -37,11 +37,17 @@
 #ifdef WITH_INPUT
 #include "Seat.hpp"
 #endif
+#include "Output.hpp"
+#include "Presentation.hpp"
 #include "SharedMemory.hpp"
 #include "Shell.hpp"
+#include "TimerQueue.hpp"
 #ifdef WITH_ZCOPY
 #include "WaylandZCopy.hpp"
 #endif
+#ifdef WITH_DMABUF_ZCOPY
+#include "ExplicitSynchronization.hpp"
+#endif
 
 namespace Wayland {
 
@@ -58,7 +64,13 @@ class Display : public DisplayItf::Display
 {
 public:
 
-	explicit Display(bool disable_zcopy = false);
+	/**
+	 * @param disable_zcopy disables zero copy buffers
+	 * @param repeatQueue   timer queue to repeat held keys on the host,
+	 *                      nullptr - keys are not repeated
+	 */
+	explicit Display(bool disable_zcopy = false,
+					 TimerQueuePtr repeatQueue = nullptr);
 	~Display();
 
 	/**
@@ -140,9 +152,12 @@ private:
 	wl_registry* mWlRegistry;
 	wl_registry_listener mWlRegistryListener;
 	bool mDisableZCopy;
+	TimerQueuePtr mRepeatQueue;
 	XenBackend::Log mLog;
 
 	CompositorPtr mCompositor;
+	OutputPtr mOutput;
+	PresentationPtr mPresentation;
 	ShellPtr mShell;
 	SharedMemoryPtr mSharedMemory;
 
@@ -163,6 +178,7 @@ private:
 #endif
 #ifdef WITH_DMABUF_ZCOPY
 	WaylandLinuxDmabufPtr mWaylandLinuxDmabuf;
+	ExplicitSynchronizationPtr mExplicitSync;
 #endif
 #endif
 
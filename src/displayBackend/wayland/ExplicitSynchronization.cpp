@@ -0,0 +1,154 @@
+/*
+ *  Explicit synchronization class
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "ExplicitSynchronization.hpp"
+
+#include <poll.h>
+#include <sys/ioctl.h>
+
+#include <linux/dma-buf.h>
+
+#include "Exception.hpp"
+
+namespace Wayland {
+
+/*******************************************************************************
+ * ExplicitSynchronization
+ ******************************************************************************/
+
+ExplicitSynchronization::ExplicitSynchronization(wl_registry* registry,
+												 uint32_t id,
+												 uint32_t version) :
+	Registry(registry, id, version),
+	mWlExplicitSync(nullptr),
+	mExportSupported(true),
+	mLog("ExplicitSync")
+{
+	try
+	{
+		init();
+	}
+	catch(const std::exception& e)
+	{
+		release();
+
+		throw;
+	}
+}
+
+ExplicitSynchronization::~ExplicitSynchronization()
+{
+	release();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+zwp_linux_surface_synchronization_v1*
+ExplicitSynchronization::createSurfaceSynchronization(wl_surface* surface)
+{
+	auto surfaceSync = zwp_linux_explicit_synchronization_v1_get_synchronization(
+			mWlExplicitSync, surface);
+
+	if (!surfaceSync)
+	{
+		throw Exception("Can't create surface synchronization", errno);
+	}
+
+	LOG(mLog, DEBUG) << "Create surface synchronization: " << surface;
+
+	return surfaceSync;
+}
+
+int ExplicitSynchronization::exportAcquireFence(int dmabufFd)
+{
+#ifdef DMA_BUF_IOCTL_EXPORT_SYNC_FILE
+	if (mExportSupported && dmabufFd >= 0)
+	{
+		dma_buf_export_sync_file exportSyncFile {};
+
+		// read access: get fences of the pending writes
+		exportSyncFile.flags = DMA_BUF_SYNC_READ;
+		exportSyncFile.fd = -1;
+
+		if (ioctl(dmabufFd, DMA_BUF_IOCTL_EXPORT_SYNC_FILE,
+				  &exportSyncFile) == 0)
+		{
+			return exportSyncFile.fd;
+		}
+
+		if (errno == ENOTTY || errno == EINVAL)
+		{
+			LOG(mLog, WARNING) << "Export of dmabuf fences is not supported";
+
+			mExportSupported = false;
+		}
+	}
+#endif
+
+	return -1;
+}
+
+bool ExplicitSynchronization::waitFence(int fenceFd, int timeoutMs)
+{
+	pollfd fds = { fenceFd, POLLIN, 0 };
+
+	int ret = 0;
+
+	while ((ret = poll(&fds, 1, timeoutMs)) < 0 && errno == EINTR);
+
+	if (ret < 0)
+	{
+		throw Exception("Can't wait for fence", errno);
+	}
+
+	return ret > 0;
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void ExplicitSynchronization::init()
+{
+	mWlExplicitSync = bind<zwp_linux_explicit_synchronization_v1*>(
+			&zwp_linux_explicit_synchronization_v1_interface);
+
+	if (!mWlExplicitSync)
+	{
+		throw Exception("Can't bind explicit synchronization", errno);
+	}
+
+	LOG(mLog, DEBUG) << "Create";
+}
+
+void ExplicitSynchronization::release()
+{
+	if (mWlExplicitSync)
+	{
+		zwp_linux_explicit_synchronization_v1_destroy(mWlExplicitSync);
+
+		LOG(mLog, DEBUG) << "Delete";
+	}
+}
+
+}
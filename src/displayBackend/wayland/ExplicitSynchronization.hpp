@@ -0,0 +1,91 @@
+/*
+ *  Explicit synchronization class
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_WAYLAND_EXPLICITSYNCHRONIZATION_HPP_
+#define SRC_WAYLAND_EXPLICITSYNCHRONIZATION_HPP_
+
+#include <atomic>
+#include <memory>
+
+#include <xen/be/Log.hpp>
+
+#include "Registry.hpp"
+
+#include "linux-explicit-synchronization-unstable-v1-client-protocol.h"
+
+namespace Wayland {
+
+/***************************************************************************//**
+ * Wayland Linux explicit synchronization class. Provides per surface
+ * synchronization objects used to pass acquire fences and get release fences
+ * for dmabuf buffers.
+ * @ingroup wayland
+ ******************************************************************************/
+class ExplicitSynchronization : public Registry
+{
+public:
+
+	~ExplicitSynchronization();
+
+	/**
+	 * Creates synchronization object for the surface. Only one object can be
+	 * created per surface.
+	 * @param surface surface
+	 */
+	zwp_linux_surface_synchronization_v1* createSurfaceSynchronization(
+			wl_surface* surface);
+
+	/**
+	 * Exports fence which is signalled when pending writes to the dmabuf are
+	 * done
+	 * @param dmabufFd dmabuf fd
+	 * @return sync file fd or -1 if not supported
+	 */
+	int exportAcquireFence(int dmabufFd);
+
+	/**
+	 * Waits until fence is signalled
+	 * @param fenceFd   sync file fd
+	 * @param timeoutMs timeout in milliseconds
+	 * @return <i>false</i> if timeout expired
+	 */
+	static bool waitFence(int fenceFd, int timeoutMs);
+
+private:
+
+	friend class Display;
+
+	ExplicitSynchronization(wl_registry* registry, uint32_t id,
+							uint32_t version);
+
+	zwp_linux_explicit_synchronization_v1* mWlExplicitSync;
+	std::atomic_bool mExportSupported;
+	XenBackend::Log mLog;
+
+	void init();
+	void release();
+};
+
+typedef std::shared_ptr<ExplicitSynchronization> ExplicitSynchronizationPtr;
+
+}
+
+#endif /* SRC_WAYLAND_EXPLICITSYNCHRONIZATION_HPP_ */
@@ -21,6 +21,7 @@
 
 #include "Exception.hpp"
 #include "FrameBuffer.hpp"
+#include "PixelFormat.hpp"
 
 using std::hex;
 using std::lock_guard;
@@ -184,6 +185,13 @@ KmsBuffer::KmsBuffer(wl_kms* wlKms,
 					 uint32_t pixelFormat) :
 	WlBuffer(displayBuffer, width, height)
 {
+	// create_mp_buffer requires separate dmabuf per plane
+	if (PixelFormat::getNumPlanes(pixelFormat) > 1)
+	{
+		throw Exception("Multi-planar formats are not supported by KMS",
+						EINVAL);
+	}
+
 	mWlBuffer = wl_kms_create_buffer(wlKms, mDisplayBuffer->getFd(),
 									 mWidth, mHeight,
 									 mDisplayBuffer->getStride(), pixelFormat,
@@ -212,9 +220,27 @@ DrmBuffer::DrmBuffer(wl_drm* wlDrm,
 					 uint32_t pixelFormat) :
 	WlBuffer(displayBuffer, width, height)
 {
-	mWlBuffer = wl_drm_create_buffer(wlDrm, mDisplayBuffer->readName(),
-									 mWidth, mHeight,
-									 mDisplayBuffer->getStride(), pixelFormat);
+	auto planes = PixelFormat::getPlanes(pixelFormat,
+										 mDisplayBuffer->getStride(), mHeight);
+
+	if (planes.size() > 1)
+	{
+		planes.resize(3, {0, 0, 0});
+
+		mWlBuffer = wl_drm_create_planar_buffer(
+				wlDrm, mDisplayBuffer->readName(), mWidth, mHeight,
+				pixelFormat,
+				planes[0].offset, planes[0].pitch,
+				planes[1].offset, planes[1].pitch,
+				planes[2].offset, planes[2].pitch);
+	}
+	else
+	{
+		mWlBuffer = wl_drm_create_buffer(wlDrm, mDisplayBuffer->readName(),
+										 mWidth, mHeight,
+										 mDisplayBuffer->getStride(),
+										 pixelFormat);
+	}
 
 	if (!mWlBuffer)
 	{
@@ -236,7 +262,8 @@ DrmBuffer::DrmBuffer(wl_drm* wlDrm,
 LinuxDmabufBuffer::LinuxDmabufBuffer(zwp_linux_dmabuf_v1* wlLinuxDmabuf,
 									 DisplayBufferPtr displayBuffer,
 									 uint32_t width, uint32_t height,
-									 uint32_t pixelFormat) :
+									 uint32_t pixelFormat,
+									 uint64_t modifier) :
 	WlBuffer(displayBuffer, width, height)
 {
 	zwp_linux_buffer_params_v1 *params;
@@ -247,10 +274,16 @@ LinuxDmabufBuffer::LinuxDmabufBuffer(zwp_linux_dmabuf_v1* wlLinuxDmabuf,
 		throw Exception("Can't create Linux dmabuf params", ENOMEM);
 	}
 
-	zwp_linux_buffer_params_v1_add(params, mDisplayBuffer->getFd(),
-								   0, /* plane_idx */
-								   0, /* offset */
-								   mDisplayBuffer->getStride(), 0, 0);
+	auto planes = PixelFormat::getPlanes(pixelFormat,
+										 mDisplayBuffer->getStride(), mHeight);
+
+	// all planes are in the same dmabuf
+	for (size_t i = 0; i < planes.size(); i++)
+	{
+		zwp_linux_buffer_params_v1_add(params, mDisplayBuffer->getFd(), i,
+									   planes[i].offset, planes[i].pitch,
+									   modifier >> 32, modifier & 0xFFFFFFFF);
+	}
 
 	mWlBuffer = zwp_linux_buffer_params_v1_create_immed(params,
 														mWidth, mHeight,
@@ -268,7 +301,9 @@ LinuxDmabufBuffer::LinuxDmabufBuffer(zwp_linux_dmabuf_v1* wlLinuxDmabuf,
 					 << mDisplayBuffer->getFd()
 					 << ", w: " << mWidth << ", h: " << mHeight
 					 << ", stride: " << mDisplayBuffer->getStride()
-					 << ", format: " << pixelFormat;
+					 << ", planes: " << planes.size()
+					 << ", format: " << pixelFormat
+					 << ", modifier: 0x" << std::hex << modifier;
 }
 
 #endif
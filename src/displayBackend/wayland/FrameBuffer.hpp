@@ -73,6 +73,11 @@ public:
 		return mDisplayBuffer;
 	}
 
+	/**
+	 * Checks if the buffer can be used with explicit synchronization
+	 */
+	virtual bool isExplicitSyncSupported() const { return false; }
+
 	void setSurface(Surface* surface);
 
 protected:
@@ -162,13 +167,21 @@ private:
  ******************************************************************************/
 class LinuxDmabufBuffer : public WlBuffer
 {
+public:
+
+	/**
+	 * Checks if the buffer can be used with explicit synchronization
+	 */
+	bool isExplicitSyncSupported() const override { return true; }
+
 private:
 
 	friend class WaylandLinuxDmabuf;
 
 	LinuxDmabufBuffer(zwp_linux_dmabuf_v1* wlLinuxDmabuf,
 					  DisplayItf::DisplayBufferPtr displayBuffer,
-					  uint32_t width, uint32_t height, uint32_t pixelFormat);
+					  uint32_t width, uint32_t height, uint32_t pixelFormat,
+					  uint64_t modifier);
 };
 
 #endif
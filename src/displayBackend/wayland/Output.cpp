@@ -0,0 +1,189 @@
+/*
+ *  Output class
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "Output.hpp"
+
+#include "Exception.hpp"
+
+using std::lock_guard;
+using std::mutex;
+
+namespace Wayland {
+
+/*******************************************************************************
+ * Output
+ ******************************************************************************/
+
+Output::Output(wl_registry* registry, uint32_t id, uint32_t version) :
+	Registry(registry, id, version),
+	mWlOutput(nullptr),
+	mLog("Output"),
+	mMode {},
+	mCurrent(false),
+	mChanged(false)
+{
+	try
+	{
+		init();
+	}
+	catch(const std::exception& e)
+	{
+		release();
+
+		throw;
+	}
+}
+
+Output::~Output()
+{
+	release();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+Output::Mode Output::getMode() const
+{
+	lock_guard<mutex> lock(mMutex);
+
+	return mMode;
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void Output::sGeometryHandler(void* data, wl_output* output, int32_t x,
+							  int32_t y, int32_t physicalWidth,
+							  int32_t physicalHeight, int32_t subpixel,
+							  const char* make, const char* model,
+							  int32_t transform)
+{
+	static_cast<Output*>(data)->geometryHandler(physicalWidth, physicalHeight,
+												make, model);
+}
+
+void Output::sModeHandler(void* data, wl_output* output, uint32_t flags,
+						  int32_t width, int32_t height, int32_t refresh)
+{
+	static_cast<Output*>(data)->modeHandler(flags, width, height, refresh);
+}
+
+void Output::sDoneHandler(void* data, wl_output* output)
+{
+	static_cast<Output*>(data)->doneHandler();
+}
+
+void Output::sScaleHandler(void* data, wl_output* output, int32_t factor)
+{
+}
+
+void Output::geometryHandler(int32_t physicalWidth, int32_t physicalHeight,
+							 const char* make, const char* model)
+{
+	LOG(mLog, DEBUG) << "Geometry, make: " << make << ", model: " << model
+					 << ", size: " << physicalWidth << "x" << physicalHeight
+					 << " mm";
+
+	lock_guard<mutex> lock(mMutex);
+
+	auto widthMm = physicalWidth > 0 ? physicalWidth : 0;
+	auto heightMm = physicalHeight > 0 ? physicalHeight : 0;
+
+	if (widthMm != mMode.widthMm || heightMm != mMode.heightMm)
+	{
+		mMode.widthMm = widthMm;
+		mMode.heightMm = heightMm;
+
+		mChanged = true;
+	}
+}
+
+void Output::modeHandler(uint32_t flags, int32_t width, int32_t height,
+						 int32_t refresh)
+{
+	DLOG(mLog, DEBUG) << "Mode: " << width << "x" << height << "@" << refresh
+					  << " mHz, flags: " << flags;
+
+	lock_guard<mutex> lock(mMutex);
+
+	if ((flags & WL_OUTPUT_MODE_CURRENT) ||
+		((flags & WL_OUTPUT_MODE_PREFERRED) && !mCurrent))
+	{
+		mChanged |= width != mMode.width || height != mMode.height ||
+					refresh != mMode.refresh;
+
+		mMode.width = width;
+		mMode.height = height;
+		mMode.refresh = refresh;
+
+		mCurrent = flags & WL_OUTPUT_MODE_CURRENT;
+	}
+}
+
+void Output::doneHandler()
+{
+	lock_guard<mutex> lock(mMutex);
+
+	// the done event completes a set of the output changes
+	if (mChanged)
+	{
+		mMode.serial++;
+
+		mChanged = false;
+	}
+
+	LOG(mLog, DEBUG) << "Mode: " << mMode.width << "x" << mMode.height << "@"
+					 << mMode.refresh << " mHz";
+}
+
+void Output::init()
+{
+	mWlOutput = bind<wl_output*>(&wl_output_interface);
+
+	if (!mWlOutput)
+	{
+		throw Exception("Can't bind output", errno);
+	}
+
+	mWlListener = { sGeometryHandler, sModeHandler, sDoneHandler,
+					sScaleHandler };
+
+	if (wl_output_add_listener(mWlOutput, &mWlListener, this) < 0)
+	{
+		throw Exception("Can't add output listener", errno);
+	}
+
+	LOG(mLog, DEBUG) << "Create";
+}
+
+void Output::release()
+{
+	if (mWlOutput)
+	{
+		wl_output_destroy(mWlOutput);
+
+		LOG(mLog, DEBUG) << "Delete";
+	}
+}
+
+}
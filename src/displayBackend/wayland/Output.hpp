@@ -0,0 +1,112 @@
+/*
+ *  Output class
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_WAYLAND_OUTPUT_HPP_
+#define SRC_WAYLAND_OUTPUT_HPP_
+
+#include <memory>
+#include <mutex>
+
+#include <xen/be/Log.hpp>
+
+#include "Registry.hpp"
+
+namespace Wayland {
+
+/***************************************************************************//**
+ * Wayland output class. Tracks the current mode and the physical size of the
+ * compositor output.
+ * @ingroup wayland
+ ******************************************************************************/
+class Output : public Registry
+{
+public:
+
+	static const uint32_t cVersion = 2;
+
+	/**
+	 * Output mode
+	 */
+	struct Mode
+	{
+		/* Resolution in pixels, 0 if the mode is not reported yet. */
+		int32_t width;
+		int32_t height;
+
+		/* Refresh rate in mHz. */
+		int32_t refresh;
+
+		/* Physical size, 0 if it is not known. */
+		int32_t widthMm;
+		int32_t heightMm;
+
+		/* Incremented when the compositor reports a changed mode. */
+		uint32_t serial;
+	};
+
+	~Output();
+
+	/**
+	 * Returns the current mode or the preferred one if the current mode is
+	 * not reported yet
+	 */
+	Mode getMode() const;
+
+private:
+
+	friend class Display;
+
+	Output(wl_registry* registry, uint32_t id, uint32_t version);
+
+	wl_output* mWlOutput;
+	wl_output_listener mWlListener;
+	XenBackend::Log mLog;
+
+	mutable std::mutex mMutex;
+	Mode mMode;
+	bool mCurrent;
+	bool mChanged;
+
+	static void sGeometryHandler(void* data, wl_output* output, int32_t x,
+								 int32_t y, int32_t physicalWidth,
+								 int32_t physicalHeight, int32_t subpixel,
+								 const char* make, const char* model,
+								 int32_t transform);
+	static void sModeHandler(void* data, wl_output* output, uint32_t flags,
+							 int32_t width, int32_t height, int32_t refresh);
+	static void sDoneHandler(void* data, wl_output* output);
+	static void sScaleHandler(void* data, wl_output* output, int32_t factor);
+
+	void geometryHandler(int32_t physicalWidth, int32_t physicalHeight,
+						 const char* make, const char* model);
+	void modeHandler(uint32_t flags, int32_t width, int32_t height,
+					 int32_t refresh);
+	void doneHandler();
+
+	void init();
+	void release();
+};
+
+typedef std::shared_ptr<Output> OutputPtr;
+
+}
+
+#endif /* SRC_WAYLAND_OUTPUT_HPP_ */
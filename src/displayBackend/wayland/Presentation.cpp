@@ -0,0 +1,118 @@
+/*
+ *  Presentation class
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "Presentation.hpp"
+
+#include "Exception.hpp"
+
+namespace Wayland {
+
+/*******************************************************************************
+ * Presentation
+ ******************************************************************************/
+
+Presentation::Presentation(wl_registry* registry,
+						   uint32_t id, uint32_t version) :
+	Registry(registry, id, version),
+	mWpPresentation(nullptr),
+	mClockId(CLOCK_MONOTONIC),
+	mLog("Presentation")
+{
+	try
+	{
+		init();
+	}
+	catch(const std::exception& e)
+	{
+		release();
+
+		throw;
+	}
+}
+
+Presentation::~Presentation()
+{
+	release();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+struct wp_presentation_feedback* Presentation::createFeedback(wl_surface* surface)
+{
+	auto feedback = wp_presentation_feedback(mWpPresentation, surface);
+
+	if (!feedback)
+	{
+		throw Exception("Can't create presentation feedback", errno);
+	}
+
+	return feedback;
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void Presentation::sClockIdHandler(void* data, wp_presentation* presentation,
+								   uint32_t clockId)
+{
+	static_cast<Presentation*>(data)->clockIdHandler(clockId);
+}
+
+void Presentation::clockIdHandler(uint32_t clockId)
+{
+	LOG(mLog, DEBUG) << "Clock id: " << clockId;
+
+	mClockId = static_cast<clockid_t>(clockId);
+}
+
+void Presentation::init()
+{
+	mWpPresentation = bind<wp_presentation*>(&wp_presentation_interface);
+
+	if (!mWpPresentation)
+	{
+		throw Exception("Can't bind presentation", errno);
+	}
+
+	mWpListener = { sClockIdHandler };
+
+	if (wp_presentation_add_listener(mWpPresentation, &mWpListener, this) < 0)
+	{
+		throw Exception("Can't add presentation listener", errno);
+	}
+
+	LOG(mLog, DEBUG) << "Create";
+}
+
+void Presentation::release()
+{
+	if (mWpPresentation)
+	{
+		wp_presentation_destroy(mWpPresentation);
+
+		LOG(mLog, DEBUG) << "Delete";
+	}
+}
+
+}
@@ -0,0 +1,82 @@
+/*
+ *  Presentation class
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_WAYLAND_PRESENTATION_HPP_
+#define SRC_WAYLAND_PRESENTATION_HPP_
+
+#include <ctime>
+#include <memory>
+
+#include <xen/be/Log.hpp>
+
+#include "Registry.hpp"
+
+#include "presentation-time-client-protocol.h"
+
+namespace Wayland {
+
+/***************************************************************************//**
+ * Wayland presentation time class. Provides per commit presentation feedback
+ * which reports whether the content update was presented or discarded.
+ * @ingroup wayland
+ ******************************************************************************/
+class Presentation : public Registry
+{
+public:
+
+	~Presentation();
+
+	/**
+	 * Creates presentation feedback for the next surface commit
+	 * @param surface surface
+	 */
+	struct wp_presentation_feedback* createFeedback(wl_surface* surface);
+
+	/**
+	 * Returns clock id used by the compositor for presentation timestamps
+	 */
+	clockid_t getClockId() const { return mClockId; }
+
+private:
+
+	friend class Display;
+
+	Presentation(wl_registry* registry, uint32_t id, uint32_t version);
+
+	wp_presentation* mWpPresentation;
+	clockid_t mClockId;
+	XenBackend::Log mLog;
+
+	wp_presentation_listener mWpListener;
+
+	static void sClockIdHandler(void* data, wp_presentation* presentation,
+								uint32_t clockId);
+	void clockIdHandler(uint32_t clockId);
+
+	void init();
+	void release();
+};
+
+typedef std::shared_ptr<Presentation> PresentationPtr;
+
+}
+
+#endif /* SRC_WAYLAND_PRESENTATION_HPP_ */
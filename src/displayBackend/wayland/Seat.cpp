@@ -23,9 +23,11 @@ namespace Wayland {
  * Seat
  ******************************************************************************/
 
-Seat::Seat(wl_registry* registry, uint32_t id, uint32_t version) :
+Seat::Seat(wl_registry* registry, uint32_t id, uint32_t version,
+		   TimerQueuePtr repeatQueue) :
 	Registry(registry, id, version),
 	mWlSeat(nullptr),
+	mRepeatQueue(repeatQueue),
 	mLog("Seat")
 {
 	try
@@ -95,7 +97,7 @@ void Seat::readCapabilities(uint32_t capabilities)
 
 		if (!mSeatKeyboard)
 		{
-			mSeatKeyboard.reset(new SeatKeyboard(mWlSeat));
+			mSeatKeyboard.reset(new SeatKeyboard(mWlSeat, mRepeatQueue));
 		}
 	}
 
@@ -42,9 +42,11 @@ private:
 
 	friend class Display;
 
-	Seat(wl_registry* registry, uint32_t id, uint32_t version);
+	Seat(wl_registry* registry, uint32_t id, uint32_t version,
+		 TimerQueuePtr repeatQueue = nullptr);
 
 	wl_seat* mWlSeat;
+	TimerQueuePtr mRepeatQueue;
 	XenBackend::Log mLog;
 
 	wl_seat_listener mWlListener;
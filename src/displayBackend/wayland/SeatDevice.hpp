@@ -11,6 +11,7 @@
 #include <mutex>
 #include <unordered_map>
 
+#include "Metrics.hpp"
 #include "Surface.hpp"
 #include "SurfaceManager.hpp"
 
@@ -70,6 +71,21 @@ protected:
 	std::unordered_map<std::string, T> mConnectorCallbacks;
 	CallbackIt mCurrentCallback;
 
+	/**
+	 * Passes time of the following events to the current callbacks.
+	 * Shall be called with mMutex locked.
+	 * @param timeMs Wayland event time
+	 */
+	void notifyTime(uint32_t timeMs)
+	{
+		if (mCurrentCallback != mSurfaceCallbacks.end() &&
+			mCurrentCallback->second.timestamp)
+		{
+			mCurrentCallback->second.timestamp(
+					Metrics::getTimeUsFromMs(timeMs));
+		}
+	}
+
 private:
 
 	void onSurfaceCreate(const std::string& connectorName,
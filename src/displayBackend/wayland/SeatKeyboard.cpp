@@ -7,8 +7,16 @@
 
 #include "SeatKeyboard.hpp"
 
+#include <algorithm>
+
+#include <unistd.h>
+
+#include <linux/input.h>
+
 #include "Exception.hpp"
 
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
 using std::mutex;
 using std::lock_guard;
 
@@ -20,9 +28,14 @@ namespace Wayland {
  * SeatPointer
  ******************************************************************************/
 
-SeatKeyboard::SeatKeyboard(wl_seat* seat) :
+SeatKeyboard::SeatKeyboard(wl_seat* seat, TimerQueuePtr repeatQueue) :
 	mWlKeyboard(nullptr),
-	mLog("SeatKeyboard")
+	mLog("SeatKeyboard"),
+	mRepeatQueue(repeatQueue),
+	mRepeatRate(cDefaultRepeatRate),
+	mRepeatDelay(cDefaultRepeatDelay),
+	mRepeatKey(0),
+	mRepeatTimeUs(0)
 {
 	try
 	{
@@ -52,7 +65,8 @@ SeatKeyboard::~SeatKeyboard()
 void SeatKeyboard::sOnKeymap(void* data, wl_keyboard* keyboard, uint32_t format,
 							 int32_t fd, uint32_t size)
 {
-
+	// the guest uses its own keymap, only raw key codes are forwarded
+	close(fd);
 }
 
 void SeatKeyboard::sOnEnter(void* data, wl_keyboard* keyboard, uint32_t serial,
@@ -78,13 +92,15 @@ void SeatKeyboard::sOnModifiers(void* data, wl_keyboard* keyboard,
 								uint32_t modsLatched, uint32_t modsLocked,
 								uint32_t group)
 {
-
+	static_cast<SeatKeyboard*>(data)->onModifiers(serial, modsDepressed,
+												  modsLatched, modsLocked,
+												  group);
 }
 
 void SeatKeyboard::sOnRepeatInfo(void* data, wl_keyboard* keyboard,
 								 int32_t rate, int32_t delay)
 {
-
+	static_cast<SeatKeyboard*>(data)->onRepeatInfo(rate, delay);
 }
 
 void SeatKeyboard::onEnter(uint32_t serial, wl_surface* surface, wl_array* keys)
@@ -96,6 +112,15 @@ void SeatKeyboard::onEnter(uint32_t serial, wl_surface* surface, wl_array* keys)
 					  << ", serial: " << serial;
 
 	mCurrentCallback = mSurfaceCallbacks.find(surface);
+
+	// keys held while entering the surface, modifiers in particular, are
+	// pressed on the guest to keep its keyboard state in sync
+	auto key = static_cast<uint32_t*>(keys->data);
+
+	for (size_t i = 0; i < keys->size / sizeof(uint32_t); i++)
+	{
+		sendKey(key[i], WL_KEYBOARD_KEY_STATE_PRESSED);
+	}
 }
 
 void SeatKeyboard::onLeave(uint32_t serial, wl_surface* surface)
@@ -106,6 +131,9 @@ void SeatKeyboard::onLeave(uint32_t serial, wl_surface* surface)
 					  << SurfaceManager::getInstance().getConnectorNameBySurface(surface)
 					  << ", serial: " << serial;
 
+	stopRepeat();
+	releaseKeys();
+
 	mCurrentCallback = mSurfaceCallbacks.end();
 }
 
@@ -117,6 +145,64 @@ void SeatKeyboard::onKey(uint32_t serial, uint32_t time,
 	DLOG(mLog, DEBUG) << "onKey serial: " << serial << ", time: " << time
 					  << ", key: " << key << ", state: " << state;
 
+	notifyTime(time);
+
+	sendKey(key, state);
+
+	if (state == WL_KEYBOARD_KEY_STATE_PRESSED)
+	{
+		startRepeat(key);
+	}
+	else if (key == mRepeatKey)
+	{
+		stopRepeat();
+	}
+}
+
+void SeatKeyboard::onModifiers(uint32_t serial, uint32_t modsDepressed,
+							   uint32_t modsLatched, uint32_t modsLocked,
+							   uint32_t group)
+{
+	// xkb masks depend on the host keymap, the guest modifier state follows
+	// the pressed keys instead
+	DLOG(mLog, DEBUG) << "onModifiers serial: " << serial
+					  << ", depressed: " << modsDepressed
+					  << ", latched: " << modsLatched
+					  << ", locked: " << modsLocked
+					  << ", group: " << group;
+}
+
+void SeatKeyboard::onRepeatInfo(int32_t rate, int32_t delay)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	LOG(mLog, DEBUG) << "Repeat rate: " << rate << ", delay: " << delay;
+
+	mRepeatRate = rate;
+	mRepeatDelay = milliseconds(delay);
+
+	if (!mRepeatRate)
+	{
+		stopRepeat();
+	}
+}
+
+void SeatKeyboard::sendKey(uint32_t key, uint32_t state)
+{
+	auto it = std::find(mPressedKeys.begin(), mPressedKeys.end(), key);
+
+	if (state == WL_KEYBOARD_KEY_STATE_PRESSED)
+	{
+		if (it == mPressedKeys.end())
+		{
+			mPressedKeys.push_back(key);
+		}
+	}
+	else if (it != mPressedKeys.end())
+	{
+		mPressedKeys.erase(it);
+	}
+
 	if (mCurrentCallback != mSurfaceCallbacks.end() &&
 		mCurrentCallback->second.key)
 	{
@@ -124,6 +210,99 @@ void SeatKeyboard::onKey(uint32_t serial, uint32_t time,
 	}
 }
 
+void SeatKeyboard::releaseKeys()
+{
+	// don't leave the guest with stuck keys when the focus goes away
+	while(!mPressedKeys.empty())
+	{
+		sendKey(mPressedKeys.back(), WL_KEYBOARD_KEY_STATE_RELEASED);
+	}
+}
+
+void SeatKeyboard::startRepeat(uint32_t key)
+{
+	if (!mRepeatQueue || !mRepeatRate || !isRepeatable(key))
+	{
+		return;
+	}
+
+	mRepeatKey = key;
+	mRepeatTimeUs = Metrics::getTimeUs() +
+					microseconds(mRepeatDelay).count();
+
+	scheduleRepeat();
+}
+
+void SeatKeyboard::stopRepeat()
+{
+	// the timer is not cancelled here: cancel() waits for the running
+	// callback, which takes mMutex. The callback does nothing without key.
+	mRepeatKey = 0;
+}
+
+void SeatKeyboard::scheduleRepeat()
+{
+	mRepeatQueue->schedule(this, mRepeatTimeUs, [this] () { onRepeat(); });
+}
+
+void SeatKeyboard::onRepeat()
+{
+	lock_guard<mutex> lock(mMutex);
+
+	if (!mRepeatKey)
+	{
+		return;
+	}
+
+	// the callback of the previous key may run after a new key is pressed
+	if (Metrics::getTimeUs() < mRepeatTimeUs)
+	{
+		scheduleRepeat();
+
+		return;
+	}
+
+	if (mCurrentCallback != mSurfaceCallbacks.end() &&
+		mCurrentCallback->second.key)
+	{
+		// repeats have no source event, don't collect their latency
+		if (mCurrentCallback->second.timestamp)
+		{
+			mCurrentCallback->second.timestamp(0);
+		}
+
+		// value 2 is reported by the guest input core as autorepeat
+		mCurrentCallback->second.key(mRepeatKey, 2);
+	}
+
+	// rates above 1000 per second are repeated once per millisecond
+	mRepeatTimeUs += std::max(1000000 / mRepeatRate, 1000);
+
+	scheduleRepeat();
+}
+
+bool SeatKeyboard::isRepeatable(uint32_t key)
+{
+	switch(key)
+	{
+		case KEY_LEFTCTRL:
+		case KEY_RIGHTCTRL:
+		case KEY_LEFTSHIFT:
+		case KEY_RIGHTSHIFT:
+		case KEY_LEFTALT:
+		case KEY_RIGHTALT:
+		case KEY_LEFTMETA:
+		case KEY_RIGHTMETA:
+		case KEY_CAPSLOCK:
+		case KEY_NUMLOCK:
+		case KEY_SCROLLLOCK:
+			return false;
+
+		default:
+			return true;
+	}
+}
+
 void SeatKeyboard::init(wl_seat* seat)
 {
 	mWlKeyboard = wl_seat_get_keyboard(seat);
@@ -146,6 +325,12 @@ void SeatKeyboard::init(wl_seat* seat)
 
 void SeatKeyboard::release()
 {
+	// waits for the running repeat, shall be called without mMutex
+	if (mRepeatQueue)
+	{
+		mRepeatQueue->cancel(this);
+	}
+
 	if (mWlKeyboard)
 	{
 		wl_keyboard_destroy(mWlKeyboard);
@@ -8,12 +8,16 @@
 #ifndef SRC_WAYLAND_SEATKEYBOARD_HPP_
 #define SRC_WAYLAND_SEATKEYBOARD_HPP_
 
+#include <chrono>
+#include <vector>
+
 #include <wayland-client.h>
 
 #include <xen/be/Log.hpp>
 
 #include "SeatDevice.hpp"
 #include "InputItf.hpp"
+#include "TimerQueue.hpp"
 
 namespace Wayland {
 
@@ -27,12 +31,25 @@ private:
 
 	friend class Seat;
 
-	SeatKeyboard(wl_seat* seat);
+	static const int32_t cDefaultRepeatRate = 25;
+	static const int32_t cDefaultRepeatDelay = 400;
+
+	SeatKeyboard(wl_seat* seat, TimerQueuePtr repeatQueue = nullptr);
 
 	wl_keyboard* mWlKeyboard;
 	wl_keyboard_listener mListener;
 	XenBackend::Log mLog;
 
+	// keys pressed on the current surface, released to it on leave
+	std::vector<uint32_t> mPressedKeys;
+
+	// host key repeat is served by the shared timer queue, nullptr - off
+	TimerQueuePtr mRepeatQueue;
+	int32_t mRepeatRate;
+	std::chrono::milliseconds mRepeatDelay;
+	uint32_t mRepeatKey;
+	uint64_t mRepeatTimeUs;
+
 	static void sOnKeymap(void* data, wl_keyboard* keyboard, uint32_t format,
 						  int32_t fd, uint32_t size);
 	static void sOnEnter(void* data, wl_keyboard* keyboard, uint32_t serial,
@@ -50,6 +67,18 @@ private:
 	void onEnter(uint32_t serial, wl_surface* surface, wl_array* keys);
 	void onLeave(uint32_t serial, wl_surface* surface);
 	void onKey(uint32_t serial, uint32_t time, uint32_t key, uint32_t state);
+	void onModifiers(uint32_t serial, uint32_t modsDepressed,
+					 uint32_t modsLatched, uint32_t modsLocked,
+					 uint32_t group);
+	void onRepeatInfo(int32_t rate, int32_t delay);
+
+	void sendKey(uint32_t key, uint32_t state);
+	void releaseKeys();
+	void startRepeat(uint32_t key);
+	void stopRepeat();
+	void scheduleRepeat();
+	void onRepeat();
+	static bool isRepeatable(uint32_t key);
 
 	void init(wl_seat* seat);
 	void release();
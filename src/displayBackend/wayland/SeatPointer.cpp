@@ -142,6 +142,8 @@ void SeatPointer::onMotion(uint32_t time, wl_fixed_t x, wl_fixed_t y)
 	DLOG(mLog, DEBUG) << "onMotion time: " << time
 					  << ", X: " << resX << ", Y: " << resY;
 
+	notifyTime(time);
+
 	if (mCurrentCallback != mSurfaceCallbacks.end())
 	{
 		if (mCurrentCallback->second.moveRelative)
@@ -168,6 +170,8 @@ void SeatPointer::onButton(uint32_t serial, uint32_t time,
 	DLOG(mLog, DEBUG) << "onButton serial: " << serial << ", time: " << time
 					  << ", button: " << button << ", state: " << state;
 
+	notifyTime(time);
+
 	if (mCurrentCallback != mSurfaceCallbacks.end() &&
 		mCurrentCallback->second.button)
 	{
@@ -184,6 +188,8 @@ void SeatPointer::onAxis(uint32_t time, uint32_t axis, wl_fixed_t value)
 	DLOG(mLog, DEBUG) << "onAxis time: " << time << ", axis: " << axis
 					  << ", value: " << resValue;
 
+	notifyTime(time);
+
 	if (mCurrentCallback != mSurfaceCallbacks.end() &&
 		mCurrentCallback->second.moveRelative)
 	{
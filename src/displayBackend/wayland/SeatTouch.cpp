@@ -22,9 +22,13 @@ namespace Wayland {
 
 SeatTouch::SeatTouch(wl_seat* seat) :
 	mWlTouch(nullptr),
-	mCurrentId(-1),
 	mLog("SeatTouch")
 {
+	for (auto& contact : mContacts)
+	{
+		contact = {-1, nullptr, false};
+	}
+
 	try
 	{
 		init(seat);
@@ -87,24 +91,33 @@ void SeatTouch::onDown(uint32_t serial, uint32_t time, wl_surface* surface,
 	int32_t resX = wl_fixed_to_int(x);
 	int32_t resY = wl_fixed_to_int(y);
 
-	mCurrentId = id;
-
 	DLOG(mLog, DEBUG) << "onDown connector: "
 					  << SurfaceManager::getInstance().getConnectorNameBySurface(surface)
 					  << ", serial: " << serial << ", time: " << time
 					  << ", id: " << id << ", X: " << resX << ", Y: " << resY
 					  << ", surface: " << surface;
 
-	mCurrentCallback = mSurfaceCallbacks.find(surface);
+	auto contact = findContact(-1);
 
-	if (mCurrentCallback != mSurfaceCallbacks.end() &&
-		mCurrentCallback->second.down)
+	if (!contact)
 	{
-		mCurrentCallback->second.down(id, resX, resY);
+		LOG(mLog, WARNING) << "Too many contacts, id: " << id;
+
+		return;
 	}
-	else
+
+	*contact = {id, surface, true};
+
+	if (!selectSurface(surface))
 	{
-		LOG(mLog, WARNING) << "No callbacks for this surface found";
+		return;
+	}
+
+	notifyTime(time);
+
+	if (mCurrentCallback->second.down)
+	{
+		mCurrentCallback->second.down(id, resX, resY);
 	}
 }
 
@@ -112,24 +125,30 @@ void SeatTouch::onUp(uint32_t serial, uint32_t time, int32_t id)
 {
 	lock_guard<mutex> lock(mMutex);
 
-	mCurrentId = id;
-
 	DLOG(mLog, DEBUG) << "onUp serial: " << serial << ", time: " << time
 					  << ", id: " << id;
 
-	if (mCurrentCallback != mSurfaceCallbacks.end() &&
-		mCurrentCallback->second.up)
+	auto contact = findContact(id);
+
+	if (!contact)
 	{
-		mCurrentCallback->second.up(id);
+		return;
+	}
 
-		if (mCurrentCallback->second.frame)
-		{
-			mCurrentCallback->second.frame(mCurrentId);
-		}
+	// the contact slot is released on frame
+	contact->id = -1;
+	contact->changed = true;
+
+	if (!selectSurface(contact->surface))
+	{
+		return;
 	}
-	else
+
+	notifyTime(time);
+
+	if (mCurrentCallback->second.up)
 	{
-		LOG(mLog, WARNING) << "No callbacks for this surface found";
+		mCurrentCallback->second.up(id);
 	}
 }
 
@@ -140,19 +159,28 @@ void SeatTouch::onMotion(uint32_t time, int32_t id, wl_fixed_t x, wl_fixed_t y)
 	int32_t resX = wl_fixed_to_int(x);
 	int32_t resY = wl_fixed_to_int(y);
 
-	mCurrentId = id;
-
 	DLOG(mLog, DEBUG) << "onMotion time: " << time << ", id: " << id
 					  << ", X: " << resX << ", Y: " << resY;
 
-	if (mCurrentCallback != mSurfaceCallbacks.end() &&
-		mCurrentCallback->second.motion)
+	auto contact = findContact(id);
+
+	if (!contact)
 	{
-		mCurrentCallback->second.motion(id, resX, resY);
+		return;
 	}
-	else
+
+	contact->changed = true;
+
+	if (!selectSurface(contact->surface))
 	{
-		LOG(mLog, WARNING) << "No callbacks for this surface found";
+		return;
+	}
+
+	notifyTime(time);
+
+	if (mCurrentCallback->second.motion)
+	{
+		mCurrentCallback->second.motion(id, resX, resY);
 	}
 }
 
@@ -162,11 +190,7 @@ void SeatTouch::onFrame()
 
 	DLOG(mLog, DEBUG) << "onFrame";
 
-	if (mCurrentCallback != mSurfaceCallbacks.end() &&
-		mCurrentCallback->second.frame)
-	{
-		mCurrentCallback->second.frame(mCurrentId);
-	}
+	sendFrames();
 }
 
 void SeatTouch::onCancel()
@@ -174,6 +198,89 @@ void SeatTouch::onCancel()
 	lock_guard<mutex> lock(mMutex);
 
 	DLOG(mLog, DEBUG) << "onCancel";
+
+	// the compositor took over the touch sequence, release all contacts
+	for (auto& contact : mContacts)
+	{
+		if (contact.id < 0)
+		{
+			continue;
+		}
+
+		if (selectSurface(contact.surface) && mCurrentCallback->second.up)
+		{
+			mCurrentCallback->second.up(contact.id);
+		}
+
+		contact.id = -1;
+		contact.changed = true;
+	}
+
+	sendFrames();
+}
+
+SeatTouch::Contact* SeatTouch::findContact(int32_t id)
+{
+	for (auto& contact : mContacts)
+	{
+		// released contacts are reused only after the frame
+		if (contact.id == id && !(id < 0 && contact.changed))
+		{
+			return &contact;
+		}
+	}
+
+	return nullptr;
+}
+
+bool SeatTouch::selectSurface(wl_surface* surface)
+{
+	mCurrentCallback = mSurfaceCallbacks.find(surface);
+
+	if (mCurrentCallback == mSurfaceCallbacks.end())
+	{
+		LOG(mLog, WARNING) << "No callbacks for this surface found";
+
+		return false;
+	}
+
+	return true;
+}
+
+void SeatTouch::sendFrames()
+{
+	for (size_t i = 0; i < cMaxContacts; i++)
+	{
+		auto surface = mContacts[i].surface;
+
+		if (!mContacts[i].changed)
+		{
+			continue;
+		}
+
+		// one frame per surface
+		for (size_t j = i; j < cMaxContacts; j++)
+		{
+			if (mContacts[j].surface == surface)
+			{
+				mContacts[j].changed = false;
+			}
+		}
+
+		// frontends don't use the contact id of the frame
+		if (selectSurface(surface) && mCurrentCallback->second.frame)
+		{
+			mCurrentCallback->second.frame(static_cast<int32_t>(i));
+		}
+	}
+
+	for (auto& contact : mContacts)
+	{
+		if (contact.id < 0)
+		{
+			contact.surface = nullptr;
+		}
+	}
 }
 
 void SeatTouch::init(wl_seat* seat)
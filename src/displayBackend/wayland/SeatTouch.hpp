@@ -8,6 +8,8 @@
 #ifndef SRC_WAYLAND_SEATTOUCH_HPP_
 #define SRC_WAYLAND_SEATTOUCH_HPP_
 
+#include <array>
+
 #include <wayland-client.h>
 
 #include <xen/be/Log.hpp>
@@ -29,9 +31,19 @@ private:
 
 	SeatTouch(wl_seat* seat);
 
+	static const size_t cMaxContacts = 16;
+
+	struct Contact
+	{
+		int32_t id;
+		wl_surface* surface;
+		// has events in the current frame
+		bool changed;
+	};
+
 	wl_touch* mWlTouch;
 	wl_touch_listener mListener;
-	int32_t mCurrentId;
+	std::array<Contact, cMaxContacts> mContacts;
 	XenBackend::Log mLog;
 
 	static void sOnDown(void* data, wl_touch* touch, uint32_t serial,
@@ -51,6 +63,10 @@ private:
 	void onFrame();
 	void onCancel();
 
+	Contact* findContact(int32_t id);
+	bool selectSurface(wl_surface* surface);
+	void sendFrames();
+
 	void init(wl_seat* seat);
 	void release();
 };
@@ -7,6 +7,7 @@
 
 #include "SharedFile.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <string>
 
@@ -14,12 +15,17 @@
 #include <sys/mman.h>
 #include <unistd.h>
 
+#include "BufferCopy.hpp"
 #include "Exception.hpp"
 
+using std::max;
+using std::min;
 using std::string;
 
 using XenBackend::XenGnttabBuffer;
 
+using DisplayItf::DamageRegion;
+
 namespace Wayland {
 
 /*******************************************************************************
@@ -32,8 +38,10 @@ SharedFile::SharedFile(uint32_t width, uint32_t height, uint32_t bpp,
 	mBuffer(nullptr),
 	mWidth(width),
 	mHeight(height),
+	mBpp(bpp),
 	mStride(4 * ((width * bpp + 31) / 32)),
 	mSize(height * mStride),
+	mDamageValid(false),
 	mLog("SharedFile")
 {
 	try
@@ -66,7 +74,48 @@ void SharedFile::copy()
 
 	DLOG("Dumb", DEBUG) << "Copy dumb, handle: " << mFd;
 
-	memcpy(mBuffer, mGnttabBuffer->get(), mSize);
+	auto src = static_cast<const uint8_t*>(mGnttabBuffer->get());
+	auto dst = static_cast<uint8_t*>(mBuffer);
+
+	// Copy only changed spans of the rows and collect the changed area
+	// per band of rows. It allows to report accurate damage to the compositor
+	// which then uploads only the changed part of the buffer.
+	for (uint32_t y = 0; y < mHeight; y += cDamageBandHeight)
+	{
+		auto bandHeight = min(cDamageBandHeight, mHeight - y);
+		size_t bandStart = mStride;
+		size_t bandEnd = 0;
+
+		for (uint32_t row = y; row < y + bandHeight; row++)
+		{
+			size_t start, end;
+
+			if (BufferCopy::copyChangedSpan(dst + row * mStride,
+											src + row * mStride, mStride,
+											cDamageChunkSize, start, end))
+			{
+				bandStart = min(bandStart, start);
+				bandEnd = max(bandEnd, end);
+			}
+		}
+
+		if (bandStart < bandEnd)
+		{
+			addDamage(y, bandHeight, bandStart, bandEnd);
+		}
+	}
+}
+
+bool SharedFile::takeDamage(DamageRegion& region)
+{
+	auto valid = mDamageValid;
+
+	region.swap(mDamage);
+
+	mDamage.clear();
+	mDamageValid = true;
+
+	return valid;
 }
 
 /*******************************************************************************
@@ -99,6 +148,48 @@ void SharedFile::init(domid_t domId, size_t offset, const GrantRefs& refs)
 	}
 }
 
+void SharedFile::addDamage(uint32_t y, uint32_t height,
+						   size_t start, size_t end)
+{
+	if (!mDamageValid)
+	{
+		return;
+	}
+
+	uint32_t x = start * 8 / mBpp;
+
+	// changes in the stride padding are not visible
+	if (x >= mWidth)
+	{
+		return;
+	}
+
+	uint32_t width = min<uint32_t>((end * 8 + mBpp - 1) / mBpp, mWidth) - x;
+
+	if (!mDamage.empty())
+	{
+		auto& last = mDamage.back();
+
+		// merge with the previous band if it has the same horizontal span
+		if (last.x == x && last.width == width && last.y + last.height == y)
+		{
+			last.height += height;
+
+			return;
+		}
+	}
+
+	if (mDamage.size() >= cMaxDamageRects)
+	{
+		mDamage.clear();
+		mDamageValid = false;
+
+		return;
+	}
+
+	mDamage.push_back({x, y, width, height});
+}
+
 void SharedFile::release()
 {
 	if (mFd >= 0)
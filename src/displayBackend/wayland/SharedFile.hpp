@@ -75,10 +75,16 @@ public:
 	uint32_t readName() override { return 0; }
 
 	/**
-	 * Copies data from associated grant table buffer
+	 * Copies changed data from associated grant table buffer
 	 */
 	void copy() override;
 
+	/**
+	 * Returns regions changed by copy operations since the previous call
+	 * @param region changed regions
+	 */
+	bool takeDamage(DisplayItf::DamageRegion& region) override;
+
 private:
 
 	friend class SharedMemory;
@@ -91,13 +97,24 @@ private:
 	constexpr static const char *cFileNameTemplate = "/weston-shared-XXXXXX";
 	constexpr static const char *cXdgRuntimeVar = "XDG_RUNTIME_DIR";
 
+	// number of rows compared together to produce one damage rectangle
+	const uint32_t cDamageBandHeight = 16;
+	// compare granularity within the row
+	const size_t cDamageChunkSize = 64;
+	// damage is reported as unknown if there are more rectangles
+	const size_t cMaxDamageRects = 64;
+
 	int mFd;
 	void* mBuffer;
 	uint32_t mWidth;
 	uint32_t mHeight;
+	uint32_t mBpp;
 	uint32_t mStride;
 	size_t mSize;
 
+	DisplayItf::DamageRegion mDamage;
+	bool mDamageValid;
+
 	XenBackend::Log mLog;
 
 	std::unique_ptr<XenBackend::XenGnttabBuffer> mGnttabBuffer;
@@ -105,6 +122,8 @@ private:
 	void init(domid_t domId, size_t offset, const GrantRefs& refs);
 	void release();
 	void createTmpFile();
+
+	void addDamage(uint32_t y, uint32_t height, size_t start, size_t end);
 };
 
 typedef std::shared_ptr<SharedFile> SharedFilePtr;
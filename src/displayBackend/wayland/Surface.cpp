@@ -5,32 +5,51 @@
  *      Author: al1
  */
 
+#include <algorithm>
 #include <cassert>
 #include "Surface.hpp"
 
+#include <unistd.h>
+
 #include "Exception.hpp"
 #include "FrameBuffer.hpp"
 
 using std::chrono::milliseconds;
+using std::find_if;
 using std::mutex;
+using std::next;
 using std::thread;
 using std::unique_lock;
 
+using DisplayItf::DamageRegion;
 using DisplayItf::FrameBufferPtr;
 
+using Metrics::Collector;
+
 namespace Wayland {
 
 /*******************************************************************************
  * Surface
  ******************************************************************************/
 
-Surface::Surface(wl_compositor* compositor) :
+Surface::Surface(wl_compositor* compositor, PresentationPtr presentation) :
 	mWlSurface(nullptr),
 	mWlFrameCallback(nullptr),
+	mPresentation(presentation),
 	mBuffer(nullptr),
 	mTerminate(false),
 	mWaitForFrame(false),
-	mLog("Surface")
+	mLog("Surface"),
+	mPresentLatency(Collector::getInstance().getHistogram(
+			"wayland.present_latency_us")),
+	mPresentedFrames(Collector::getInstance().getCounter(
+			"wayland.presented_frames")),
+	mDiscardedFrames(Collector::getInstance().getCounter(
+			"wayland.discarded_frames")),
+	mFencedReleases(Collector::getInstance().getCounter(
+			"wayland.fenced_releases")),
+	mReleaseFenceWait(Collector::getInstance().getHistogram(
+			"wayland.release_fence_wait_us"))
 {
 	assert(compositor != nullptr);
 	try
@@ -63,23 +82,11 @@ void Surface::draw(FrameBufferPtr frameBuffer,
 
 	mStoredCallback = callback;
 
-	if (mStoredCallback && !mWaitForFrame)
+	// With presentation feedback the flip is signalled when the commit is
+	// presented or discarded, frame callback is used otherwise
+	if (mStoredCallback && !mWaitForFrame && !mPresentation)
 	{
-		if (!mWlFrameCallback)
-		{
-			mWlFrameCallback = wl_surface_frame(mWlSurface);
-
-			if (!mWlFrameCallback)
-			{
-				throw Exception("Can't get frame callback", errno);
-			}
-
-			if (wl_callback_add_listener(mWlFrameCallback,
-					&mWlFrameListener, this) < 0)
-			{
-				throw Exception("Can't add listener", errno);
-			}
-		}
+		requestFrame();
 	}
 
 	mBuffer = dynamic_cast<WlBuffer*>(frameBuffer.get());
@@ -90,13 +97,23 @@ void Surface::draw(FrameBufferPtr frameBuffer,
 	}
 
 	mBuffer->setSurface(this);
-	
-	wl_surface_damage(mWlSurface, 0, 0,
-					  mBuffer->getWidth(),
-					  mBuffer->getHeight());
+
+	damage();
 
 	wl_surface_attach(mWlSurface, mBuffer->getWLBuffer(), 0, 0);
 
+#ifdef WITH_DMABUF_ZCOPY
+	if (mExplicitSync && mBuffer->isExplicitSyncSupported())
+	{
+		setFences();
+	}
+#endif
+
+	if (mPresentation)
+	{
+		requestFeedback();
+	}
+
 	wl_surface_commit(mWlSurface);
 
 	mCondVar.notify_one();
@@ -110,6 +127,8 @@ void Surface::clear()
 
 	mBuffer = nullptr;
 
+	mDamageHistory.clear();
+
 	wl_surface_attach(mWlSurface, nullptr, 0, 0);
 
 	wl_surface_commit(mWlSurface);
@@ -143,6 +162,309 @@ void Surface::frameHandler()
 
 	sendCallback();
 
+	setActive();
+}
+
+void Surface::sFeedbackSyncOutput(
+		void* data, struct wp_presentation_feedback* feedback,
+		wl_output* output)
+{
+}
+
+void Surface::sFeedbackPresented(
+		void* data, struct wp_presentation_feedback* feedback,
+		uint32_t tvSecHi, uint32_t tvSecLo, uint32_t tvNsec,
+		uint32_t refresh, uint32_t seqHi, uint32_t seqLo, uint32_t flags)
+{
+	uint64_t sec = (static_cast<uint64_t>(tvSecHi) << 32) | tvSecLo;
+
+	static_cast<Surface*>(data)->feedbackHandler(
+			feedback, true, sec * 1000000ull + tvNsec / 1000);
+}
+
+void Surface::sFeedbackDiscarded(
+		void* data, struct wp_presentation_feedback* feedback)
+{
+	static_cast<Surface*>(data)->feedbackHandler(feedback, false, 0);
+}
+
+void Surface::feedbackHandler(struct wp_presentation_feedback* feedback,
+							  bool presented, uint64_t presentTimeUs)
+{
+	unique_lock<mutex> lock(mMutex);
+
+	auto it = find_if(mFeedbacks.begin(), mFeedbacks.end(),
+					  [feedback] (const Feedback& item)
+					  { return item.wpFeedback == feedback; });
+
+	if (it == mFeedbacks.end())
+	{
+		return;
+	}
+
+	if (presented)
+	{
+		mPresentLatency.add(presentTimeUs > it->commitTimeUs ?
+							presentTimeUs - it->commitTimeUs : 0);
+		mPresentedFrames.add();
+	}
+	else
+	{
+		mDiscardedFrames.add();
+	}
+
+	DLOG(mLog, DEBUG) << "Feedback: " << (presented ? "presented" : "discarded");
+
+	auto isLast = next(it) == mFeedbacks.end();
+
+	wp_presentation_feedback_destroy(it->wpFeedback);
+
+	mFeedbacks.erase(it);
+
+	// feedback for superseded commit, the latest one signals the flip
+	if (!isLast)
+	{
+		return;
+	}
+
+	sendCallback();
+
+	if (presented)
+	{
+		setActive();
+	}
+	else
+	{
+		mCondVar.notify_one();
+	}
+}
+
+#ifdef WITH_DMABUF_ZCOPY
+void Surface::sFencedRelease(void* data, zwp_linux_buffer_release_v1* release,
+							 int32_t fence)
+{
+	static_cast<Surface*>(data)->releaseHandler(release, fence);
+}
+
+void Surface::sImmediateRelease(void* data,
+								zwp_linux_buffer_release_v1* release)
+{
+	static_cast<Surface*>(data)->releaseHandler(release, -1);
+}
+
+void Surface::releaseHandler(zwp_linux_buffer_release_v1* release, int fence)
+{
+	unique_lock<mutex> lock(mMutex);
+
+	DLOG(mLog, DEBUG) << "Buffer release, fence: " << fence;
+
+	zwp_linux_buffer_release_v1_destroy(release);
+
+	mWlReleases.remove(release);
+
+	if (fence >= 0)
+	{
+		mReleaseFences.push_back(fence);
+
+		mFencedReleases.add();
+	}
+}
+
+void Surface::setFences()
+{
+	if (!mWlSurfaceSync)
+	{
+		mWlSurfaceSync = mExplicitSync->createSurfaceSynchronization(
+				mWlSurface);
+	}
+
+	// displif doesn't provide fences for the guest rendering. Pass the
+	// implicit fences of the dmabuf if any to let the compositor wait for
+	// them on its side instead of blocking in the kernel.
+	auto fence = mExplicitSync->exportAcquireFence(
+			mBuffer->getDisplayBuffer()->getFd());
+
+	if (fence >= 0)
+	{
+		zwp_linux_surface_synchronization_v1_set_acquire_fence(mWlSurfaceSync,
+															   fence);
+
+		close(fence);
+	}
+
+	auto wlRelease = zwp_linux_surface_synchronization_v1_get_release(
+			mWlSurfaceSync);
+
+	if (!wlRelease)
+	{
+		throw Exception("Can't get buffer release", errno);
+	}
+
+	if (zwp_linux_buffer_release_v1_add_listener(wlRelease,
+			&mWlReleaseListener, this) < 0)
+	{
+		zwp_linux_buffer_release_v1_destroy(wlRelease);
+
+		throw Exception("Can't add buffer release listener", errno);
+	}
+
+	mWlReleases.push_back(wlRelease);
+}
+
+void Surface::waitReleaseFences(unique_lock<mutex>& lock)
+{
+	// the callback is kept queued while it is called, so the following
+	// callbacks are not called before it
+	auto& fenced = mFencedCallbacks.front();
+
+	lock.unlock();
+
+	auto startUs = Metrics::getTimeUs();
+	auto deadlineUs = startUs + cReleaseFenceTimeoutMs * 1000;
+
+	for (auto fence : fenced.fences)
+	{
+		auto nowUs = Metrics::getTimeUs();
+		int timeoutMs = nowUs < deadlineUs ? (deadlineUs - nowUs) / 1000 : 0;
+
+		if (!ExplicitSynchronization::waitFence(fence, timeoutMs))
+		{
+			LOG(mLog, WARNING) << "Release fence timeout";
+		}
+
+		close(fence);
+	}
+
+	mReleaseFenceWait.add(Metrics::getTimeUs() - startUs);
+
+	fenced.callback();
+
+	lock.lock();
+
+	mFencedCallbacks.pop_front();
+}
+#endif
+
+void Surface::damage()
+{
+	auto displayBuffer = mBuffer->getDisplayBuffer().get();
+
+	DamageRegion region;
+
+	bool full = !displayBuffer->takeDamage(region);
+
+	if (!full)
+	{
+		// The buffer damage is relative to its content at the previous attach.
+		// Add the damage of all commits done since then to get the damage
+		// relative to the current surface content.
+		auto it = find_if(mDamageHistory.rbegin(), mDamageHistory.rend(),
+						  [displayBuffer] (const Damage& item)
+						  { return item.buffer == displayBuffer; });
+
+		if (it == mDamageHistory.rend())
+		{
+			full = true;
+		}
+
+		for (auto newer = it.base();
+			 !full && newer != mDamageHistory.end(); newer++)
+		{
+			full = newer->full;
+
+			region.insert(region.end(), newer->region.begin(),
+						  newer->region.end());
+		}
+	}
+
+	// changes of the chroma planes are reported beyond the frame height
+	for (auto it = region.begin(); !full && it != region.end(); it++)
+	{
+		full = it->x + it->width > mBuffer->getWidth() ||
+			   it->y + it->height > mBuffer->getHeight();
+	}
+
+	if (full || region.size() > cMaxDamageRects)
+	{
+		full = true;
+
+		region = {{0, 0, mBuffer->getWidth(), mBuffer->getHeight()}};
+	}
+
+	if (region.empty())
+	{
+		// commit without damage may not trigger repaint and frame events,
+		// damage one pixel to keep flips going
+		region = {{0, 0, 1, 1}};
+	}
+
+	auto useBufferDamage = wl_surface_get_version(mWlSurface) >=
+						   WL_SURFACE_DAMAGE_BUFFER_SINCE_VERSION;
+
+	for (auto& rect : region)
+	{
+		if (useBufferDamage)
+		{
+			wl_surface_damage_buffer(mWlSurface, rect.x, rect.y,
+									 rect.width, rect.height);
+		}
+		else
+		{
+			// buffer scale and transform are not used, so surface and buffer
+			// coordinates are the same
+			wl_surface_damage(mWlSurface, rect.x, rect.y,
+							  rect.width, rect.height);
+		}
+	}
+
+	DLOG(mLog, DEBUG) << "Damage rects: " << region.size()
+					  << (full ? ", full" : "");
+
+	mDamageHistory.push_back({displayBuffer, full, region});
+
+	if (mDamageHistory.size() > cDamageHistorySize)
+	{
+		mDamageHistory.pop_front();
+	}
+}
+
+void Surface::requestFeedback()
+{
+	auto wpFeedback = mPresentation->createFeedback(mWlSurface);
+
+	if (wp_presentation_feedback_add_listener(wpFeedback,
+			&mWpFeedbackListener, this) < 0)
+	{
+		wp_presentation_feedback_destroy(wpFeedback);
+
+		throw Exception("Can't add feedback listener", errno);
+	}
+
+	mFeedbacks.push_back({wpFeedback,
+		Metrics::getTimeUs(mPresentation->getClockId())});
+}
+
+void Surface::requestFrame()
+{
+	if (!mWlFrameCallback)
+	{
+		mWlFrameCallback = wl_surface_frame(mWlSurface);
+
+		if (!mWlFrameCallback)
+		{
+			throw Exception("Can't get frame callback", errno);
+		}
+
+		if (wl_callback_add_listener(mWlFrameCallback,
+				&mWlFrameListener, this) < 0)
+		{
+			throw Exception("Can't add listener", errno);
+		}
+	}
+}
+
+void Surface::setActive()
+{
 	if (mWaitForFrame)
 	{
 		mWaitForFrame = false;
@@ -159,6 +481,24 @@ void Surface::sendCallback()
 {
 	if (mStoredCallback)
 	{
+#ifdef WITH_DMABUF_ZCOPY
+		// the frontend may reuse the buffers once the flip is signalled,
+		// so the compositor has to finish reading them first. The fences
+		// are waited by the surface thread to not block Wayland events.
+		if (!mReleaseFences.empty() || !mFencedCallbacks.empty())
+		{
+			mFencedCallbacks.push_back({mStoredCallback, mReleaseFences});
+
+			mReleaseFences.clear();
+
+			mStoredCallback = nullptr;
+
+			mCondVar.notify_one();
+
+			return;
+		}
+#endif
+
 		mStoredCallback();
 
 		mStoredCallback = nullptr;
@@ -171,6 +511,15 @@ void Surface::run()
 
 	while(!mTerminate)
 	{
+#ifdef WITH_DMABUF_ZCOPY
+		if (!mFencedCallbacks.empty())
+		{
+			waitReleaseFences(lock);
+
+			continue;
+		}
+#endif
+
 		if (!mStoredCallback)
 		{
 			mCondVar.wait(lock);
@@ -205,6 +554,10 @@ void Surface::stop()
 
 void Surface::init(wl_compositor* compositor)
 {
+#ifdef WITH_DMABUF_ZCOPY
+	mWlSurfaceSync = nullptr;
+#endif
+
 	mWlSurface = wl_compositor_create_surface(compositor);
 
 	if (!mWlSurface)
@@ -214,6 +567,13 @@ void Surface::init(wl_compositor* compositor)
 
 	mWlFrameListener = { sFrameHandler };
 
+	mWpFeedbackListener = { sFeedbackSyncOutput, sFeedbackPresented,
+							sFeedbackDiscarded };
+
+#ifdef WITH_DMABUF_ZCOPY
+	mWlReleaseListener = { sFencedRelease, sImmediateRelease };
+#endif
+
 	mThread = thread(&Surface::run, this);
 
 	LOG(mLog, DEBUG) << "Create: " << mWlSurface;
@@ -240,6 +600,44 @@ void Surface::release()
 		wl_callback_destroy(mWlFrameCallback);
 	}
 
+	for (auto& feedback : mFeedbacks)
+	{
+		wp_presentation_feedback_destroy(feedback.wpFeedback);
+	}
+
+	mFeedbacks.clear();
+
+#ifdef WITH_DMABUF_ZCOPY
+	for (auto wlRelease : mWlReleases)
+	{
+		zwp_linux_buffer_release_v1_destroy(wlRelease);
+	}
+
+	mWlReleases.clear();
+
+	for (auto fence : mReleaseFences)
+	{
+		close(fence);
+	}
+
+	mReleaseFences.clear();
+
+	for (auto& fenced : mFencedCallbacks)
+	{
+		for (auto fence : fenced.fences)
+		{
+			close(fence);
+		}
+	}
+
+	mFencedCallbacks.clear();
+
+	if (mWlSurfaceSync)
+	{
+		zwp_linux_surface_synchronization_v1_destroy(mWlSurfaceSync);
+	}
+#endif
+
 	if (mWlSurface)
 	{
 		wl_surface_destroy(mWlSurface);
@@ -9,6 +9,7 @@
 #define SRC_WAYLAND_SURFACE_HPP_
 
 #include <condition_variable>
+#include <list>
 #include <mutex>
 #include <thread>
 
@@ -17,6 +18,11 @@
 #include <xen/be/Log.hpp>
 
 #include "DisplayItf.hpp"
+#include "Metrics.hpp"
+#include "Presentation.hpp"
+#ifdef WITH_DMABUF_ZCOPY
+#include "ExplicitSynchronization.hpp"
+#endif
 
 #include "xdg-shell-client-protocol.h"
 
@@ -67,11 +73,50 @@ private:
 	friend class Connector;
 
 	const uint32_t cFrameTimeoutMs = 50;
+	// number of commits kept to calculate damage for the attached buffer
+	const size_t cDamageHistorySize = 4;
+	// full buffer is damaged if there are more rectangles
+	const size_t cMaxDamageRects = 64;
+#ifdef WITH_DMABUF_ZCOPY
+	// max time to wait for the compositor to finish reading the buffer
+	const int cReleaseFenceTimeoutMs = 100;
+#endif
 
-	explicit Surface(wl_compositor* compositor);
+	/**
+	 * Presentation feedback requested for the surface commit
+	 */
+	struct Feedback
+	{
+		struct wp_presentation_feedback* wpFeedback;
+		uint64_t commitTimeUs;
+	};
+
+#ifdef WITH_DMABUF_ZCOPY
+	/**
+	 * Flip callback which is called when the release fences are signalled
+	 */
+	struct FencedCallback
+	{
+		FrameCallback callback;
+		std::list<int> fences;
+	};
+#endif
+
+	/**
+	 * Damage submitted with the surface commit
+	 */
+	struct Damage
+	{
+		DisplayItf::DisplayBuffer* buffer;
+		bool full;
+		DisplayItf::DamageRegion region;
+	};
+
+	Surface(wl_compositor* compositor, PresentationPtr presentation);
 
 	wl_surface* mWlSurface;
 	wl_callback *mWlFrameCallback;
+	PresentationPtr mPresentation;
 	WlBuffer* mBuffer;
 	bool mTerminate;
 	bool mWaitForFrame;
@@ -82,18 +127,67 @@ private:
 	std::thread mThread;
 
 	wl_callback_listener mWlFrameListener;
+	wp_presentation_feedback_listener mWpFeedbackListener;
 
 	FrameCallback mStoredCallback;
 
+	std::list<Feedback> mFeedbacks;
+	std::list<Damage> mDamageHistory;
+
+#ifdef WITH_DMABUF_ZCOPY
+	ExplicitSynchronizationPtr mExplicitSync;
+	zwp_linux_surface_synchronization_v1* mWlSurfaceSync;
+	zwp_linux_buffer_release_v1_listener mWlReleaseListener;
+	std::list<zwp_linux_buffer_release_v1*> mWlReleases;
+	std::list<int> mReleaseFences;
+	std::list<FencedCallback> mFencedCallbacks;
+#endif
+
+	Metrics::Histogram& mPresentLatency;
+	Metrics::Counter& mPresentedFrames;
+	Metrics::Counter& mDiscardedFrames;
+	Metrics::Counter& mFencedReleases;
+	Metrics::Histogram& mReleaseFenceWait;
+
 	static void sFrameHandler(void *data, wl_callback *wl_callback,
 							  uint32_t callback_data);
 	void frameHandler();
 
+	static void sFeedbackSyncOutput(
+			void* data, struct wp_presentation_feedback* feedback,
+			wl_output* output);
+	static void sFeedbackPresented(
+			void* data, struct wp_presentation_feedback* feedback,
+			uint32_t tvSecHi, uint32_t tvSecLo, uint32_t tvNsec,
+			uint32_t refresh, uint32_t seqHi, uint32_t seqLo, uint32_t flags);
+	static void sFeedbackDiscarded(
+			void* data, struct wp_presentation_feedback* feedback);
+	void feedbackHandler(struct wp_presentation_feedback* feedback,
+						 bool presented, uint64_t presentTimeUs);
+
+#ifdef WITH_DMABUF_ZCOPY
+	static void sFencedRelease(void* data,
+							   zwp_linux_buffer_release_v1* release,
+							   int32_t fence);
+	static void sImmediateRelease(void* data,
+								  zwp_linux_buffer_release_v1* release);
+	void releaseHandler(zwp_linux_buffer_release_v1* release, int fence);
+
+	void setFences();
+	void waitReleaseFences(std::unique_lock<std::mutex>& lock);
+#endif
+
+	void damage();
+	void requestFeedback();
+	void requestFrame();
+
 	void sendCallback();
 
 	void run();
 	void stop();
 
+	void setActive();
+
 	void init(wl_compositor* compositor);
 	void release();
 };
@@ -24,10 +24,8 @@
 #include "Exception.hpp"
 
 using std::find;
-using std::find_if;
 using std::lock_guard;
 using std::mutex;
-using std::pair;
 using std::string;
 
 namespace Wayland {
@@ -52,11 +50,16 @@ SurfaceManager& SurfaceManager::getInstance()
 void SurfaceManager::createSurface(const string& connectorName,
 								   wl_surface* surface)
 {
-	lock_guard<mutex> lock(mMutex);
+	lock_guard<mutex> subscribersLock(mSubscribersMutex);
 
 	LOG(mLog, DEBUG) << "Create surface: " << connectorName;
 
-	mSurfaces[connectorName] = surface;
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		mSurfaces[connectorName] = surface;
+		mConnectors[surface] = getConnectorNameTag(connectorName);
+	}
 
 	for(auto subscriber : mSubscribers)
 	{
@@ -67,16 +70,23 @@ void SurfaceManager::createSurface(const string& connectorName,
 void SurfaceManager::deleteSurface(const string& connectorName,
 								   wl_surface* surface)
 {
-	lock_guard<mutex> lock(mMutex);
+	lock_guard<mutex> subscribersLock(mSubscribersMutex);
 
 	LOG(mLog, DEBUG) << "Delete surface: " << connectorName;
 
+	// remove the surface before notification, so subscribers which look it up
+	// in parallel don't get the deleted one
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		mSurfaces.erase(connectorName);
+		mConnectors.erase(surface);
+	}
+
 	for(auto subscriber : mSubscribers)
 	{
 		subscriber->onSurfaceDelete(connectorName, surface);
 	}
-
-	mSurfaces.erase(connectorName);
 }
 
 wl_surface* SurfaceManager::getSurfaceByConnectorName(const string& connectorName)
@@ -93,27 +103,31 @@ wl_surface* SurfaceManager::getSurfaceByConnectorName(const string& connectorNam
 	return nullptr;
 }
 
-string SurfaceManager::getConnectorNameBySurface(wl_surface* surface)
+const string& SurfaceManager::getConnectorNameBySurface(wl_surface* surface)
 {
-	lock_guard<mutex> lock(mMutex);
+	static const string sUnknown;
 
-	string result;
+	// leave events may come with the already destroyed surface
+	if (!surface)
+	{
+		return sUnknown;
+	}
 
-	auto it = find_if(mSurfaces.begin(), mSurfaces.end(),
-					  [&surface](const pair<string, wl_surface*>& value)
-					  { return value.second == surface; });
+	lock_guard<mutex> lock(mMutex);
 
-	if (it != mSurfaces.end())
+	auto it = mConnectors.find(surface);
+
+	if (it != mConnectors.end())
 	{
-		result = it->first;
+		return *it->second;
 	}
 
-	return result;
+	return sUnknown;
 }
 
 void SurfaceManager::subscribe(SurfaceNotificationItf* subscriber)
 {
-	lock_guard<mutex> lock(mMutex);
+	lock_guard<mutex> lock(mSubscribersMutex);
 
 	if (find(mSubscribers.begin(), mSubscribers.end(), subscriber) ==
 		mSubscribers.end())
@@ -125,7 +139,7 @@ void SurfaceManager::subscribe(SurfaceNotificationItf* subscriber)
 
 void SurfaceManager::unsubscribe(SurfaceNotificationItf* subscriber)
 {
-	lock_guard<mutex> lock(mMutex);
+	lock_guard<mutex> lock(mSubscribersMutex);
 
 	auto it = find(mSubscribers.begin(), mSubscribers.end(), subscriber);
 
@@ -135,4 +149,23 @@ void SurfaceManager::unsubscribe(SurfaceNotificationItf* subscriber)
 	}
 }
 
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+const string* SurfaceManager::getConnectorNameTag(const string& connectorName)
+{
+	auto it = find(mConnectorNames.begin(), mConnectorNames.end(),
+				   connectorName);
+
+	if (it != mConnectorNames.end())
+	{
+		return &(*it);
+	}
+
+	mConnectorNames.push_back(connectorName);
+
+	return &mConnectorNames.back();
+}
+
 }
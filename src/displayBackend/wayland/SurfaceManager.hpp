@@ -54,7 +54,14 @@ public:
 	void deleteSurface(const std::string& connectorName, wl_surface* surface);
 
 	wl_surface* getSurfaceByConnectorName(const std::string& connectorName);
-	std::string getConnectorNameBySurface(wl_surface* surface);
+
+	/**
+	 * Returns connector name of the surface. The surface pointer is only
+	 * used as a key, so the surface may be already destroyed.
+	 * @param surface surface
+	 * @return connector name or empty string if the surface is not known
+	 */
+	const std::string& getConnectorNameBySurface(wl_surface* surface);
 
 	void subscribe(SurfaceNotificationItf* subscriber);
 	void unsubscribe(SurfaceNotificationItf* subscriber);
@@ -65,10 +72,19 @@ private:
 
 	std::list<SurfaceNotificationItf*> mSubscribers;
 	std::unordered_map<std::string, wl_surface*> mSurfaces;
+	std::unordered_map<wl_surface*, const std::string*> mConnectors;
+	// connector names returned by reference, never removed to keep them
+	// valid for lookups which race with the surface deletion
+	std::list<std::string> mConnectorNames;
 
 	XenBackend::Log mLog;
 
+	// protects surfaces and connector names
 	std::mutex mMutex;
+	// protects subscribers and serializes notifications
+	std::mutex mSubscribersMutex;
+
+	const std::string* getConnectorNameTag(const std::string& connectorName);
 };
 
 }
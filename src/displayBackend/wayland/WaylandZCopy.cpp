@@ -23,6 +23,12 @@
 
 #include <algorithm>
 
+#include <sys/mman.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include <drm_fourcc.h>
+
 #include "Exception.hpp"
 #include "FrameBuffer.hpp"
 
@@ -321,10 +327,17 @@ void WaylandKms::release()
  * Linux dmabuf
  ******************************************************************************/
 
+const uint32_t WaylandLinuxDmabuf::cVersion;
+
 WaylandLinuxDmabuf::WaylandLinuxDmabuf(wl_registry* registry,
 									   uint32_t id, uint32_t version) :
 	WaylandZCopy(registry, id, version),
-	mWlLinuxDmabuf(nullptr)
+	mWlLinuxDmabuf(nullptr),
+	mWlFeedback(nullptr),
+	mFormatTable(nullptr),
+	mFormatTableSize(0),
+	mTrancheFlags(0),
+	mFeedbackDone(false)
 {
 	try
 	{
@@ -360,7 +373,8 @@ WaylandLinuxDmabuf::createLinuxDmabufBuffer(DisplayBufferPtr displayBuffer,
 	}
 
 	return  FrameBufferPtr(new LinuxDmabufBuffer(mWlLinuxDmabuf, displayBuffer,
-												 width, height, pixelFormat));
+												 width, height, pixelFormat,
+												 getModifier(pixelFormat)));
 }
 
 /*******************************************************************************
@@ -371,38 +385,230 @@ void WaylandLinuxDmabuf::sOnModifiers(void *data,
 									  zwp_linux_dmabuf_v1 *zwpLinuxDmabuf,
 									  uint32_t format, uint32_t modifierHi,
 									  uint32_t modifierLo)
+{
+	static_cast<WaylandLinuxDmabuf*>(data)->onModifier(
+			format, (static_cast<uint64_t>(modifierHi) << 32) | modifierLo);
+}
+
+void WaylandLinuxDmabuf::sOnFormat(void *data,
+								   zwp_linux_dmabuf_v1 *zwpLinuxDmabuf,
+								   uint32_t format)
+{
+	/* This one is deprecated. */
+}
+
+void WaylandLinuxDmabuf::sOnFeedbackDone(
+		void *data, zwp_linux_dmabuf_feedback_v1 *feedback)
+{
+	static_cast<WaylandLinuxDmabuf*>(data)->onFeedbackDone();
+}
+
+void WaylandLinuxDmabuf::sOnFormatTable(
+		void *data, zwp_linux_dmabuf_feedback_v1 *feedback,
+		int32_t fd, uint32_t size)
+{
+	static_cast<WaylandLinuxDmabuf*>(data)->onFormatTable(fd, size);
+}
+
+void WaylandLinuxDmabuf::sOnMainDevice(
+		void *data, zwp_linux_dmabuf_feedback_v1 *feedback, wl_array *device)
+{
+	dev_t dev = 0;
+
+	if (device->size == sizeof(dev))
+	{
+		dev = *static_cast<dev_t*>(device->data);
+	}
+
+	LOG(static_cast<WaylandLinuxDmabuf*>(data)->mLog, DEBUG)
+		<< "Main device: " << major(dev) << ":" << minor(dev);
+}
+
+void WaylandLinuxDmabuf::sOnTrancheDone(
+		void *data, zwp_linux_dmabuf_feedback_v1 *feedback)
+{
+	// flags are set per tranche
+	static_cast<WaylandLinuxDmabuf*>(data)->onTrancheFlags(0);
+}
+
+void WaylandLinuxDmabuf::sOnTrancheTargetDevice(
+		void *data, zwp_linux_dmabuf_feedback_v1 *feedback, wl_array *device)
+{
+}
+
+void WaylandLinuxDmabuf::sOnTrancheFormats(
+		void *data, zwp_linux_dmabuf_feedback_v1 *feedback, wl_array *indices)
+{
+	static_cast<WaylandLinuxDmabuf*>(data)->onTrancheFormats(indices);
+}
+
+void WaylandLinuxDmabuf::sOnTrancheFlags(
+		void *data, zwp_linux_dmabuf_feedback_v1 *feedback, uint32_t flags)
+{
+	static_cast<WaylandLinuxDmabuf*>(data)->onTrancheFlags(flags);
+}
+
+void WaylandLinuxDmabuf::onModifier(uint32_t format, uint64_t modifier)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	addModifier(format, modifier);
+}
+
+void WaylandLinuxDmabuf::onFeedbackDone()
+{
+	lock_guard<mutex> lock(mMutex);
+
+	LOG(mLog, DEBUG) << "Feedback done, formats: " << mSupportedFormats.size();
+
+	mFeedbackDone = true;
+}
+
+void WaylandLinuxDmabuf::onFormatTable(int fd, uint32_t size)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	unmapFormatTable();
+
+	auto table = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	close(fd);
+
+	if (table == MAP_FAILED)
+	{
+		LOG(mLog, ERROR) << "Can't map format table, size: " << size;
+
+		return;
+	}
+
+	mFormatTable = static_cast<const FormatTableEntry*>(table);
+	mFormatTableSize = size / sizeof(FormatTableEntry);
+
+	LOG(mLog, DEBUG) << "Format table, entries: " << mFormatTableSize;
+}
+
+void WaylandLinuxDmabuf::onTrancheFormats(wl_array *indices)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	// the compositor resends all parameters when any of them changes
+	if (mFeedbackDone)
+	{
+		mFeedbackDone = false;
+
+		mSupportedFormats.clear();
+		mModifiers.clear();
+	}
+
+	auto index = static_cast<const uint16_t*>(indices->data);
+	auto count = indices->size / sizeof(uint16_t);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (index[i] >= mFormatTableSize)
+		{
+			LOG(mLog, ERROR) << "Wrong format table index: " << index[i];
+
+			continue;
+		}
+
+		auto& entry = mFormatTable[index[i]];
+
+		if (mTrancheFlags & ZWP_LINUX_DMABUF_FEEDBACK_V1_TRANCHE_FLAGS_SCANOUT)
+		{
+			DLOG(mLog, DEBUG) << "Scanout format: 0x" << std::hex
+							  << entry.format << ", modifier: 0x"
+							  << entry.modifier;
+		}
+
+		addModifier(entry.format, entry.modifier);
+	}
+}
+
+void WaylandLinuxDmabuf::onTrancheFlags(uint32_t flags)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	mTrancheFlags = flags;
+}
+
+void WaylandLinuxDmabuf::addModifier(uint32_t format, uint64_t modifier)
 {
 	/*
 	 * Modifiers are described at
 	 * https://www.khronos.org/registry/EGL/extensions/EXT/EGL_EXT_image_dma_buf_import_modifiers.txt
 	 *
-	 * We do not support passing modifiers from the frontend to the backend,
-	 * so ignore all formats with modifiers set.
+	 * Buffers shared by the frontend are always linear as displif has no
+	 * means to pass modifiers. So only formats advertised with linear or
+	 * implicit (DRM_FORMAT_MOD_INVALID) modifier can be used.
 	 *
 	 * If IGNORE_MODIFIER_VALUES is defined, it will disable pixel format modifiers
 	 * check. This option may be useful for a host system, which supports pixel formats
-	 * without modifiers only, or a guest system with some specific pixel format
-	 * with modifiers. In that case(i.e. IGNORE_MODIFIER_VALUES defined),
-	 * some default settings may apply, and host-guest graphics buffers interaction
-	 * may proceed without issues. NOTE: default behavior may also result in multiplane
+	 * with non linear modifiers only. In that case (i.e. IGNORE_MODIFIER_VALUES
+	 * defined), the buffer is passed as linear, and host-guest graphics buffers
+	 * interaction may proceed without issues. NOTE: it may also result in multiplane
 	 * format choice, which is currently not supported by the protocol, which may lead
 	 * to incorrect buffer interpretation by the host system.
 	 */
 
 #ifndef IGNORE_MODIFIER_VALUES
-	if (modifierHi != 0 || modifierLo != 0)
+	if (modifier != DRM_FORMAT_MOD_LINEAR && modifier != DRM_FORMAT_MOD_INVALID)
 	{
 		return;
 	}
 #endif
-	static_cast<WaylandLinuxDmabuf*>(data)->onFormat(format);
+
+	auto& modifiers = mModifiers[format];
+
+	if (find(modifiers.begin(), modifiers.end(), modifier) != modifiers.end())
+	{
+		return;
+	}
+
+	if (modifiers.empty())
+	{
+		LOG(mLog, DEBUG) << "onFormat format: 0x" << std::hex << format;
+
+		mSupportedFormats.push_back(format);
+	}
+
+	modifiers.push_back(modifier);
 }
 
-void WaylandLinuxDmabuf::sOnFormat(void *data,
-								   zwp_linux_dmabuf_v1 *zwpLinuxDmabuf,
-								   uint32_t format)
+uint64_t WaylandLinuxDmabuf::getModifier(uint32_t format)
 {
-	/* This one is deprecated. */
+	auto it = mModifiers.find(format);
+
+	if (it == mModifiers.end())
+	{
+		return DRM_FORMAT_MOD_LINEAR;
+	}
+
+	auto& modifiers = it->second;
+
+	// explicit linear modifier lets the compositor know the layout without
+	// guessing, so it is preferred over the implicit one
+	if (find(modifiers.begin(), modifiers.end(), DRM_FORMAT_MOD_LINEAR) ==
+		modifiers.end() &&
+		find(modifiers.begin(), modifiers.end(), DRM_FORMAT_MOD_INVALID) !=
+		modifiers.end())
+	{
+		return DRM_FORMAT_MOD_INVALID;
+	}
+
+	return DRM_FORMAT_MOD_LINEAR;
+}
+
+void WaylandLinuxDmabuf::unmapFormatTable()
+{
+	if (mFormatTable)
+	{
+		munmap(const_cast<FormatTableEntry*>(mFormatTable),
+			   mFormatTableSize * sizeof(FormatTableEntry));
+
+		mFormatTable = nullptr;
+		mFormatTableSize = 0;
+	}
 }
 
 void WaylandLinuxDmabuf::init(uint32_t version)
@@ -419,11 +625,36 @@ void WaylandLinuxDmabuf::init(uint32_t version)
 		throw Exception("Can't bind Linux dmabuf", errno);
 	}
 
-	mWlListener = {sOnFormat, sOnModifiers};
-
-	if (zwp_linux_dmabuf_v1_add_listener(mWlLinuxDmabuf, &mWlListener, this) < 0)
+	if (version >= ZWP_LINUX_DMABUF_V1_GET_DEFAULT_FEEDBACK_SINCE_VERSION)
 	{
-		throw Exception("Can't add listener", errno);
+		// format and modifier events are not sent since version 4
+		mWlFeedback = zwp_linux_dmabuf_v1_get_default_feedback(mWlLinuxDmabuf);
+
+		if (!mWlFeedback)
+		{
+			throw Exception("Can't get Linux dmabuf feedback", errno);
+		}
+
+		mWlFeedbackListener = { sOnFeedbackDone, sOnFormatTable,
+								sOnMainDevice, sOnTrancheDone,
+								sOnTrancheTargetDevice, sOnTrancheFormats,
+								sOnTrancheFlags };
+
+		if (zwp_linux_dmabuf_feedback_v1_add_listener(mWlFeedback,
+				&mWlFeedbackListener, this) < 0)
+		{
+			throw Exception("Can't add feedback listener", errno);
+		}
+	}
+	else
+	{
+		mWlListener = {sOnFormat, sOnModifiers};
+
+		if (zwp_linux_dmabuf_v1_add_listener(mWlLinuxDmabuf, &mWlListener,
+											 this) < 0)
+		{
+			throw Exception("Can't add listener", errno);
+		}
 	}
 
 	/*
@@ -432,11 +663,18 @@ void WaylandLinuxDmabuf::init(uint32_t version)
 	 */
 	onDevice("");
 
-	LOG(mLog, DEBUG) << "Create";
+	LOG(mLog, DEBUG) << "Create, version: " << version;
 }
 
 void WaylandLinuxDmabuf::release()
 {
+	if (mWlFeedback)
+	{
+		zwp_linux_dmabuf_feedback_v1_destroy(mWlFeedback);
+	}
+
+	unmapFormatTable();
+
 	if (mWlLinuxDmabuf)
 	{
 		zwp_linux_dmabuf_v1_destroy(mWlLinuxDmabuf);
@@ -23,8 +23,10 @@
 #define SRC_WAYLAND_WAYLANDDRM_HPP_
 
 #include <list>
+#include <map>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include <xen/be/Log.hpp>
 
@@ -151,6 +153,11 @@ class WaylandLinuxDmabuf : public WaylandZCopy
 {
 public:
 
+	/**
+	 * Max supported protocol version
+	 */
+	static const uint32_t cVersion = 4;
+
 	~WaylandLinuxDmabuf();
 
 	DisplayItf::FrameBufferPtr createLinuxDmabufBuffer(
@@ -159,8 +166,27 @@ public:
 
 private:
 
+	/**
+	 * Entry of the feedback format table
+	 */
+	struct FormatTableEntry
+	{
+		uint32_t format;
+		uint32_t padding;
+		uint64_t modifier;
+	};
+
 	zwp_linux_dmabuf_v1* mWlLinuxDmabuf;
 	zwp_linux_dmabuf_v1_listener mWlListener;
+	zwp_linux_dmabuf_feedback_v1* mWlFeedback;
+	zwp_linux_dmabuf_feedback_v1_listener mWlFeedbackListener;
+
+	const FormatTableEntry* mFormatTable;
+	size_t mFormatTableSize;
+	uint32_t mTrancheFlags;
+	bool mFeedbackDone;
+
+	std::map<uint32_t, std::vector<uint64_t>> mModifiers;
 
 	friend class Display;
 
@@ -174,6 +200,37 @@ private:
 						  zwp_linux_dmabuf_v1 *zwpLinuxDmabuf,
 						  uint32_t format);
 
+	static void sOnFeedbackDone(void *data,
+								zwp_linux_dmabuf_feedback_v1 *feedback);
+	static void sOnFormatTable(void *data,
+							   zwp_linux_dmabuf_feedback_v1 *feedback,
+							   int32_t fd, uint32_t size);
+	static void sOnMainDevice(void *data,
+							  zwp_linux_dmabuf_feedback_v1 *feedback,
+							  wl_array *device);
+	static void sOnTrancheDone(void *data,
+							   zwp_linux_dmabuf_feedback_v1 *feedback);
+	static void sOnTrancheTargetDevice(void *data,
+									   zwp_linux_dmabuf_feedback_v1 *feedback,
+									   wl_array *device);
+	static void sOnTrancheFormats(void *data,
+								  zwp_linux_dmabuf_feedback_v1 *feedback,
+								  wl_array *indices);
+	static void sOnTrancheFlags(void *data,
+								zwp_linux_dmabuf_feedback_v1 *feedback,
+								uint32_t flags);
+
+	void onModifier(uint32_t format, uint64_t modifier);
+	void onFeedbackDone();
+	void onFormatTable(int fd, uint32_t size);
+	void onTrancheFormats(wl_array *indices);
+	void onTrancheFlags(uint32_t flags);
+
+	void addModifier(uint32_t format, uint64_t modifier);
+	uint64_t getModifier(uint32_t format);
+
+	void unmapFormatTable();
+
 	virtual void authenticate() override {};
 
 	void init(uint32_t version);
@@ -23,7 +23,7 @@
 #include <sstream>
 #include <vector>
 
-#include "input/DevInput.hpp"
+#include "input/DevInputRegistry.hpp"
 #ifdef WITH_WAYLAND
 #include "input/WlInput.hpp"
 #endif
@@ -59,17 +59,30 @@ InputRingBuffer::InputRingBuffer(KeyboardPtr keyboard, PointerPtr pointer,
 								 TouchPtr touch, bool isReqAbs,
 								 bool isReqMTouch, domid_t domId,
 								 evtchn_port_t port, int ref,
-								 int offset, size_t size) :
-	RingBufferOutBase<xenkbd_page, xenkbd_in_event>(domId, port, ref,
-													offset, size),
+								 int offset, size_t size,
+								 TimerQueuePtr timerQueue,
+								 uint32_t coalesceMs) :
+	BatchRingBufferOut<xenkbd_page, xenkbd_in_event>(domId, port, ref,
+													 offset, size,
+													 cFlushTimeoutMs,
+													 timerQueue),
 	mKeyboard(keyboard),
 	mPointer(pointer),
 	mTouch(touch),
-	mLog("InputRingBuffer")
+	mLog("InputRingBuffer"),
+	mKeyboardTime(0),
+	mPointerTime(0),
+	mTouchTime(0),
+	mKeyboardLatency(getLatencyHistogram(domId, "keyboard")),
+	mPointerLatency(getLatencyHistogram(domId, "pointer")),
+	mTouchLatency(getLatencyHistogram(domId, "touch"))
 {
 	if (mKeyboard)
 	{
-		mKeyboard->setCallbacks({bind(&InputRingBuffer::onKey, this, _1, _2)});
+		mKeyboard->setCallbacks({
+			bind(&InputRingBuffer::onKey, this, _1, _2),
+			[this](uint64_t timeUs) { mKeyboardTime = timeUs; },
+		});
 	}
 
 	if (mPointer)
@@ -80,6 +93,8 @@ InputRingBuffer::InputRingBuffer(KeyboardPtr keyboard, PointerPtr pointer,
 				bind(&InputRingBuffer::onMoveRel, this, _1, _2, _3),
 				bind(&InputRingBuffer::onMoveAbs, this, _1, _2, _3),
 				bind(&InputRingBuffer::onButton, this, _1, _2),
+				bind(&InputRingBuffer::onPointerFrame, this),
+				[this](uint64_t timeUs) { mPointerTime = timeUs; },
 			});
 		}
 		else
@@ -88,6 +103,8 @@ InputRingBuffer::InputRingBuffer(KeyboardPtr keyboard, PointerPtr pointer,
 				bind(&InputRingBuffer::onMoveRel, this, _1, _2, _3),
 				nullptr,
 				bind(&InputRingBuffer::onButton, this, _1, _2),
+				bind(&InputRingBuffer::onPointerFrame, this),
+				[this](uint64_t timeUs) { mPointerTime = timeUs; },
 			});
 		}
 	}
@@ -99,18 +116,144 @@ InputRingBuffer::InputRingBuffer(KeyboardPtr keyboard, PointerPtr pointer,
 			bind(&InputRingBuffer::onUp, this, _1),
 			bind(&InputRingBuffer::onMotion, this, _1, _2, _3),
 			bind(&InputRingBuffer::onFrame, this, _1),
+			[this](uint64_t timeUs) { mTouchTime = timeUs; },
 		});
 	}
 
+	if (coalesceMs)
+	{
+		setCoalescing(cCoalesceThreshold, coalesceMs);
+	}
+
 	LOG(mLog, DEBUG) << "Create, reqAbs: " << isReqAbs
-					 << ", reqMTouch: " << isReqMTouch;
+					 << ", reqMTouch: " << isReqMTouch
+					 << ", coalesce: " << coalesceMs;
 }
 
 InputRingBuffer::~InputRingBuffer()
 {
+	stopTimer();
+
 	LOG(mLog, DEBUG) << "Delete";
 }
 
+Metrics::Histogram& InputRingBuffer::getLatencyHistogram(domid_t domId,
+														 const string& device)
+{
+	return Metrics::Collector::getInstance().getHistogram(
+			"input.dom" + to_string(domId) + "." + device + "_latency_us");
+}
+
+bool InputRingBuffer::coalesceEvent(vector<xenkbd_in_event>& queue,
+									const xenkbd_in_event& event)
+{
+	auto& last = queue.back();
+
+	switch(event.type)
+	{
+	case XENKBD_TYPE_MOTION:
+
+		if (last.type == XENKBD_TYPE_MOTION)
+		{
+			last.motion.rel_x += event.motion.rel_x;
+			last.motion.rel_y += event.motion.rel_y;
+			last.motion.rel_z += event.motion.rel_z;
+
+			return true;
+		}
+
+		break;
+
+	case XENKBD_TYPE_POS:
+
+		if (last.type == XENKBD_TYPE_POS)
+		{
+			last.pos.abs_x = event.pos.abs_x;
+			last.pos.abs_y = event.pos.abs_y;
+			last.pos.rel_z += event.pos.rel_z;
+
+			return true;
+		}
+
+		break;
+
+	case XENKBD_TYPE_MTOUCH:
+
+		return coalesceTouchEvent(queue, event);
+
+	default:
+
+		break;
+	}
+
+	return false;
+}
+
+bool InputRingBuffer::isDroppable(const xenkbd_in_event& event)
+{
+	// only motion may be lost under overload, keys, wheel and touch
+	// down/up/frame events are never dropped
+	switch(event.type)
+	{
+	case XENKBD_TYPE_MOTION:
+
+		return event.motion.rel_z == 0;
+
+	case XENKBD_TYPE_POS:
+
+		return event.pos.rel_z == 0;
+
+	case XENKBD_TYPE_MTOUCH:
+
+		return event.mtouch.event_type == XENKBD_MT_EV_MOTION;
+
+	default:
+
+		return false;
+	}
+}
+
+bool InputRingBuffer::coalesceTouchEvent(vector<xenkbd_in_event>& queue,
+										 const xenkbd_in_event& event)
+{
+	if (event.mtouch.event_type == XENKBD_MT_EV_SYN)
+	{
+		// frames left empty by coalescing are dropped
+		auto& last = queue.back();
+
+		return last.type == XENKBD_TYPE_MTOUCH &&
+			   last.mtouch.event_type == XENKBD_MT_EV_SYN;
+	}
+
+	if (event.mtouch.event_type != XENKBD_MT_EV_MOTION)
+	{
+		return false;
+	}
+
+	// replace the latest position of the contact unless the contact was
+	// pressed or released after it
+	for (auto it = queue.rbegin(); it != queue.rend(); it++)
+	{
+		if (it->type != XENKBD_TYPE_MTOUCH ||
+			it->mtouch.contact_id != event.mtouch.contact_id ||
+			it->mtouch.event_type == XENKBD_MT_EV_SYN)
+		{
+			continue;
+		}
+
+		if (it->mtouch.event_type != XENKBD_MT_EV_MOTION)
+		{
+			return false;
+		}
+
+		it->mtouch.u.pos = event.mtouch.u.pos;
+
+		return true;
+	}
+
+	return false;
+}
+
 void InputRingBuffer::onKey(uint32_t key, uint32_t state)
 {
 	DLOG(mLog, DEBUG) << "onKey key: " << key << ", state: " << state;
@@ -121,7 +264,7 @@ void InputRingBuffer::onKey(uint32_t key, uint32_t state)
 	event.key.keycode = key;
 	event.key.pressed = state;
 
-	sendEvent(event);
+	sendEvent(event, mKeyboardTime, &mKeyboardLatency);
 }
 
 void InputRingBuffer::onMoveRel(int32_t x, int32_t y, int32_t z)
@@ -135,7 +278,7 @@ void InputRingBuffer::onMoveRel(int32_t x, int32_t y, int32_t z)
 	event.motion.rel_y = y;
 	event.motion.rel_z = z;
 
-	sendEvent(event);
+	queueEvent(event, mPointerTime, &mPointerLatency);
 }
 
 void InputRingBuffer::onMoveAbs(int32_t x, int32_t y, int32_t z)
@@ -149,7 +292,7 @@ void InputRingBuffer::onMoveAbs(int32_t x, int32_t y, int32_t z)
 	event.pos.abs_y = y;
 	event.pos.rel_z = z;
 
-	sendEvent(event);
+	queueEvent(event, mPointerTime, &mPointerLatency);
 }
 
 void InputRingBuffer::onButton(uint32_t button, uint32_t state)
@@ -162,7 +305,12 @@ void InputRingBuffer::onButton(uint32_t button, uint32_t state)
 	event.key.keycode = button;
 	event.key.pressed = state;
 
-	sendEvent(event);
+	queueEvent(event, mPointerTime, &mPointerLatency);
+}
+
+void InputRingBuffer::onPointerFrame()
+{
+	flush();
 }
 
 void InputRingBuffer::onDown(int32_t id, int32_t x, int32_t y)
@@ -176,7 +324,7 @@ void InputRingBuffer::onDown(int32_t id, int32_t x, int32_t y)
 	event.mtouch.contact_id = id;
 	event.mtouch.u.pos = {x, y};
 
-	sendEvent(event);
+	queueEvent(event, mTouchTime, &mTouchLatency);
 }
 
 void InputRingBuffer::onUp(int32_t id)
@@ -189,7 +337,7 @@ void InputRingBuffer::onUp(int32_t id)
 	event.mtouch.event_type = XENKBD_MT_EV_UP;
 	event.mtouch.contact_id = id;
 
-	sendEvent(event);
+	queueEvent(event, mTouchTime, &mTouchLatency);
 }
 
 void InputRingBuffer::onMotion(int32_t id, int32_t x, int32_t y)
@@ -203,7 +351,7 @@ void InputRingBuffer::onMotion(int32_t id, int32_t x, int32_t y)
 	event.mtouch.contact_id = id;
 	event.mtouch.u.pos = {x, y};
 
-	sendEvent(event);
+	queueEvent(event, mTouchTime, &mTouchLatency);
 }
 
 void InputRingBuffer::onFrame(int32_t id)
@@ -216,7 +364,7 @@ void InputRingBuffer::onFrame(int32_t id)
 	event.mtouch.event_type = XENKBD_MT_EV_SYN;
 	event.mtouch.contact_id = id;
 
-	sendEvent(event);
+	sendEvent(event, mTouchTime, &mTouchLatency);
 }
 
 
@@ -225,9 +373,13 @@ void InputRingBuffer::onFrame(int32_t id)
  ******************************************************************************/
 
 InputFrontendHandler::InputFrontendHandler(const string& devName,
-										   domid_t domId, uint16_t devId) :
+										   domid_t domId, uint16_t devId,
+										   TimerQueuePtr timerQueue,
+										   uint32_t coalesceMs) :
 	FrontendHandlerBase("VkbdFrontend", devName, domId, devId),
-	mLog("VkbdFrontend")
+	mLog("VkbdFrontend"),
+	mTimerQueue(timerQueue),
+	mCoalesceMs(coalesceMs)
 {
 	setBackendState(XenbusStateInitWait);
 }
@@ -269,7 +421,8 @@ void InputFrontendHandler::onBind()
 								createInputDevice<TouchCallbacks>(touchId),
 								isReqAbs, isReqMTouch,
 								getDomId(), port, ref,
-								XENKBD_IN_RING_OFFS, XENKBD_IN_RING_SIZE));
+								XENKBD_IN_RING_OFFS, XENKBD_IN_RING_SIZE,
+								mTimerQueue, mCoalesceMs));
 
 	addRingBuffer(eventRingBuffer);
 }
@@ -320,7 +473,8 @@ InputFrontendHandler::createInputDevice(const string& id)
 
 		if (id[0] == '/')
 		{
-			return shared_ptr<InputItf::InputDevice<T>>(new DevInput<T>(id));
+			return DevInputRegistry::getInstance().getDevice<T>(id,
+																getDomId());
 		}
 #ifdef WITH_WAYLAND
 		else if (mDisplay)
@@ -343,9 +497,11 @@ void InputBackend::onNewFrontend(domid_t domId, uint16_t devId)
 #ifdef WITH_WAYLAND
 	addFrontendHandler(FrontendHandlerPtr(
 			new InputFrontendHandler(XENKBD_DRIVER_NAME,
-									 domId, devId, mDisplay)));
+									 domId, devId, mDisplay, mTimerQueue,
+									 mCoalesceMs)));
 #else
 	addFrontendHandler(FrontendHandlerPtr(
-			new InputFrontendHandler(XENKBD_DRIVER_NAME, domId, devId)));
+			new InputFrontendHandler(XENKBD_DRIVER_NAME, domId, devId,
+									 mTimerQueue, mCoalesceMs)));
 #endif
 }
@@ -21,12 +21,15 @@
 #ifndef INPUTBACKEND_HPP_
 #define INPUTBACKEND_HPP_
 
+#include <atomic>
+
 #include <xen/be/BackendBase.hpp>
 #include <xen/be/FrontendHandlerBase.hpp>
 #include <xen/be/Log.hpp>
 
 #include "kbdif.h"
 
+#include "BatchRingBuffer.hpp"
 #include "InputItf.hpp"
 
 #ifdef WITH_WAYLAND
@@ -39,11 +42,11 @@
  ******************************************************************************/
 
 /***************************************************************************//**
- * Ring buffer used to send events to the frontend.
+ * Ring buffer used to send events to the frontend. Events which belong to one
+ * input frame are published with single ring update and notification.
  * @ingroup input_be
  ******************************************************************************/
-class InputRingBuffer : public XenBackend::RingBufferOutBase<xenkbd_page,
-		xenkbd_in_event>
+class InputRingBuffer : public BatchRingBufferOut<xenkbd_page, xenkbd_in_event>
 {
 public:
 	/**
@@ -57,35 +60,64 @@ public:
 	 * @param ref         grant table reference
 	 * @param offset      start of the ring buffer inside the page
 	 * @param size        size of the ring buffer
+	 * @param timerQueue  timer queue of batch deadlines, nullptr - own queue
+	 * @param coalesceMs  latency budget of motion coalescing, 0 - disabled
 	 */
 	InputRingBuffer(InputItf::KeyboardPtr keyboard,
 					InputItf::PointerPtr pointer,
 					InputItf::TouchPtr touch,
 					bool isReqAbs, bool isReqMTouch,
 					domid_t domId, evtchn_port_t port, int ref,
-					int offset, size_t size);
+					int offset, size_t size, TimerQueuePtr timerQueue,
+					uint32_t coalesceMs = 0);
 
 	~InputRingBuffer();
 
+protected:
+
+	bool coalesceEvent(std::vector<xenkbd_in_event>& queue,
+					   const xenkbd_in_event& event) override;
+	bool isDroppable(const xenkbd_in_event& event) override;
+
 private:
 
+	static const uint32_t cFlushTimeoutMs = 2;
+	static const uint32_t cCoalesceThreshold = 50;
+
 	InputItf::KeyboardPtr mKeyboard;
 	InputItf::PointerPtr mPointer;
 	InputItf::TouchPtr mTouch;
 
 	XenBackend::Log mLog;
 
+	// source times of the current events
+	std::atomic<uint64_t> mKeyboardTime;
+	std::atomic<uint64_t> mPointerTime;
+	std::atomic<uint64_t> mTouchTime;
+
+	// source to ring publish latency
+	Metrics::Histogram& mKeyboardLatency;
+	Metrics::Histogram& mPointerLatency;
+	Metrics::Histogram& mTouchLatency;
+
+	Metrics::Histogram& getLatencyHistogram(domid_t domId,
+											const std::string& device);
+
 	// keyboard
 	void onKey(uint32_t key, uint32_t state);
 	// pointer
 	void onMoveRel(int32_t x, int32_t y, int32_t z);
 	void onMoveAbs(int32_t x, int32_t y, int32_t z);
 	void onButton(uint32_t button, uint32_t state);
+	void onPointerFrame();
 	// touch
 	void onDown(int32_t id, int32_t x, int32_t y);
 	void onUp(int32_t id);
 	void onMotion(int32_t id, int32_t x, int32_t y);
 	void onFrame(int32_t id);
+
+	bool coalesceTouchEvent(std::vector<xenkbd_in_event>& queue,
+							const xenkbd_in_event& event);
 };
 
 typedef std::shared_ptr<InputRingBuffer> InputRingBufferPtr;
@@ -102,15 +134,21 @@ public:
 	 * @param devName      device name
 	 * @param domId        frontend domain id
 	 * @param devId        frontend device id
+	 * @param timerQueue   timer queue of batch deadlines, nullptr - own queue
+	 * @param coalesceMs   latency budget of motion coalescing, 0 - disabled
 	 */
 	InputFrontendHandler(const std::string& devName,
-						 domid_t domId, uint16_t devId);
+						 domid_t domId, uint16_t devId,
+						 TimerQueuePtr timerQueue,
+						 uint32_t coalesceMs = 0);
 
 #ifdef WITH_WAYLAND
 	InputFrontendHandler(const std::string& devName,
 			 	 	 	 domid_t domId, uint16_t devId,
-						 Wayland::DisplayPtr display) :
-		InputFrontendHandler(devName, domId, devId)
+						 Wayland::DisplayPtr display,
+						 TimerQueuePtr timerQueue,
+						 uint32_t coalesceMs = 0) :
+		InputFrontendHandler(devName, domId, devId, timerQueue, coalesceMs)
 		{ mDisplay = display; }
 #endif
 
@@ -124,6 +162,8 @@ protected:
 private:
 
 	XenBackend::Log mLog;
+	TimerQueuePtr mTimerQueue;
+	uint32_t mCoalesceMs;
 
 #ifdef WITH_WAYLAND
 	Wayland::DisplayPtr mDisplay;
@@ -146,14 +186,18 @@ class InputBackend : public XenBackend::BackendBase
 public:
 	/**
 	 * @param deviceName   device name
+	 * @param coalesceMs   latency budget of motion coalescing, 0 - disabled
 	 */
-	InputBackend(const std::string& deviceName) :
-		BackendBase("VkbdBackend", deviceName)
+	InputBackend(const std::string& deviceName, uint32_t coalesceMs = 0) :
+		BackendBase("VkbdBackend", deviceName),
+		mTimerQueue(new TimerQueue()),
+		mCoalesceMs(coalesceMs)
 		{}
 
 #ifdef WITH_WAYLAND
-	InputBackend(const std::string& deviceName, Wayland::DisplayPtr display) :
-		InputBackend(deviceName)
+	InputBackend(const std::string& deviceName, Wayland::DisplayPtr display,
+				 uint32_t coalesceMs = 0) :
+		InputBackend(deviceName, coalesceMs)
 		{ mDisplay = display; }
 #endif
 
@@ -168,6 +212,9 @@ protected:
 
 private:
 
+	TimerQueuePtr mTimerQueue;
+	uint32_t mCoalesceMs;
+
 #ifdef WITH_WAYLAND
 	Wayland::DisplayPtr mDisplay;
 #endif
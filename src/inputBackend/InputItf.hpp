@@ -31,9 +31,15 @@ namespace InputItf {
  * Abstract classes for input devices implementation.
  ******************************************************************************/
 
+/*
+ * Optional timestamp callback is called before the events it applies to with
+ * the source time of the events in CLOCK_MONOTONIC microseconds.
+ */
+
 struct KeyboardCallbacks
 {
 	std::function<void(uint32_t key, uint32_t state)> key;
+	std::function<void(uint64_t timeUs)> timestamp;
 };
 
 struct PointerCallbacks
@@ -41,6 +47,8 @@ struct PointerCallbacks
 	std::function<void(int32_t x, int32_t y, int32_t relZ)> moveRelative;
 	std::function<void(int32_t x, int32_t y, int32_t relZ)> moveAbsolute;
 	std::function<void(uint32_t button, uint32_t state)> button;
+	std::function<void()> frame;
+	std::function<void(uint64_t timeUs)> timestamp;
 };
 
 struct TouchCallbacks
@@ -49,6 +57,7 @@ struct TouchCallbacks
 	std::function<void(int32_t id)> up;
 	std::function<void(int32_t id, int32_t x, int32_t y)> motion;
 	std::function<void(int32_t id)> frame;
+	std::function<void(uint64_t timeUs)> timestamp;
 };
 
 template<typename T>
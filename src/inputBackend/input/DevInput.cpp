@@ -12,15 +12,16 @@
 #include <xen/be/Exception.hpp>
 
 #include "DevInput.hpp"
+#include "DevInputReactor.hpp"
+#include "DevInputRegistry.hpp"
 
 using std::lock_guard;
 using std::mutex;
 using std::setfill;
 using std::setw;
 using std::string;
-using std::thread;
 
-using XenBackend::PollFd;
+using namespace std::placeholders;
 
 using InputItf::KeyboardCallbacks;
 using InputItf::PointerCallbacks;
@@ -55,22 +56,15 @@ DevInputBase::~DevInputBase()
 
 void DevInputBase::start()
 {
-	if (!mThread.joinable())
-	{
-		mThread = thread(&DevInputBase::run, this);
-	}
+	DevInputReactor::getInstance().addDevice(
+			mFd, bind(&DevInputBase::onEvents, this, _1, _2));
 }
 
 void DevInputBase::stop()
 {
-	if (mPollFd)
-	{
-		mPollFd->stop();
-	}
-
-	if (mThread.joinable())
+	if (mFd >= 0)
 	{
-		mThread.join();
+		DevInputReactor::getInstance().removeDevice(mFd);
 	}
 }
 
@@ -85,7 +79,7 @@ void DevInputBase::init()
 		return ioctl(mFd, EVIOCGRAB, &value);
 	};
 
-	mFd = open(mName.c_str(), O_RDONLY);
+	mFd = open(mName.c_str(), O_RDONLY | O_NONBLOCK);
 
 	if (mFd < 0)
 	{
@@ -99,7 +93,13 @@ void DevInputBase::init()
 
 	ioctl_call(0);
 
-	mPollFd.reset(new PollFd(mFd, POLLIN));
+	// timestamps are compared with the monotonic clock by latency metrics
+	int clockId = CLOCK_MONOTONIC;
+
+	if (ioctl(mFd, EVIOCSCLOCKID, &clockId) < 0)
+	{
+		LOG(mLog, WARNING) << "Can't set monotonic clock: " << mName;
+	}
 
 	LOG(mLog, DEBUG) << "Create: " << mName;
 }
@@ -114,33 +114,29 @@ void DevInputBase::release()
 	}
 }
 
-void DevInputBase::run()
+void DevInputBase::onEvents(const input_event* events, size_t num)
 {
-	try
+	for(size_t i = 0; i < num; i++)
 	{
-		while(mPollFd->poll())
-		{
-			int readSize = 0;
-
-			input_event events[64];
+		onEvent(events[i]);
+	}
+}
 
-			readSize = read(mFd, events, sizeof(events));
+uint64_t DevInputBase::getEventTimeUs(const input_event& event)
+{
+#ifdef input_event_sec
+	return event.input_event_sec * 1000000ull + event.input_event_usec;
+#else
+	return event.time.tv_sec * 1000000ull + event.time.tv_usec;
+#endif
+}
 
-			if (readSize < static_cast<int>(sizeof(struct input_event)))
-			{
-				throw XenBackend::Exception("Read error", errno);
-			}
+bool DevInputBase::isRouted(domid_t domId)
+{
+	auto& registry = DevInputRegistry::getInstance();
 
-			for(size_t i = 0; i < readSize/sizeof(input_event); i++)
-			{
-				onEvent(events[i]);
-			}
-		}
-	}
-	catch(const std::exception& e)
-	{
-		LOG(mLog, ERROR) << e.what();
-	}
+	return domId == DOMID_INVALID || !registry.isFocusRouting() ||
+		   registry.getFocus() == domId;
 }
 
 /*******************************************************************************
@@ -158,14 +154,40 @@ DevInput<KeyboardCallbacks>::~DevInput()
 
 void DevInput<KeyboardCallbacks>::onEvent(const input_event& event)
 {
+	if (event.type != EV_KEY)
+	{
+		return;
+	}
+
+	// scroll lock switches the focus between guests of shared devices, the
+	// registry is locked without the device lock held
+	if (event.code == KEY_SCROLLLOCK &&
+		DevInputRegistry::getInstance().isFocusRouting())
+	{
+		{
+			lock_guard<mutex> lock(mMutex);
+
+			notifyTime(event);
+		}
+
+		if (event.value == 1)
+		{
+			DevInputRegistry::getInstance().switchFocus();
+		}
+
+		return;
+	}
+
 	lock_guard<mutex> lock(mMutex);
 
-	if (event.type == EV_KEY && mCallbacks.key)
+	notifyTime(event);
+
+	if (hasCallback(&KeyboardCallbacks::key))
 	{
 		LOG(mLog, DEBUG) << mName << ", key: " << event.code
 						 << ", value: " << event.value;
 
-		mCallbacks.key(event.code, event.value);
+		notify(&KeyboardCallbacks::key, event.code, event.value);
 	}
 }
 
@@ -253,12 +275,14 @@ void DevInput<PointerCallbacks>::onKeyEvent(const input_event& event)
 {
 	lock_guard<mutex> lock(mMutex);
 
-	if (mCallbacks.button)
+	notifyTime(event);
+
+	if (hasCallback(&PointerCallbacks::button))
 	{
 		LOG(mLog, DEBUG) << mName << ", key: " << event.code
 						 << ", value: " << event.value;
 
-		mCallbacks.button(event.code, event.value);
+		notify(&PointerCallbacks::button, event.code, event.value);
 	}
 }
 
@@ -266,48 +290,53 @@ void DevInput<PointerCallbacks>::onSynEvent(const input_event& event)
 {
 	lock_guard<mutex> lock(mMutex);
 
-	if ((mSendRel || mSendWheel) && mCallbacks.moveRelative)
+	notifyTime(event);
+
+	if ((mSendRel || mSendWheel) &&
+		hasCallback(&PointerCallbacks::moveRelative))
 	{
 		LOG(mLog, DEBUG) << mName
 						 << ", rel x: " << mRelX
 						 << ", rel y: " << mRelY
 						 << ", rel z: " << mRelZ;
 
-		mCallbacks.moveRelative(mRelX, mRelY, mRelZ);
+		notify(&PointerCallbacks::moveRelative, mRelX, mRelY, mRelZ);
 
 		mRelX = mRelY = mRelZ = 0;
 		mSendWheel = false;
 		mSendRel = false;
 	}
 
-	if (mSendAbs && mCallbacks.moveAbsolute)
+	if (mSendAbs && hasCallback(&PointerCallbacks::moveAbsolute))
 	{
 		LOG(mLog, DEBUG) << mName
 						 << ", abs x: " << mAbsX
 						 << ", abs y: " << mAbsY
 						 << ", rel z: " << mRelZ;
 
-		mCallbacks.moveAbsolute(mAbsX, mAbsY, mRelZ);
+		notify(&PointerCallbacks::moveAbsolute, mAbsX, mAbsY, mRelZ);
 
 		mRelZ = 0;
 		mSendWheel = false;
 		mSendAbs = false;
 	}
+
+	notify(&PointerCallbacks::frame);
 }
 
 /*******************************************************************************
  * InputTouch
  ******************************************************************************/
 
-DevInput<TouchCallbacks>::DevInput(const string& name) : DevInputCbk(name)
+DevInput<TouchCallbacks>::DevInput(const string& name) :
+	DevInputCbk(name),
+	mContacts(),
+	mCurrentSlot(0),
+	mMultiTouch(false),
+	mTypeA(false),
+	mMtReportData(false),
+	mNumMtReports(0)
 {
-	mKey = 0;
-	mSendAbs = mSendKey = mMtReport = false;
-	mLastMtReports = 0;
-
-	setCurrentSlot(0);
-	mContacts[mCurrentSlot].id = -1;
-
 	start();
 }
 
@@ -318,6 +347,10 @@ DevInput<TouchCallbacks>::~DevInput()
 
 void DevInput<TouchCallbacks>::onEvent(const input_event& event)
 {
+	lock_guard<mutex> lock(mMutex);
+
+	notifyTime(event);
+
 	switch(event.type)
 	{
 		case EV_ABS:
@@ -337,50 +370,67 @@ void DevInput<TouchCallbacks>::onEvent(const input_event& event)
 	}
 }
 
-void DevInput<TouchCallbacks>::setCurrentSlot(uint32_t slot)
+DevInput<TouchCallbacks>::Contact* DevInput<TouchCallbacks>::getCurrentContact()
 {
-	if (slot >= mContacts.size())
+	if (mCurrentSlot >= cMaxContacts)
 	{
-		mContacts.resize(slot + 1, {-1});
+		return nullptr;
 	}
 
-	mCurrentSlot = slot;
+	return &mContacts[mCurrentSlot];
 }
 
 void DevInput<TouchCallbacks>::onAbsEvent(const input_event& event)
 {
+	if (event.code >= ABS_MT_SLOT)
+	{
+		mMultiTouch = true;
+	}
+
+	if (event.code == ABS_MT_SLOT)
+	{
+		mCurrentSlot = event.value;
+
+		return;
+	}
+
+	// single touch emulation of multi touch devices
+	if ((event.code == ABS_X || event.code == ABS_Y) && mMultiTouch)
+	{
+		return;
+	}
+
+	auto contact = getCurrentContact();
+
+	if (!contact)
+	{
+		return;
+	}
+
 	switch(event.code)
 	{
 		case ABS_X:
 		case ABS_MT_POSITION_X:
-			mContacts[mCurrentSlot].absX = event.value;
-			mSendAbs = true;
+			contact->moved |= contact->absX != event.value;
+			contact->absX = event.value;
+			mMtReportData = true;
 			break;
 
 		case ABS_Y:
 		case ABS_MT_POSITION_Y:
-			mContacts[mCurrentSlot].absY = event.value;
-			mSendAbs = true;
-			break;
-
-		case ABS_MT_SLOT:
-			flushEvents();
-			setCurrentSlot(event.value);
+			contact->moved |= contact->absY != event.value;
+			contact->absY = event.value;
+			mMtReportData = true;
 			break;
 
 		case ABS_MT_TRACKING_ID:
 			if (event.value >= 0)
 			{
-				mContacts[mCurrentSlot].id = event.value;
-				mKey = 1;
-				mSendKey = true;
+				contact->down = true;
 			}
 			else
 			{
-				mKey = 0;
-				mSendKey = true;
-
-				flushEvents();
+				contact->up = true;
 			}
 			break;
 	}
@@ -388,108 +438,136 @@ void DevInput<TouchCallbacks>::onAbsEvent(const input_event& event)
 
 void DevInput<TouchCallbacks>::onKeyEvent(const input_event& event)
 {
-	mKey = event.value;
-	mSendKey = true;
+	if (event.code != BTN_TOUCH || mMultiTouch)
+	{
+		return;
+	}
+
+	auto& contact = mContacts[0];
+
+	if (event.value)
+	{
+		contact.down = true;
+	}
+	else
+	{
+		contact.up = true;
+	}
 }
 
 void DevInput<TouchCallbacks>::onSynEvent(const input_event& event)
 {
 	if (event.code == SYN_MT_REPORT)
 	{
-		int32_t nextSlot = mCurrentSlot;
-
-		if (mSendAbs)
-		{
-			nextSlot = mCurrentSlot + 1;
-		}
-
-		if (mContacts[mCurrentSlot].id == -1)
-		{
-			mKey = 1;
-			mSendKey = true;
-		}
-
-		flushEvents();
-
-		setCurrentSlot(nextSlot);
-
-		mMtReport = true;
+		onMtReport();
 	}
 
 	if (event.code == SYN_REPORT)
 	{
-		if (mMtReport)
+		if (mTypeA)
 		{
-			for(int32_t i = mCurrentSlot; i < mLastMtReports; i++)
+			// contacts not reported in the frame are released
+			for (auto& contact : mContacts)
 			{
-				setCurrentSlot(i);
-				mKey = 0;
-				mSendKey = true;
+				if (contact.active && !contact.reported)
+				{
+					contact.up = true;
+				}
 
-				flushEvents();
+				contact.reported = false;
 			}
 
-			mLastMtReports = mCurrentSlot;
-
-			setCurrentSlot(0);
-			mMtReport = false;
+			mNumMtReports = 0;
+			mCurrentSlot = 0;
 		}
 
-		lock_guard<mutex> lock(mMutex);
+		flushContacts();
+	}
+}
 
-		flushEvents();
+void DevInput<TouchCallbacks>::onMtReport()
+{
+	mTypeA = true;
+	mMultiTouch = true;
 
-		if (mCallbacks.frame)
-		{
-			LOG(mLog, DEBUG) << mName << ", frame";
+	auto contact = getCurrentContact();
+
+	// empty report means no contacts
+	if (contact && mMtReportData)
+	{
+		contact->reported = true;
 
-			mCallbacks.frame(mCurrentSlot);
+		if (!contact->active)
+		{
+			contact->down = true;
 		}
 	}
+
+	mMtReportData = false;
+	mCurrentSlot = ++mNumMtReports;
 }
 
-void DevInput<TouchCallbacks>::flushEvents()
+void DevInput<TouchCallbacks>::flushContacts()
 {
-	if (mSendKey)
+	bool changed = false;
+
+	for (uint32_t id = 0; id < cMaxContacts; id++)
 	{
-		if ((mKey == 1) && mCallbacks.down)
+		auto& contact = mContacts[id];
+
+		if (!contact.down && !contact.up && !contact.moved)
+		{
+			continue;
+		}
+
+		// released and pressed again within the frame
+		if (contact.active && contact.up && contact.down)
+		{
+			notify(&TouchCallbacks::up, id);
+			contact.active = false;
+			contact.up = false;
+			changed = true;
+		}
+
+		if (contact.down && !contact.active)
 		{
 			LOG(mLog, DEBUG) << mName << ", down"
-							 << ", id: " << mCurrentSlot
-							 << ", abs x: " << mContacts[mCurrentSlot].absX
-							 << ", abs y: " << mContacts[mCurrentSlot].absY;
+							 << ", id: " << id
+							 << ", abs x: " << contact.absX
+							 << ", abs y: " << contact.absY;
 
-			mCallbacks.down(mCurrentSlot,
-							mContacts[mCurrentSlot].absX,
-							mContacts[mCurrentSlot].absY);
+			notify(&TouchCallbacks::down, id, contact.absX, contact.absY);
+			contact.active = true;
+			changed = true;
+		}
+		else if (contact.moved && contact.active)
+		{
+			LOG(mLog, DEBUG) << mName << ", motion"
+							 << ", id: " << id
+							 << ", abs x: " << contact.absX
+							 << ", abs y: " << contact.absY;
 
-			mSendAbs = false;
+			notify(&TouchCallbacks::motion, id, contact.absX, contact.absY);
+			changed = true;
 		}
 
-		if ((mKey == 0) && mCallbacks.up)
+		if (contact.up && contact.active)
 		{
 			LOG(mLog, DEBUG) << mName << ", up"
-							 << ", id: " << mCurrentSlot;
+							 << ", id: " << id;
 
-			mCallbacks.up(mCurrentSlot);
-
-			mContacts[mCurrentSlot].id = -1;
+			notify(&TouchCallbacks::up, id);
+			contact.active = false;
+			changed = true;
 		}
 
-		mSendKey = false;
+		contact.down = contact.up = contact.moved = false;
 	}
 
-	if (mSendAbs && mCallbacks.motion)
+	if (changed)
 	{
-		LOG(mLog, DEBUG) << mName << ", motion"
-						 << ", id: " << mCurrentSlot
-						 << ", abs x: " << mContacts[mCurrentSlot].absX
-						 << ", abs y: " << mContacts[mCurrentSlot].absY;
-
-		mSendAbs = false;
+		LOG(mLog, DEBUG) << mName << ", frame";
 
-		mCallbacks.motion(mCurrentSlot,
-						  mContacts[mCurrentSlot].absX,
-						  mContacts[mCurrentSlot].absY);
+		notify(&TouchCallbacks::frame, mCurrentSlot);
 	}
 }
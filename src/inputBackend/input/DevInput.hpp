@@ -8,11 +8,17 @@
 #ifndef SRC_INPUT_DEVINPUT_HPP_
 #define SRC_INPUT_DEVINPUT_HPP_
 
+#include <array>
+#include <map>
+#include <mutex>
 #include <string>
-#include <thread>
 
 #include <linux/input.h>
 
+extern "C" {
+#include <xenctrl.h>
+}
+
 #include <xen/be/Log.hpp>
 #include <xen/be/Utils.hpp>
 
@@ -37,20 +43,26 @@ protected:
 
 	virtual void onEvent(const input_event& event) = 0;
 
-private:
+	/**
+	 * Checks if events shall be delivered to the domain according to the
+	 * focus routing of shared devices
+	 * @param domId domain id, DOMID_INVALID receives all events
+	 */
+	static bool isRouted(domid_t domId);
 
-	const int cPoolEventTimeoutMs = 100;
+	/**
+	 * Returns event time in microseconds
+	 */
+	static uint64_t getEventTimeUs(const input_event& event);
 
-	int mFd;
-
-	std::thread mThread;
+private:
 
-	std::unique_ptr<XenBackend::PollFd> mPollFd;
+	int mFd;
 
 	void init();
 	void release();
 
-	void run();
+	void onEvents(const input_event* events, size_t num);
 };
 
 template <typename T>
@@ -58,20 +70,104 @@ class DevInputCbk : public DevInputBase, public InputItf::InputDevice<T>
 {
 public:
 
-	DevInputCbk(const std::string& name) : DevInputBase(name) {}
+	DevInputCbk(const std::string& name) :
+		DevInputBase(name), mLastTimeUs(0) {}
 
 	void setCallbacks(const T& callbacks) override
+	{
+		subscribe(this, DOMID_INVALID, callbacks);
+	}
+
+	/**
+	 * Adds or updates subscriber of the device events
+	 * @param subscriber subscriber handle
+	 * @param domId      subscriber domain id
+	 * @param callbacks  subscriber callbacks
+	 */
+	void subscribe(const void* subscriber, domid_t domId, const T& callbacks)
 	{
 		std::lock_guard<std::mutex> lock(mMutex);
 
-		mCallbacks = callbacks;
+		mSubscribers[subscriber] = {domId, callbacks};
 	}
 
-protected:
+	/**
+	 * Removes subscriber of the device events
+	 * @param subscriber subscriber handle
+	 */
+	void unsubscribe(const void* subscriber)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
 
-	T mCallbacks;
+		mSubscribers.erase(subscriber);
+	}
+
+protected:
 
 	std::mutex mMutex;
+
+	/**
+	 * Checks if any subscriber has the callback. Shall be called with
+	 * mMutex locked.
+	 */
+	template<typename F>
+	bool hasCallback(F T::*callback)
+	{
+		for (auto& it : mSubscribers)
+		{
+			if (it.second.callbacks.*callback)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	 * Notifies subscribers about the time of the following events when it
+	 * changes. Shall be called with mMutex locked.
+	 */
+	void notifyTime(const input_event& event)
+	{
+		auto timeUs = getEventTimeUs(event);
+
+		if (timeUs != mLastTimeUs)
+		{
+			mLastTimeUs = timeUs;
+
+			notify(&T::timestamp, timeUs);
+		}
+	}
+
+	/**
+	 * Calls the callback of routed subscribers. Shall be called with mMutex
+	 * locked.
+	 */
+	template<typename F, typename... Args>
+	void notify(F T::*callback, Args... args)
+	{
+		for (auto& it : mSubscribers)
+		{
+			auto& subscriber = it.second;
+
+			if (subscriber.callbacks.*callback && isRouted(subscriber.domId))
+			{
+				(subscriber.callbacks.*callback)(args...);
+			}
+		}
+	}
+
+private:
+
+	struct Subscriber
+	{
+		domid_t domId;
+		T callbacks;
+	};
+
+	std::map<const void*, Subscriber> mSubscribers;
+	uint64_t mLastTimeUs;
 };
 
 template <typename T>
@@ -131,26 +227,38 @@ public:
 
 private:
 
+	static const uint32_t cMaxContacts = 16;
+
 	struct Contact
 	{
-		int32_t id;
 		int32_t absX;
 		int32_t absY;
+		// down is reported to the subscribers
+		bool active;
+		// changes of the current frame
+		bool down;
+		bool up;
+		bool moved;
+		// reported with SYN_MT_REPORT in the current frame
+		bool reported;
 	};
 
-	int32_t mKey;
-	bool mSendAbs, mSendKey;
-	bool mMtReport;
-	int32_t mLastMtReports;
-
+	std::array<Contact, cMaxContacts> mContacts;
 	uint32_t mCurrentSlot;
-	std::vector<Contact> mContacts;
 
-	void setCurrentSlot(uint32_t slot);
+	// device sends ABS_MT_* events, ABS_X/ABS_Y and BTN_TOUCH are ignored
+	bool mMultiTouch;
+	// device uses type A protocol with anonymous contacts
+	bool mTypeA;
+	bool mMtReportData;
+	uint32_t mNumMtReports;
+
+	Contact* getCurrentContact();
 	void onAbsEvent(const input_event& event);
 	void onKeyEvent(const input_event& event);
 	void onSynEvent(const input_event& event);
-	void flushEvents();
+	void onMtReport();
+	void flushContacts();
 };
 
 #endif /* SRC_INPUT_DEVINPUT_HPP_ */
@@ -0,0 +1,303 @@
+/*
+ *  Dev input reactor
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "DevInputReactor.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <xen/be/Exception.hpp>
+
+using std::lock_guard;
+using std::mutex;
+using std::thread;
+using std::unique_lock;
+
+/*******************************************************************************
+ * DevInputReactor
+ ******************************************************************************/
+
+DevInputReactor::DevInputReactor() :
+	mLog("DevInputReactor"),
+	mEpollFd(-1),
+	mEventFd(-1),
+	mTerminate(false),
+	mRunningFd(-1),
+	mWakeups(Metrics::Collector::getInstance().getCounter(
+			"input.reactor_wakeups")),
+	mReads(Metrics::Collector::getInstance().getCounter(
+			"input.reactor_reads"))
+{
+	try
+	{
+		init();
+	}
+	catch(const std::exception& e)
+	{
+		release();
+
+		throw;
+	}
+}
+
+DevInputReactor::~DevInputReactor()
+{
+	{
+		lock_guard<mutex> lock(mMutex);
+
+		mTerminate = true;
+	}
+
+	uint64_t value = 1;
+
+	if (write(mEventFd, &value, sizeof(value)) != sizeof(value))
+	{
+		LOG(mLog, ERROR) << "Can't wake up reactor";
+	}
+
+	if (mThread.joinable())
+	{
+		mThread.join();
+	}
+
+	release();
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+DevInputReactor& DevInputReactor::getInstance()
+{
+	static DevInputReactor sInstance;
+
+	return sInstance;
+}
+
+void DevInputReactor::addDevice(int fd, Callback callback)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	if (mDevices.find(fd) != mDevices.end())
+	{
+		mDevices[fd] = callback;
+
+		return;
+	}
+
+	epoll_event event {};
+
+	event.events = EPOLLIN;
+	event.data.fd = fd;
+
+	if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+	{
+		throw XenBackend::Exception("Can't add device to epoll", errno);
+	}
+
+	mDevices[fd] = callback;
+
+	LOG(mLog, DEBUG) << "Add device, fd: " << fd
+					 << ", devices: " << mDevices.size();
+}
+
+void DevInputReactor::removeDevice(int fd)
+{
+	unique_lock<mutex> lock(mMutex);
+
+	// the reactor dispatches without the lock, wait for the running device
+	// callback unless the device is removed from it
+	while (mRunningFd == fd && std::this_thread::get_id() != mThread.get_id())
+	{
+		mCondVar.wait(lock);
+	}
+
+	auto it = mDevices.find(fd);
+
+	if (it == mDevices.end())
+	{
+		return;
+	}
+
+	epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+
+	mDevices.erase(it);
+
+	LOG(mLog, DEBUG) << "Remove device, fd: " << fd
+					 << ", devices: " << mDevices.size();
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void DevInputReactor::init()
+{
+	mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (mEpollFd < 0)
+	{
+		throw XenBackend::Exception("Can't create epoll", errno);
+	}
+
+	mEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+	if (mEventFd < 0)
+	{
+		throw XenBackend::Exception("Can't create event fd", errno);
+	}
+
+	epoll_event event {};
+
+	event.events = EPOLLIN;
+	event.data.fd = mEventFd;
+
+	if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mEventFd, &event) < 0)
+	{
+		throw XenBackend::Exception("Can't add event fd to epoll", errno);
+	}
+
+	mThread = thread(&DevInputReactor::run, this);
+}
+
+void DevInputReactor::release()
+{
+	if (mEventFd >= 0)
+	{
+		close(mEventFd);
+	}
+
+	if (mEpollFd >= 0)
+	{
+		close(mEpollFd);
+	}
+}
+
+void DevInputReactor::run()
+{
+	epoll_event events[cMaxEpollEvents];
+
+	while(true)
+	{
+		auto num = epoll_wait(mEpollFd, events, cMaxEpollEvents, -1);
+
+		if (num < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			LOG(mLog, ERROR) << "Epoll wait error: " << errno;
+
+			return;
+		}
+
+		unique_lock<mutex> lock(mMutex);
+
+		if (mTerminate)
+		{
+			return;
+		}
+
+		mWakeups.add();
+
+		for (int i = 0; i < num; i++)
+		{
+			auto fd = events[i].data.fd;
+			auto it = mDevices.find(fd);
+
+			// event fd or the device removed while we were waiting
+			if (it == mDevices.end())
+			{
+				continue;
+			}
+
+			auto callback = it->second;
+
+			// callbacks take device and registry locks, dispatch without
+			// the reactor lock to not order it before them
+			mRunningFd = fd;
+
+			lock.unlock();
+
+			auto result = readDevice(fd, callback);
+
+			lock.lock();
+
+			mRunningFd = -1;
+
+			mCondVar.notify_all();
+
+			it = mDevices.find(fd);
+
+			if (!result && it != mDevices.end())
+			{
+				epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+
+				mDevices.erase(it);
+			}
+		}
+	}
+}
+
+bool DevInputReactor::readDevice(int fd, const Callback& callback)
+{
+	input_event events[cMaxReadEvents];
+
+	try
+	{
+		// read a few times to drain event storms, but let other devices
+		// be served as well
+		for (int i = 0; i < cMaxReadsPerWakeup; i++)
+		{
+			auto readSize = read(fd, events, sizeof(events));
+
+			if (readSize < 0 && (errno == EAGAIN || errno == EINTR))
+			{
+				return true;
+			}
+
+			if (readSize < static_cast<int>(sizeof(input_event)))
+			{
+				throw XenBackend::Exception("Read error", errno);
+			}
+
+			mReads.add();
+
+			callback(events, readSize / sizeof(input_event));
+
+			if (readSize < static_cast<int>(sizeof(events)))
+			{
+				return true;
+			}
+		}
+	}
+	catch(const std::exception& e)
+	{
+		LOG(mLog, ERROR) << "Device fd: " << fd << ", " << e.what();
+
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,102 @@
+/*
+ *  Dev input reactor
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_INPUT_DEVINPUTREACTOR_HPP_
+#define SRC_INPUT_DEVINPUTREACTOR_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <linux/input.h>
+
+#include <xen/be/Log.hpp>
+
+#include "Metrics.hpp"
+
+/***************************************************************************//**
+ * Single thread epoll reactor which reads all opened /dev/input devices and
+ * dispatches events to the device callbacks.
+ ******************************************************************************/
+class DevInputReactor
+{
+public:
+
+	/**
+	 * Callback which receives events read from a device at once
+	 */
+	typedef std::function<void(const input_event* events, size_t num)>
+			Callback;
+
+	/**
+	 * Returns reactor instance
+	 */
+	static DevInputReactor& getInstance();
+
+	/**
+	 * Starts reading the device
+	 * @param fd       non blocking device file descriptor
+	 * @param callback events callback
+	 */
+	void addDevice(int fd, Callback callback);
+
+	/**
+	 * Stops reading the device. The device callback is not called after
+	 * this function returns.
+	 * @param fd device file descriptor
+	 */
+	void removeDevice(int fd);
+
+private:
+
+	static const int cMaxEpollEvents = 16;
+	static const int cMaxReadEvents = 64;
+	static const int cMaxReadsPerWakeup = 4;
+
+	DevInputReactor();
+	~DevInputReactor();
+
+	XenBackend::Log mLog;
+
+	int mEpollFd;
+	int mEventFd;
+	bool mTerminate;
+	int mRunningFd;
+
+	std::map<int, Callback> mDevices;
+
+	Metrics::Counter& mWakeups;
+	Metrics::Counter& mReads;
+
+	std::mutex mMutex;
+	std::condition_variable mCondVar;
+	std::thread mThread;
+
+	void init();
+	void release();
+
+	void run();
+	bool readDevice(int fd, const Callback& callback);
+};
+
+#endif /* SRC_INPUT_DEVINPUTREACTOR_HPP_ */
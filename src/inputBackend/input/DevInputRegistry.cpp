@@ -0,0 +1,124 @@
+/*
+ *  Dev input registry
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include "DevInputRegistry.hpp"
+
+using std::lock_guard;
+using std::mutex;
+
+/*******************************************************************************
+ * DevInputRegistry
+ ******************************************************************************/
+
+DevInputRegistry::DevInputRegistry() :
+	mLog("DevInputRegistry"),
+	mFocusRouting(false),
+	mFocus(DOMID_INVALID)
+{
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+DevInputRegistry& DevInputRegistry::getInstance()
+{
+	static DevInputRegistry sInstance;
+
+	return sInstance;
+}
+
+void DevInputRegistry::switchFocus()
+{
+	lock_guard<mutex> lock(mMutex);
+
+	if (mDomains.empty())
+	{
+		return;
+	}
+
+	auto it = mDomains.upper_bound(mFocus);
+
+	if (it == mDomains.end())
+	{
+		it = mDomains.begin();
+	}
+
+	mFocus = it->first;
+
+	LOG(mLog, INFO) << "Focus dom: " << mFocus;
+}
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+void DevInputRegistry::addDomain(domid_t domId)
+{
+	mDomains[domId]++;
+
+	if (mDomains.find(mFocus) == mDomains.end())
+	{
+		mFocus = domId;
+
+		LOG(mLog, DEBUG) << "Focus dom: " << mFocus;
+	}
+}
+
+void DevInputRegistry::removeDomain(domid_t domId)
+{
+	lock_guard<mutex> lock(mMutex);
+
+	removeExpiredDevices();
+
+	auto it = mDomains.find(domId);
+
+	if (it == mDomains.end() || --it->second)
+	{
+		return;
+	}
+
+	mDomains.erase(it);
+
+	if (mFocus == domId)
+	{
+		mFocus = mDomains.empty() ? DOMID_INVALID : mDomains.begin()->first;
+
+		LOG(mLog, DEBUG) << "Focus dom: " << mFocus;
+	}
+}
+
+void DevInputRegistry::removeExpiredDevices()
+{
+	for (auto it = mDevices.begin(); it != mDevices.end();)
+	{
+		if (it->second.expired())
+		{
+			LOG(mLog, DEBUG) << "Close device: " << it->first.first;
+
+			it = mDevices.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
@@ -0,0 +1,187 @@
+/*
+ *  Dev input registry
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#ifndef SRC_INPUT_DEVINPUTREGISTRY_HPP_
+#define SRC_INPUT_DEVINPUTREGISTRY_HPP_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+
+#include <xen/be/Log.hpp>
+
+#include "DevInput.hpp"
+
+/***************************************************************************//**
+ * Registry of opened /dev/input devices. Each device node is opened and
+ * decoded once and its events are delivered to all guests subscribed to it.
+ *
+ * In focus routing mode events of the devices are delivered only to the
+ * focused guest. Scroll Lock on any device keyboard switches the focus to the
+ * next guest.
+ ******************************************************************************/
+class DevInputRegistry
+{
+public:
+
+	/**
+	 * Returns registry instance
+	 */
+	static DevInputRegistry& getInstance();
+
+	/**
+	 * Returns device subscription for the guest. The device is opened on
+	 * first subscription and closed when the last one is released.
+	 * @param path  device node path
+	 * @param domId guest domain id
+	 */
+	template<typename T>
+	std::shared_ptr<InputItf::InputDevice<T>> getDevice(const std::string& path,
+														domid_t domId);
+
+	/**
+	 * Enables or disables focus routing
+	 */
+	void setFocusRouting(bool enable) { mFocusRouting = enable; }
+
+	/**
+	 * Checks if focus routing is enabled
+	 */
+	bool isFocusRouting() const { return mFocusRouting; }
+
+	/**
+	 * Returns focused domain
+	 */
+	domid_t getFocus() const { return mFocus; }
+
+	/**
+	 * Moves the focus to the next subscribed domain
+	 */
+	void switchFocus();
+
+private:
+
+	template<typename T>
+	class Subscription : public InputItf::InputDevice<T>
+	{
+	public:
+
+		Subscription(std::shared_ptr<DevInput<T>> device, domid_t domId) :
+			mDevice(device), mDomId(domId) {}
+
+		~Subscription()
+		{
+			mDevice->unsubscribe(this);
+
+			// the last subscription closes the device before its registry
+			// entry is erased
+			mDevice.reset();
+
+			DevInputRegistry::getInstance().removeDomain(mDomId);
+		}
+
+		void setCallbacks(const T& callbacks) override
+		{
+			mDevice->subscribe(this, mDomId, callbacks);
+		}
+
+	private:
+
+		std::shared_ptr<DevInput<T>> mDevice;
+		domid_t mDomId;
+	};
+
+	DevInputRegistry();
+
+	XenBackend::Log mLog;
+
+	std::atomic_bool mFocusRouting;
+	std::atomic<domid_t> mFocus;
+
+	std::mutex mMutex;
+	// the same node may be opened as devices of different types
+	typedef std::pair<std::string, std::type_index> DeviceKey;
+
+	std::map<DeviceKey, std::weak_ptr<DevInputBase>> mDevices;
+	std::map<domid_t, int> mDomains;
+
+	// shall be called with mMutex locked
+	void addDomain(domid_t domId);
+
+	void removeDomain(domid_t domId);
+	// shall be called with mMutex locked
+	void removeExpiredDevices();
+};
+
+template<typename T>
+std::shared_ptr<InputItf::InputDevice<T>>
+DevInputRegistry::getDevice(const std::string& path, domid_t domId)
+{
+	DeviceKey key(path, std::type_index(typeid(T)));
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto device = std::dynamic_pointer_cast<DevInput<T>>(
+				mDevices[key].lock());
+
+		if (device)
+		{
+			LOG(mLog, DEBUG) << "Share device: " << path << ", dom: " << domId;
+
+			addDomain(domId);
+
+			return std::make_shared<Subscription<T>>(device, domId);
+		}
+	}
+
+	// the device is opened and started without the registry lock: its events
+	// are dispatched under the device lock which may lock the registry
+	auto newDevice = std::make_shared<DevInput<T>>(path);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto device = std::dynamic_pointer_cast<DevInput<T>>(
+			mDevices[key].lock());
+
+	if (!device)
+	{
+		device = newDevice;
+
+		mDevices[key] = device;
+
+		LOG(mLog, DEBUG) << "Open device: " << path;
+	}
+	else
+	{
+		LOG(mLog, DEBUG) << "Share device: " << path << ", dom: " << domId;
+	}
+
+	addDomain(domId);
+
+	return std::make_shared<Subscription<T>>(device, domId);
+}
+
+#endif /* SRC_INPUT_DEVINPUTREGISTRY_HPP_ */
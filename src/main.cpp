@@ -23,9 +23,14 @@
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <thread>
 
+#include <cctype>
+#include <cerrno>
 #include <csignal>
+#include <cstdio>
+#include <cstdlib>
 #include <execinfo.h>
 #include <getopt.h>
 #include <unistd.h>
@@ -40,16 +45,26 @@
 #ifdef WITH_WAYLAND
 #include "wayland/Display.hpp"
 #endif //WITH_WAYLAND
+#ifdef WITH_HEADLESS
+#include "headless/Display.hpp"
+#endif //WITH_HEADLESS
 #endif //WITH_DISPLAY
 
 #ifdef WITH_INPUT
 #include "InputBackend.hpp"
+#include "input/DevInputRegistry.hpp"
 #endif
 
 #ifdef WITH_MOCKBELIB
 #include "MockBackend.hpp"
+#ifdef WITH_DISPLAY
+#include "LoadGenerator.hpp"
+#include "TraceReplayer.hpp"
+#endif
 #endif
 
+#include "Metrics.hpp"
+#include "TimerQueue.hpp"
 #include "Version.hpp"
 
 using std::cout;
@@ -60,6 +75,7 @@ using std::string;
 using std::this_thread::sleep_for;
 using std::toupper;
 using std::transform;
+using std::unique_ptr;
 using std::vector;
 
 using XenBackend::Log;
@@ -68,13 +84,30 @@ using XenBackend::Utils;
 enum class DisplayMode
 {
 	WAYLAND,
-	DRM
+	DRM,
+	HEADLESS
 };
 
 DisplayMode gDisplayMode = DisplayMode::WAYLAND;
 string gDrmDevice = "/dev/dri/card0";
+uint32_t gHeadlessRate = 60;
 string gLogFileName;
 bool gDisableZCopy = false;
+uint32_t gInputCoalesceMs = 0;
+bool gKeyRepeat = false;
+bool gRingPool = false;
+size_t gRingWorkers = 0;
+int gLoadFrontends = 0;
+int gLoadConnectors = 0;
+uint32_t gLoadFps = 60;
+uint32_t gLoadWidth = 800;
+uint32_t gLoadHeight = 600;
+string gTraceFileName;
+uint32_t gTraceSamplePeriod = 0;
+#ifdef WITH_DISPLAY
+CommandLimits gCommandLimits {};
+#endif
+string gReplayFileName;
 
 int gRetStatus = EXIT_SUCCESS;
 
@@ -104,6 +137,17 @@ void registerSignals()
 	act.sa_flags = SA_RESETHAND;
 
 	sigaction(SIGSEGV, &act, nullptr);
+
+	// signals are handled in waitSignals, block them before any thread is
+	// created so they are not delivered to other threads and are kept
+	// pending until the backend is started
+	sigset_t set;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGINT);
+	sigaddset(&set, SIGTERM);
+	sigaddset(&set, SIGUSR1);
+	sigprocmask(SIG_BLOCK, &set, nullptr);
 }
 
 void waitSignals()
@@ -114,24 +158,122 @@ void waitSignals()
 	sigemptyset(&set);
 	sigaddset(&set, SIGINT);
 	sigaddset(&set, SIGTERM);
-	sigprocmask(SIG_BLOCK, &set, nullptr);
+	sigaddset(&set, SIGUSR1);
 
 	sigwait(&set,&signal);
 
+	// SIGUSR1 dumps collected metrics to the log
+	while (signal == SIGUSR1)
+	{
+		Metrics::Collector::getInstance().dump();
+
+		sigwait(&set,&signal);
+	}
+
 	if (signal == SIGTERM)
 	{
 		gRetStatus = EXIT_FAILURE;
 	}
 }
 
+template<typename T>
+bool parseNumber(const string& value, T& result)
+{
+	// the whole value shall be a decimal number in the range of the result,
+	// stoul() throws on garbage and strtoul() accepts signs and suffixes
+	char* end = nullptr;
+
+	errno = 0;
+
+	auto number = strtoull(value.c_str(), &end, 10);
+
+	if (!isdigit(static_cast<unsigned char>(value[0])) || *end != '\0' ||
+		errno || number > std::numeric_limits<T>::max())
+	{
+		return false;
+	}
+
+	result = number;
+
+	return true;
+}
+
+#if defined(WITH_MOCKBELIB) && defined(WITH_DISPLAY)
+// largest simulated buffer side and frame rate
+const uint32_t cMaxLoadSize = 8192;
+const uint32_t cMaxLoadFps = 1000;
+
+template<typename T>
+bool parsePair(const string& value, T& first, T& second)
+{
+	// <first>x<second>
+	auto pos = value.find('x');
+
+	return pos != string::npos &&
+		   parseNumber(value.substr(0, pos), first) &&
+		   parseNumber(value.substr(pos + 1), second);
+}
+
+bool parseLoad(const string& value)
+{
+	// <frontends>x<connectors>[@<fps>][:<width>x<height>]
+	auto pos = value.find(':');
+
+	if (pos != string::npos)
+	{
+		if (!parsePair(value.substr(pos + 1), gLoadWidth, gLoadHeight) ||
+			!gLoadWidth || !gLoadHeight ||
+			gLoadWidth > cMaxLoadSize || gLoadHeight > cMaxLoadSize)
+		{
+			return false;
+		}
+	}
+
+	auto load = value.substr(0, pos);
+
+	pos = load.find('@');
+
+	if (pos != string::npos)
+	{
+		// 0 flips as soon as the previous flip is done
+		if (!parseNumber(load.substr(pos + 1), gLoadFps) ||
+			gLoadFps > cMaxLoadFps)
+		{
+			return false;
+		}
+
+		load.resize(pos);
+	}
+
+	if (!parsePair(load, gLoadFrontends, gLoadConnectors))
+	{
+		return false;
+	}
+
+	return gLoadFrontends > 0 && gLoadConnectors > 0;
+}
+#endif
+
 bool commandLineOptions(int argc, char *argv[])
 {
 	int opt = -1;
+	static const char* optString = "m:d:v:l:fh?"
+#ifdef WITH_DISPLAY
+		"w:t:q:"
+#endif
 #ifdef WITH_ZCOPY
-	static const char* optString = "m:d:v:l:fhz?";
-#else
-	static const char* optString = "m:d:v:l:fh?";
+		"z"
+#endif
+#ifdef WITH_INPUT
+		"c:s"
+#endif
+#if defined(WITH_WAYLAND) && defined(WITH_INPUT)
+		"r"
 #endif
+#if defined(WITH_MOCKBELIB) && defined(WITH_DISPLAY)
+		"g:p:"
+#endif
+		;
 
 	while((opt = getopt(argc, argv, optString)) != -1)
 	{
@@ -152,6 +294,19 @@ bool commandLineOptions(int argc, char *argv[])
 			{
 				gDisplayMode = DisplayMode::WAYLAND;
 			}
+			else if (mode.compare(0, 8, "HEADLESS") == 0)
+			{
+				gDisplayMode = DisplayMode::HEADLESS;
+
+				if (mode.size() > 8)
+				{
+					if (mode[8] != ':' ||
+						!parseNumber(mode.substr(9), gHeadlessRate))
+					{
+						return false;
+					}
+				}
+			}
 			else
 			{
 				return false;
@@ -187,6 +342,82 @@ bool commandLineOptions(int argc, char *argv[])
 
 			break;
 
+#ifdef WITH_DISPLAY
+		case 'w':
+
+			gRingPool = true;
+
+			if (!parseNumber(optarg, gRingWorkers))
+			{
+				return false;
+			}
+
+			break;
+
+		case 't':
+		{
+			// <file>[:<sample period>]
+			string trace = optarg;
+
+			auto pos = trace.rfind(':');
+
+			if (pos != string::npos)
+			{
+				if (!parseNumber(trace.substr(pos + 1), gTraceSamplePeriod))
+				{
+					return false;
+				}
+
+				trace.resize(pos);
+			}
+
+			gTraceFileName = trace;
+
+			break;
+		}
+
+		case 'q':
+		{
+			// <flips per second>[:<dbufs per second>[:<MiB per guest>]]
+			string limits = optarg;
+
+			auto pos = limits.rfind(':');
+
+			if (pos != string::npos && limits.find(':') != pos)
+			{
+				uint64_t quotaMiB = 0;
+
+				if (!parseNumber(limits.substr(pos + 1), quotaMiB) ||
+					quotaMiB > std::numeric_limits<uint64_t>::max() >> 20)
+				{
+					return false;
+				}
+
+				gCommandLimits.bufferQuota = quotaMiB << 20;
+				limits.resize(pos);
+				pos = limits.rfind(':');
+			}
+
+			if (pos != string::npos)
+			{
+				if (!parseNumber(limits.substr(pos + 1),
+								 gCommandLimits.dbufRate))
+				{
+					return false;
+				}
+
+				limits.resize(pos);
+			}
+
+			if (!parseNumber(limits, gCommandLimits.flipRate))
+			{
+				return false;
+			}
+
+			break;
+		}
+#endif
+
 #ifdef WITH_ZCOPY
 		case 'z':
 
@@ -195,6 +426,48 @@ bool commandLineOptions(int argc, char *argv[])
 			break;
 #endif
 
+#ifdef WITH_INPUT
+		case 'c':
+
+			if (!parseNumber(optarg, gInputCoalesceMs))
+			{
+				return false;
+			}
+
+			break;
+
+		case 's':
+
+			DevInputRegistry::getInstance().setFocusRouting(true);
+
+			break;
+#endif
+
+#if defined(WITH_WAYLAND) && defined(WITH_INPUT)
+		case 'r':
+
+			gKeyRepeat = true;
+
+			break;
+#endif
+
+#if defined(WITH_MOCKBELIB) && defined(WITH_DISPLAY)
+		case 'g':
+
+			if (!parseLoad(optarg))
+			{
+				return false;
+			}
+
+			break;
+
+		case 'p':
+
+			gReplayFileName = optarg;
+
+			break;
+#endif
+
 		default:
 
 			return false;
@@ -205,7 +478,7 @@ bool commandLineOptions(int argc, char *argv[])
 }
 
 #ifdef WITH_DISPLAY
-DisplayItf::DisplayPtr getDisplay(DisplayMode mode)
+DisplayItf::DisplayPtr getDisplay(DisplayMode mode, TimerQueuePtr timerQueue)
 {
 	if (mode == DisplayMode::DRM)
 	{
@@ -214,13 +487,23 @@ DisplayItf::DisplayPtr getDisplay(DisplayMode mode)
 		return Drm::DisplayPtr(new Drm::Display(gDrmDevice, gDisableZCopy));
 #else
 		throw XenBackend::Exception("DRM mode is not supported", EINVAL);
+#endif
+	}
+	else if (mode == DisplayMode::HEADLESS)
+	{
+#ifdef WITH_HEADLESS
+		// Headless
+		return Headless::DisplayPtr(new Headless::Display(gHeadlessRate));
+#else
+		throw XenBackend::Exception("HEADLESS mode is not supported", EINVAL);
 #endif
 	}
 	else
 	{
 #ifdef WITH_WAYLAND
 		// Wayland
-		return Wayland::DisplayPtr(new Wayland::Display(gDisableZCopy));
+		return Wayland::DisplayPtr(new Wayland::Display(
+				gDisableZCopy, gKeyRepeat ? timerQueue : nullptr));
 #else
 		throw XenBackend::Exception("WAYLAND mode is not supported", EINVAL);
 #endif
@@ -248,29 +531,95 @@ int main(int argc, char *argv[])
 			}
 
 #ifdef WITH_MOCKBELIB
-			MockBackend mockBackend(0, 1);
+			MockBackend mockBackend(0, 1, std::max(gLoadFrontends, 1),
+									std::max(gLoadConnectors, 1),
+									gLoadWidth, gLoadHeight);
 #endif
 
 #ifdef WITH_DISPLAY
-			auto display = getDisplay(gDisplayMode);
+			// deferred flips, event batches and key repeats share one thread
+			TimerQueuePtr timerQueue(new TimerQueue());
+
+			auto display = getDisplay(gDisplayMode, timerQueue);
+
+			RingWorkerPoolPtr ringPool;
+
+			if (gRingPool)
+			{
+				ringPool.reset(new RingWorkerPool(gRingWorkers));
+			}
+
+			CommandTrace::WriterPtr trace;
+
+			if (!gTraceFileName.empty())
+			{
+				trace.reset(new CommandTrace::Writer(gTraceFileName,
+													 gTraceSamplePeriod));
+			}
 
-			DisplayBackend displayBackend(display, XENDISPL_DRIVER_NAME);
+			DisplayBackend displayBackend(display, XENDISPL_DRIVER_NAME,
+										  ringPool, trace, gCommandLimits,
+										  timerQueue);
 
 			displayBackend.start();
+
+#ifdef WITH_MOCKBELIB
+			unique_ptr<LoadGenerator> loadGenerator;
+
+			if (gLoadFrontends)
+			{
+				loadGenerator.reset(new LoadGenerator(display, 1,
+													  gLoadFrontends,
+													  gLoadConnectors,
+													  gLoadWidth, gLoadHeight,
+													  gLoadFps));
+
+				loadGenerator->start();
+			}
+
+			unique_ptr<TraceReplayer> traceReplayer;
+
+			if (!gReplayFileName.empty())
+			{
+				auto mainThread = pthread_self();
+
+				// the main thread waits for signals, wake it up when done
+				traceReplayer.reset(new TraceReplayer(display, gReplayFileName,
+						[mainThread] { pthread_kill(mainThread, SIGINT); }));
+
+				traceReplayer->start();
+			}
+#endif
 #endif
 
 #ifdef WITH_INPUT
 #ifdef WITH_WAYLAND
 			InputBackend inputBackend("vinput",
-					dynamic_pointer_cast<Wayland::Display>(display));
+					dynamic_pointer_cast<Wayland::Display>(display),
+					gInputCoalesceMs);
 #else
-			InputBackend inputBackend("vinput");
+			InputBackend inputBackend("vinput", gInputCoalesceMs);
 #endif
 			inputBackend.start();
 #endif
 			waitSignals();
 
 #ifdef WITH_DISPLAY
+#ifdef WITH_MOCKBELIB
+			if (loadGenerator)
+			{
+				loadGenerator->stop();
+				loadGenerator->report(cout);
+				loadGenerator.reset();
+			}
+
+			if (traceReplayer)
+			{
+				traceReplayer->stop();
+				traceReplayer->report(cout);
+				traceReplayer.reset();
+			}
+#endif
 			displayBackend.stop();
 #endif
 
@@ -284,9 +633,34 @@ int main(int argc, char *argv[])
 			cout << "Usage: " << argv[0]
 				 << " [-l <file>] [-v <level>]"
 				 << endl;
-			cout << "\t-m -- mode: DRM or WAYLAND" << endl;
+			cout << "\t-m -- mode: DRM, WAYLAND or HEADLESS[:<refresh rate>]"
+				 << endl;
+#ifdef WITH_DISPLAY
+			cout << "\t-w -- serve display rings by a pool of workers,"
+				 << " number of workers, 0 - number of CPUs" << endl;
+			cout << "\t-t -- record display commands: <file>[:<n>],"
+				 << " content of each n-th flipped buffer is recorded" << endl;
+			cout << "\t-q -- limit guest commands per connector:"
+				 << " <flips/s>[:<dbufs/s>[:<buffer MiB per guest>]],"
+				 << " 0 - unlimited" << endl;
+#endif
 #ifdef WITH_ZCOPY
 			cout << "\t-z -- disable zero-copy" << endl;
+#endif
+#ifdef WITH_INPUT
+			cout << "\t-c -- coalesce input motion when guest ring is busy,"
+				 << " latency budget in ms" << endl;
+			cout << "\t-s -- route /dev/input devices to the focused guest,"
+				 << " Scroll Lock switches the focus" << endl;
+#endif
+#if defined(WITH_WAYLAND) && defined(WITH_INPUT)
+			cout << "\t-r -- repeat Wayland keyboard keys on the host" << endl;
+#endif
+#if defined(WITH_MOCKBELIB) && defined(WITH_DISPLAY)
+			cout << "\t-g -- generate load: <frontends>x<connectors>"
+				 << "[@<fps>][:<width>x<height>], report on exit" << endl;
+			cout << "\t-p -- replay recorded display commands from file,"
+				 << " report on exit" << endl;
 #endif
 			cout << "\t-d -- DRM device" << endl;
 			cout << "\t-l -- log file" << endl;
@@ -295,6 +669,7 @@ int main(int argc, char *argv[])
 			cout << "\t      use * for mask selection:"
 				 << " *:Debug,Mod*:Info" << endl;
 			cout << "\t-f -- print file and line in logs" << endl;
+			cout << "\tsend SIGUSR1 to dump metrics to the log" << endl;
 
 			gRetStatus = EXIT_FAILURE;
 		}
@@ -0,0 +1,313 @@
+/*
+ *  Input ring stress test
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Copyright (C) 2020 EPAM Systems Inc.
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "InputBackend.hpp"
+
+using std::atomic_bool;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+using std::chrono::steady_clock;
+using std::cout;
+using std::endl;
+using std::thread;
+using std::vector;
+
+namespace {
+
+const domid_t cDomId = 1;
+const evtchn_port_t cPort = 1;
+
+const int cNumProducers = 4;
+const uint32_t cKeysPerProducer = 500;
+const uint32_t cMotionsPerKey = 50;
+const uint32_t cCoalesceMs = 10;
+
+// frontend which consumes events slower than producers send motions
+const auto cConsumerDelay = microseconds(50);
+const auto cKeyInterval = milliseconds(1);
+const auto cDrainTimeout = seconds(10);
+
+// keys queued while the frontend is stalled, in rings
+const uint32_t cStallRings = 10;
+// BatchRingBufferOut queue limit, in rings
+const uint32_t cMaxQueuedRings = 4;
+
+const uint32_t cRingLen = XENKBD_IN_RING_LEN;
+
+}
+
+/*******************************************************************************
+ * StressRing
+ ******************************************************************************/
+
+/*
+ * Input ring without input devices. The test is the frontend: it reads events
+ * from the ring page directly.
+ */
+class StressRing : public InputRingBuffer
+{
+public:
+
+	StressRing(grant_ref_t ref, uint32_t coalesceMs) :
+		InputRingBuffer(nullptr, nullptr, nullptr, false, false,
+						cDomId, cPort, ref,
+						XENKBD_IN_RING_OFFS, XENKBD_IN_RING_SIZE, nullptr,
+						coalesceMs),
+		mPage(static_cast<xenkbd_page*>(mBuffer.get()))
+	{
+		mPage->in_cons = 0;
+		mPage->in_prod = 0;
+	}
+
+	/*
+	 * Reads published events, consumer delay is applied to each event
+	 */
+	template<typename F>
+	void consume(F&& onEvent, microseconds delay = microseconds(0))
+	{
+		auto prod = mPage->in_prod;
+
+		xen_rmb();
+
+		for (auto cons = mPage->in_cons; cons != prod; cons++)
+		{
+			onEvent(XENKBD_IN_RING_REF(mPage, cons));
+
+			if (delay.count())
+			{
+				std::this_thread::sleep_for(delay);
+			}
+		}
+
+		xen_mb();
+
+		mPage->in_cons = prod;
+	}
+
+private:
+
+	xenkbd_page* mPage;
+};
+
+/*******************************************************************************
+ * Tests
+ ******************************************************************************/
+
+namespace {
+
+xenkbd_in_event makeKey(uint32_t producer, uint32_t seq)
+{
+	xenkbd_in_event event {};
+
+	event.type = XENKBD_TYPE_KEY;
+	event.key.pressed = 1;
+	event.key.keycode = (producer << 16) | seq;
+
+	return event;
+}
+
+xenkbd_in_event makeMotion()
+{
+	xenkbd_in_event event {};
+
+	event.type = XENKBD_TYPE_MOTION;
+	event.motion.rel_x = 1;
+	event.motion.rel_y = 1;
+
+	return event;
+}
+
+uint64_t getDroppedEvents()
+{
+	return Metrics::Collector::getInstance().getCounter(
+			"ring.dropped_events").get();
+}
+
+/*
+ * Producers send keys and flood motions while the frontend is slow: motions
+ * may be merged or dropped, keys shall come in order without losses.
+ */
+bool testSlowConsumer()
+{
+	StressRing ring(1, cCoalesceMs);
+
+	vector<uint32_t> nextSeq(cNumProducers, 0);
+	uint32_t numKeys = 0;
+	uint32_t numMotions = 0;
+	bool ordered = true;
+
+	auto onEvent = [&](const xenkbd_in_event& event)
+	{
+		if (event.type == XENKBD_TYPE_MOTION)
+		{
+			numMotions++;
+
+			return;
+		}
+
+		uint32_t producer = event.key.keycode >> 16;
+		uint32_t seq = event.key.keycode & 0xffff;
+
+		if (event.type != XENKBD_TYPE_KEY || producer >= cNumProducers ||
+			seq != nextSeq[producer])
+		{
+			ordered = false;
+
+			return;
+		}
+
+		nextSeq[producer]++;
+		numKeys++;
+	};
+
+	atomic_bool producing(true);
+
+	thread consumer([&]
+	{
+		auto deadline = steady_clock::now() + cDrainTimeout;
+
+		while (numKeys < cNumProducers * cKeysPerProducer &&
+			   steady_clock::now() < deadline)
+		{
+			ring.consume(onEvent, cConsumerDelay);
+
+			if (!producing)
+			{
+				// queued keys wait for the free ring
+				ring.flush();
+			}
+
+			std::this_thread::sleep_for(cConsumerDelay);
+		}
+	});
+
+	vector<thread> producers;
+
+	for (int i = 0; i < cNumProducers; i++)
+	{
+		producers.emplace_back([&ring, i]
+		{
+			for (uint32_t seq = 0; seq < cKeysPerProducer; seq++)
+			{
+				for (uint32_t j = 0; j < cMotionsPerKey; j++)
+				{
+					ring.queueEvent(makeMotion());
+				}
+
+				ring.sendEvent(makeKey(i, seq));
+
+				std::this_thread::sleep_for(cKeyInterval);
+			}
+		});
+	}
+
+	for (auto& producer : producers)
+	{
+		producer.join();
+	}
+
+	producing = false;
+
+	consumer.join();
+
+	cout << "Slow consumer: keys " << numKeys << "/"
+		 << cNumProducers * cKeysPerProducer << ", motions " << numMotions
+		 << "/" << cNumProducers * cKeysPerProducer * cMotionsPerKey << endl;
+
+	return ordered && numKeys == cNumProducers * cKeysPerProducer;
+}
+
+/*
+ * The frontend doesn't consume events: the ring is filled, the queue is
+ * limited and the oldest keys are dropped.
+ */
+bool testStalledConsumer()
+{
+	StressRing ring(2, 0);
+
+	auto droppedBefore = getDroppedEvents();
+	uint32_t numSent = cStallRings * cRingLen;
+
+	for (uint32_t seq = 0; seq < numSent; seq++)
+	{
+		ring.sendEvent(makeKey(0, seq));
+	}
+
+	auto dropped = getDroppedEvents() - droppedBefore;
+	uint32_t expectedDropped = numSent - (1 + cMaxQueuedRings) * cRingLen;
+
+	uint32_t numKeys = 0;
+	uint32_t lastSeq = 0;
+	bool ordered = true;
+
+	auto onEvent = [&](const xenkbd_in_event& event)
+	{
+		uint32_t seq = event.key.keycode & 0xffff;
+
+		if (numKeys && seq <= lastSeq)
+		{
+			ordered = false;
+		}
+
+		lastSeq = seq;
+		numKeys++;
+	};
+
+	auto deadline = steady_clock::now() + cDrainTimeout;
+
+	while (numKeys < numSent - dropped && steady_clock::now() < deadline)
+	{
+		ring.consume(onEvent);
+		ring.flush();
+	}
+
+	cout << "Stalled consumer: dropped " << dropped << "/" << expectedDropped
+		 << ", keys " << numKeys << "/" << numSent - expectedDropped << endl;
+
+	return ordered && dropped == expectedDropped && lastSeq == numSent - 1 &&
+		   numKeys == numSent - expectedDropped;
+}
+
+}
+
+/*******************************************************************************
+ * main
+ ******************************************************************************/
+
+int main(int argc, char *argv[])
+{
+	bool result = true;
+
+	result &= testSlowConsumer();
+	result &= testStalledConsumer();
+
+	cout << (result ? "PASSED" : "FAILED") << endl;
+
+	return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}